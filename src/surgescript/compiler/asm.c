@@ -20,6 +20,7 @@
  */
 
 #include <ctype.h>
+#include <math.h>
 #include <string.h>
 #include "asm.h"
 #include "symtable.h"
@@ -60,6 +61,28 @@
 #define T2                              U(2)
 #define T3                              U(3)
 #define BREAKPOINT(str)                 emit_breakpoint(context, (str))
+#define SAVE_LHS()                      save_lhs(context)
+#define RESTORE_LHS()                   restore_lhs(context)
+
+/* binary expressions: the left operand is kept in a scratch register
+   while the right operand is evaluated, or on the stack if there is
+   no such register. restore_lhs() returns the register that holds it */
+static void save_lhs(surgescript_nodecontext_t context);
+static unsigned restore_lhs(surgescript_nodecontext_t context);
+
+/* constant folding: expressions whose operands are literals are evaluated
+   at compile-time, and so are the branches on constant conditions. The
+   operations are emitted first, and then replaced by their results */
+static bool read_constant(surgescript_nodecontext_t context, int line, surgescript_var_t* value);
+static void write_constant(surgescript_nodecontext_t context, int line, const surgescript_var_t* value);
+static bool evaluate_binary(const char* op, const surgescript_var_t* lhs, const surgescript_var_t* rhs, surgescript_var_t* result);
+static void fold_binary(surgescript_nodecontext_t context, int first_line, unsigned lhs, const char* op);
+static bool is_constant(surgescript_nodecontext_t context, int line);
+static bool is_string_literal(surgescript_nodecontext_t context, int line);
+static bool is_lhs_saved(surgescript_nodecontext_t context, int line, unsigned lhs);
+static void fold_unary(surgescript_nodecontext_t context, int line, const char* op);
+static void fold_branch(surgescript_nodecontext_t context, int test_line);
+static void mark_tail_call(surgescript_nodecontext_t context);
 
 
 /* objects */
@@ -71,16 +94,11 @@ void emit_object_header(surgescript_nodecontext_t context, surgescript_program_l
 
 void emit_object_footer(surgescript_nodecontext_t context, surgescript_program_label_t start, surgescript_program_label_t end)
 {
-    surgescript_program_label_t aloc = NEWLABEL();
-
+    /* the runtime reads the number of fields from here to size the heaps in advance */
     SSASM(SSOP_RET);
     LABEL(end);
-        SSASM(SSOP_MOVX, T2, I(surgescript_symtable_local_count(context.symtable)));
-        LABEL(aloc);
-            SSASM(SSOP_JE, U(start));
-            SSASM(SSOP_ALLOC);
-            SSASM(SSOP_DEC, T2);
-            SSASM(SSOP_JMP, U(aloc));
+        SSASM(SSOP_ALLOCN, U(surgescript_symtable_local_count(context.symtable)));
+        SSASM(SSOP_JMP, U(start));
 }
 
 /* declarations */
@@ -128,12 +146,10 @@ void emit_assignexpr(surgescript_nodecontext_t context, const char* assignop, co
             SSASM(SSOP_ADD, T0, T1);
             SSASM(SSOP_JMP, U(end));
             LABEL(cat);
-            SSASM(SSOP_MOVO, T2, U(surgescript_objectmanager_system_object(NULL, "String")));
-            SSASM(SSOP_PUSH, T2);
             SSASM(SSOP_PUSH, T1);
             SSASM(SSOP_PUSH, T0);
-            SSASM(SSOP_CALL, TEXT("concat"), U(2));
-            SSASM(SSOP_POPN, U(3));
+            SSASM(SSOP_CAT, T0, U(2));
+            SSASM(SSOP_POPN, U(2));
             LABEL(end);
             surgescript_symtable_emit_write(context.symtable, identifier, context.program, 0);
             break;
@@ -168,8 +184,9 @@ void emit_assignexpr(surgescript_nodecontext_t context, const char* assignop, co
 
 void emit_conditionalexpr1(surgescript_nodecontext_t context, surgescript_program_label_t nope, surgescript_program_label_t done)
 {
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JE, U(nope));
+    fold_branch(context, test);
 }
 
 void emit_conditionalexpr2(surgescript_nodecontext_t context, surgescript_program_label_t nope, surgescript_program_label_t done)
@@ -186,8 +203,9 @@ void emit_conditionalexpr3(surgescript_nodecontext_t context, surgescript_progra
 void emit_logicalorexpr1(surgescript_nodecontext_t context, surgescript_program_label_t done)
 {
     /* short-circuit evaluation */
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JNE, U(done));
+    fold_branch(context, test);
 }
 
 void emit_logicalorexpr2(surgescript_nodecontext_t context, surgescript_program_label_t done)
@@ -198,8 +216,9 @@ void emit_logicalorexpr2(surgescript_nodecontext_t context, surgescript_program_
 void emit_logicalandexpr1(surgescript_nodecontext_t context, surgescript_program_label_t done)
 {
     /* short-circuit evaluation */
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JE, U(done));
+    fold_branch(context, test);
 }
 
 void emit_logicalandexpr2(surgescript_nodecontext_t context, surgescript_program_label_t done)
@@ -209,27 +228,28 @@ void emit_logicalandexpr2(surgescript_nodecontext_t context, surgescript_program
 
 void emit_equalityexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    SAVE_LHS();
 }
 
 void emit_equalityexpr2(surgescript_nodecontext_t context, const char* equalityop)
 {
     surgescript_program_label_t done = NEWLABEL();
+    int first_line = surgescript_program_count_lines(context.program);
+    unsigned lhs = RESTORE_LHS(); /* t[lhs] = left operand */
 
-    SSASM(SSOP_POP, T1);
     if(strcmp(equalityop, "==") == 0) {
-        SSASM(SSOP_CMP, T1, T0);
+        SSASM(SSOP_CMP, U(lhs), T0);
         SSASM(SSOP_LNOT, T0, T2);
     }
     else if(strcmp(equalityop, "!=") == 0) {
-        SSASM(SSOP_CMP, T1, T0);
+        SSASM(SSOP_CMP, U(lhs), T0);
         SSASM(SSOP_LNOT2, T0, T2);
     }
     else if(strcmp(equalityop, "===") == 0) {
         surgescript_program_label_t nope = NEWLABEL();
-        SSASM(SSOP_TCMP, T1, T0);
+        SSASM(SSOP_TCMP, U(lhs), T0);
         SSASM(SSOP_JNE, U(nope));
-        SSASM(SSOP_CMP, T1, T0);
+        SSASM(SSOP_CMP, U(lhs), T0);
         SSASM(SSOP_LNOT, T0, T2);
         SSASM(SSOP_JMP, U(done));
         LABEL(nope);
@@ -237,28 +257,30 @@ void emit_equalityexpr2(surgescript_nodecontext_t context, const char* equalityo
     }
     else if(strcmp(equalityop, "!==") == 0) {
         surgescript_program_label_t yep = NEWLABEL();
-        SSASM(SSOP_TCMP, T1, T0);
+        SSASM(SSOP_TCMP, U(lhs), T0);
         SSASM(SSOP_JNE, U(yep));
-        SSASM(SSOP_CMP, T1, T0);
+        SSASM(SSOP_CMP, U(lhs), T0);
         SSASM(SSOP_LNOT2, T0, T2);
         SSASM(SSOP_JMP, U(done));
         LABEL(yep);
         SSASM(SSOP_MOVB, T0, B(true));
     }
     LABEL(done);
+    fold_binary(context, first_line, lhs, equalityop);
 }
 
 void emit_relationalexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    SAVE_LHS();
 }
 
 void emit_relationalexpr2(surgescript_nodecontext_t context, const char* relationalop)
 {
     surgescript_program_label_t done = NEWLABEL();
+    int first_line = surgescript_program_count_lines(context.program);
+    unsigned lhs = RESTORE_LHS();
 
-    SSASM(SSOP_POP, T1);
-    SSASM(SSOP_CMP, T1, T0);
+    SSASM(SSOP_CMP, U(lhs), T0);
     SSASM(SSOP_MOVB, T0, B(true));
     if(strcmp(relationalop, ">=") == 0) {
         SSASM(SSOP_JGE, U(done));
@@ -277,79 +299,204 @@ void emit_relationalexpr2(surgescript_nodecontext_t context, const char* relatio
         SSASM(SSOP_MOVB, T0, B(false));
     }
     LABEL(done);
+    fold_binary(context, first_line, lhs, relationalop);
 }
 
 void emit_additiveexpr1(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_PUSH, T0);
+    SAVE_LHS();
 }
 
 void emit_additiveexpr2(surgescript_nodecontext_t context, const char* additiveop)
 {
-    SSASM(SSOP_POP, T1);
+    int first_line = surgescript_program_count_lines(context.program);
+    unsigned lhs = RESTORE_LHS();
+
     switch(*additiveop) {
         case '+': {
-            surgescript_program_label_t cat = NEWLABEL();
-            surgescript_program_label_t end = NEWLABEL();
+            surgescript_program_label_t cat, end;
+
+            /* x + "literal" is a concatenation (unless x is also a literal: see fold_binary()) */
+            if(lhs != 1 && is_string_literal(context, first_line - 1) && is_lhs_saved(context, first_line - 2, lhs) && !is_constant(context, first_line - 3)) {
+                SSASM(SSOP_PUSH, U(lhs));
+                SSASM(SSOP_PUSH, T0);
+                SSASM(SSOP_CAT, T0, U(2));
+                SSASM(SSOP_POPN, U(2));
+                break;
+            }
+
+            cat = NEWLABEL();
+            end = NEWLABEL();
+            if(lhs != 1)
+                SSASM(SSOP_MOV, T1, U(lhs));
             SSASM(SSOP_TC01, TYPE("string")); /* either T0 or T1 is a string */
             SSASM(SSOP_JE, U(cat));
             SSASM(SSOP_ADD, T0, T1);
             SSASM(SSOP_JMP, U(end));
             LABEL(cat);
-            SSASM(SSOP_MOVO, T2, U(surgescript_objectmanager_system_object(NULL, "String")));
-            SSASM(SSOP_PUSH, T2);
             SSASM(SSOP_PUSH, T1);
             SSASM(SSOP_PUSH, T0);
-            SSASM(SSOP_CALL, TEXT("concat"), U(2));
-            SSASM(SSOP_POPN, U(3));
+            SSASM(SSOP_CAT, T0, U(2));
+            SSASM(SSOP_POPN, U(2));
             LABEL(end);
             break;
         }
 
         case '-':
-            SSASM(SSOP_SUB, T1, T0);
-            SSASM(SSOP_XCHG, T1, T0);
+            SSASM(SSOP_SUB, U(lhs), T0);
+            SSASM(SSOP_XCHG, U(lhs), T0);
             break;
 
         default:
             ssfatal("Compile Error: invalid additive expression in \"%s\" (object \"%s\")", context.source_file, context.object_name);
             break;
     }
+
+    fold_binary(context, first_line, lhs, additiveop);
 }
 
-void emit_multiplicativeexpr1(surgescript_nodecontext_t context)
+/* a chain of concatenations: "a" + b + c + ... pushes its operands and
+   concatenates all of them with a single instruction. The last operand is
+   kept in t[0]. Objects are converted to strings as soon as they're pushed,
+   because evaluating the next operands may change their string representation.
+
+   emit_concatexpr1() is called before each right operand and returns the
+   number of operands pushed so far, or zero if the left operand isn't known
+   to be a string */
+int emit_concatexpr1(surgescript_nodecontext_t context, int count)
 {
+    int line = surgescript_program_count_lines(context.program);
+
+    if(count == 0) {
+        surgescript_program_operator_t op[4];
+        surgescript_program_operand_t a[4], b[4], literal;
+
+        for(int i = 0; i < 4; i++)
+            surgescript_program_read_line(context.program, line - 4 + i, &op[i], &a[i], &b[i]);
+
+        /* the left operand is a string literal */
+        if(is_string_literal(context, line - 1)) {
+            SSASM(SSOP_PUSH, T0);
+            count = 1;
+        }
+
+        /* the left operand is x + "literal": movs t0, literal ; push x ; push t0 ; cat t0, 2 ; popn 2
+           (see emit_additiveexpr2). x is kept in a scratch register, which isn't clobbered by str */
+        else if(
+            op[0] == SSOP_PUSH && a[0].u > 1 &&
+            op[1] == SSOP_PUSH && a[1].u == 0 &&
+            op[2] == SSOP_CAT && a[2].u == 0 && b[2].u == 2 &&
+            op[3] == SSOP_POPN && a[3].u == 2 &&
+            is_string_literal(context, line - 5) &&
+            surgescript_program_read_line(context.program, line - 5, NULL, NULL, &literal) &&
+            surgescript_program_remove_lines(context.program, line - 5) > 0
+        ) {
+            SSASM(SSOP_STR, U(a[0].u));
+            SSASM(SSOP_PUSH, U(a[0].u));
+            SSASM(SSOP_MOVS, T0, literal);
+            SSASM(SSOP_PUSH, T0);
+            count = 2;
+        }
+    }
+    else {
+        /* push the last operand */
+        if(!is_constant(context, line - 1))
+            SSASM(SSOP_STR, T0);
+        SSASM(SSOP_PUSH, T0);
+
+        /* too many operands? */
+        if(count >= SURGESCRIPT_PROGRAM_MAX_CONCAT) {
+            SSASM(SSOP_CAT, T0, U(count));
+            SSASM(SSOP_POPN, U(count));
+            SSASM(SSOP_PUSH, T0);
+            count = 1;
+        }
+    }
+
+    return count;
+}
+
+/* called after each right operand of a chain of concatenations.
+   Returns the number of operands of the chain so far */
+int emit_concatexpr2(surgescript_nodecontext_t context, int count)
+{
+    int line = surgescript_program_count_lines(context.program);
+    surgescript_program_operator_t op;
+    surgescript_program_operand_t a;
+
+    /* constant folding: ( load t0, constant ; push t0 ; load t0, constant ) */
+    if(
+        line >= 3 && is_constant(context, line - 3) && is_constant(context, line - 1) &&
+        surgescript_program_read_line(context.program, line - 2, &op, &a, NULL) && op == SSOP_PUSH && a.u == 0
+    ) {
+        surgescript_var_t* value[3] = { surgescript_var_create(), surgescript_var_create(), surgescript_var_create() };
+
+        /* the operands of a chain are concatenated as strings, even if they're numbers */
+        read_constant(context, line - 3, value[0]);
+        read_constant(context, line - 1, value[1]);
+        if(surgescript_program_remove_lines(context.program, line - 2) > 0) {
+            surgescript_var_concat(value[2], (const surgescript_var_t**)value, 2, NULL);
+            write_constant(context, line - 3, value[2]);
+            count--; /* the folded constant is the last operand again */
+        }
+
+        surgescript_var_destroy(value[2]);
+        surgescript_var_destroy(value[1]);
+        surgescript_var_destroy(value[0]);
+    }
+
+    return count + 1;
+}
+
+/* ends a chain of concatenations: t0 = concatenation of its operands */
+void emit_concatexpr3(surgescript_nodecontext_t context, int count)
+{
+    /* a single operand (everything has been folded) is already in t0 */
+    if(count <= 1)
+        return;
+
     SSASM(SSOP_PUSH, T0);
+    SSASM(SSOP_CAT, T0, U(count));
+    SSASM(SSOP_POPN, U(count));
+}
+
+void emit_multiplicativeexpr1(surgescript_nodecontext_t context)
+{
+    SAVE_LHS();
 }
 
 void emit_multiplicativeexpr2(surgescript_nodecontext_t context, const char* multiplicativeop)
 {
-    SSASM(SSOP_POP, T1);
+    int first_line = surgescript_program_count_lines(context.program);
+    unsigned lhs = RESTORE_LHS();
+
     switch(*multiplicativeop) {
         case '*':
-            SSASM(SSOP_MUL, T0, T1);
+            SSASM(SSOP_MUL, T0, U(lhs));
             break;
 
         case '/':
-            SSASM(SSOP_DIV, T1, T0);
-            SSASM(SSOP_XCHG, T1, T0);
+            SSASM(SSOP_DIV, U(lhs), T0);
+            SSASM(SSOP_XCHG, U(lhs), T0);
             break;
 
         case '%':
-            SSASM(SSOP_REM, T1, T0);
-            SSASM(SSOP_XCHG, T1, T0);
+            SSASM(SSOP_REM, U(lhs), T0);
+            SSASM(SSOP_XCHG, U(lhs), T0);
             break;
 
         default:
             ssfatal("Compile Error: invalid multiplicative expression in \"%s\" (object \"%s\")", context.source_file, context.object_name);
             break;
     }
+
+    fold_binary(context, first_line, lhs, multiplicativeop);
 }
 
 void emit_unarysign(surgescript_nodecontext_t context, const char* op)
 {
     if(*op == '-')
-        SSASM(SSOP_NEG, T0, T0);
+        fold_unary(context, SSASM(SSOP_NEG, T0, T0), op);
 }
 
 void emit_unaryincdec(surgescript_nodecontext_t context, const char* op, const char* identifier, int line)
@@ -368,7 +515,7 @@ void emit_unaryincdec(surgescript_nodecontext_t context, const char* op, const c
 
 void emit_unarynot(surgescript_nodecontext_t context)
 {
-    SSASM(SSOP_LNOT, T0, T0);
+    fold_unary(context, SSASM(SSOP_LNOT, T0, T0), "!");
 }
 
 void emit_unarytype(surgescript_nodecontext_t context)
@@ -498,12 +645,10 @@ void emit_dictset(surgescript_nodecontext_t context, const char* assignop)
                 SSASM(SSOP_ADD, T0, T1); /* t0 = dict.get(<expr>) + <assignexpr> */
                 SSASM(SSOP_JMP, U(end));
                 LABEL(cat);
-                SSASM(SSOP_MOVO, T2, U(surgescript_objectmanager_system_object(NULL, "String")));
-                SSASM(SSOP_PUSH, T2);
                 SSASM(SSOP_PUSH, T0);
                 SSASM(SSOP_PUSH, T1);
-                SSASM(SSOP_CALL, TEXT("concat"), U(2)); /* t0 = dict.get(<expr>).concat(<assignexpr>) */
-                SSASM(SSOP_POPN, U(3));
+                SSASM(SSOP_CAT, T0, U(2)); /* t0 = dict.get(<expr>) + <assignexpr>, as strings */
+                SSASM(SSOP_POPN, U(2));
                 LABEL(end);
             }
             else if(*assignop == '-')
@@ -586,12 +731,10 @@ void emit_setter2(surgescript_nodecontext_t context, const char* property_name,
             SSASM(SSOP_ADD, T0, T1); /* t0 = object.property_name + <assignexpr> */
             SSASM(SSOP_JMP, U(end));
             LABEL(cat);
-            SSASM(SSOP_MOVO, T2, U(surgescript_objectmanager_system_object(NULL, "String")));
-            SSASM(SSOP_PUSH, T2);
             SSASM(SSOP_PUSH, T0);
             SSASM(SSOP_PUSH, T1);
-            SSASM(SSOP_CALL, TEXT("concat"), U(2)); /* t0 = object.property_name.concat(<assignexpr>) */
-            SSASM(SSOP_POPN, U(3));
+            SSASM(SSOP_CAT, T0, U(2)); /* t0 = object.property_name + <assignexpr>, as strings */
+            SSASM(SSOP_POPN, U(2));
             LABEL(end);
 
             SSASM(SSOP_PUSH, T0);
@@ -732,8 +875,9 @@ void emit_assert(surgescript_nodecontext_t context, int line, const char* messag
 /* statements */
 void emit_if(surgescript_nodecontext_t context, surgescript_program_label_t nope)
 {
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JE, U(nope));
+    fold_branch(context, test);
 }
 
 void emit_else(surgescript_nodecontext_t context, surgescript_program_label_t nope, surgescript_program_label_t done)
@@ -754,8 +898,9 @@ void emit_while1(surgescript_nodecontext_t context, surgescript_program_label_t
 
 void emit_whilecheck(surgescript_nodecontext_t context, surgescript_program_label_t end)
 {
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JE, U(end));
+    fold_branch(context, test);
 }
 
 void emit_while2(surgescript_nodecontext_t context, surgescript_program_label_t begin, surgescript_program_label_t end)
@@ -776,8 +921,9 @@ void emit_dowhilecondition(surgescript_nodecontext_t context, surgescript_progra
 
 void emit_dowhile2(surgescript_nodecontext_t context, surgescript_program_label_t begin, surgescript_program_label_t end)
 {
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JNE, U(begin));
+    fold_branch(context, test);
     LABEL(end);
 }
 
@@ -788,8 +934,9 @@ void emit_for1(surgescript_nodecontext_t context, surgescript_program_label_t be
 
 void emit_forcheck(surgescript_nodecontext_t context, surgescript_program_label_t begin, surgescript_program_label_t body, surgescript_program_label_t increment, surgescript_program_label_t end)
 {
-    SSASM(SSOP_TEST, T0, T0);
+    int test = SSASM(SSOP_TEST, T0, T0);
     SSASM(SSOP_JE, U(end));
+    fold_branch(context, test);
     SSASM(SSOP_JMP, U(body));
     LABEL(increment);
 }
@@ -942,6 +1089,7 @@ void emit_function_argument(surgescript_nodecontext_t context, const char* ident
 
 void emit_ret(surgescript_nodecontext_t context)
 {
+    mark_tail_call(context);
     SSASM(SSOP_RET);
 }
 
@@ -1014,3 +1162,231 @@ void emit_breakpoint(surgescript_nodecontext_t context, const char* text)
 {
     SSASM(SSOP_NOP, I(-1), TEXT(text));
 }
+
+
+
+/* private stuff */
+
+/* saves the left operand (t[0]) of a binary expression */
+void save_lhs(surgescript_nodecontext_t context)
+{
+    int r = surgescript_symtable_push_scratch(context.symtable, context.program);
+
+    if(r >= 0)
+        SSASM(SSOP_MOV, U(r), T0);
+    else
+        SSASM(SSOP_PUSH, T0);
+}
+
+/* restores the left operand of a binary expression, returning the register that holds it */
+unsigned restore_lhs(surgescript_nodecontext_t context)
+{
+    int r = surgescript_symtable_pop_scratch(context.symtable, context.program);
+
+    if(r >= 0)
+        return r;
+
+    SSASM(SSOP_POP, T1);
+    return 1;
+}
+
+/* checks if a line of code loads a constant into t[0]. If so, copies the constant to value */
+bool read_constant(surgescript_nodecontext_t context, int line, surgescript_var_t* value)
+{
+    surgescript_program_operator_t op;
+    surgescript_program_operand_t a, b;
+
+    if(!surgescript_program_read_line(context.program, line, &op, &a, &b) || a.u != 0)
+        return false;
+
+    switch(op) {
+        case SSOP_MOVN:
+            surgescript_var_set_null(value);
+            return true;
+
+        case SSOP_MOVB:
+            surgescript_var_set_bool(value, b.b);
+            return true;
+
+        case SSOP_MOVF:
+            surgescript_var_set_number(value, b.f);
+            return true;
+
+        case SSOP_MOVS:
+            surgescript_var_set_string(value, surgescript_program_get_text(context.program, b.u));
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/* checks if a line of code loads a constant into t[0], and no jump lands on the next line */
+bool is_constant(surgescript_nodecontext_t context, int line)
+{
+    surgescript_var_t* value = surgescript_var_create();
+    bool constant = read_constant(context, line, value) && !surgescript_program_is_jump_target(context.program, line + 1);
+    surgescript_var_destroy(value);
+    return constant;
+}
+
+/* checks if a line of code loads a string literal into t[0], and no jump lands on it or on the next line */
+bool is_string_literal(surgescript_nodecontext_t context, int line)
+{
+    surgescript_program_operator_t op;
+    surgescript_program_operand_t a;
+
+    return surgescript_program_read_line(context.program, line, &op, &a, NULL) && op == SSOP_MOVS && a.u == 0 &&
+           !surgescript_program_is_jump_target(context.program, line) &&
+           !surgescript_program_is_jump_target(context.program, line + 1);
+}
+
+/* checks if a line of code is the one that saved the left operand of a binary expression in t[lhs] (see save_lhs()) */
+bool is_lhs_saved(surgescript_nodecontext_t context, int line, unsigned lhs)
+{
+    surgescript_program_operator_t op;
+    surgescript_program_operand_t a, b;
+
+    return surgescript_program_read_line(context.program, line, &op, &a, &b) && op == SSOP_MOV && a.u == lhs && b.u == 0;
+}
+
+/* rewrites a line of code so that it loads a constant into t[0] */
+void write_constant(surgescript_nodecontext_t context, int line, const surgescript_var_t* value)
+{
+    if(surgescript_var_is_string(value))
+        surgescript_program_chg_line(context.program, line, SSOP_MOVS, T0, TEXT(surgescript_var_fast_get_string(value)));
+    else if(surgescript_var_is_number(value))
+        surgescript_program_chg_line(context.program, line, SSOP_MOVF, T0, F(surgescript_var_get_number(value)));
+    else if(surgescript_var_is_bool(value))
+        surgescript_program_chg_line(context.program, line, SSOP_MOVB, T0, B(surgescript_var_get_bool(value)));
+    else
+        surgescript_program_chg_line(context.program, line, SSOP_MOVN, T0, U(0));
+}
+
+/* computes lhs op rhs exactly like the emitted code would. Returns false if the expression can't be folded */
+bool evaluate_binary(const char* op, const surgescript_var_t* lhs, const surgescript_var_t* rhs, surgescript_var_t* result)
+{
+    if(strcmp(op, "+") == 0) {
+        if(surgescript_var_is_string(lhs) || surgescript_var_is_string(rhs)) {
+            const surgescript_var_t* operand[] = { lhs, rhs };
+            surgescript_var_concat(result, operand, 2, NULL);
+        }
+        else
+            surgescript_var_set_number(result, surgescript_var_get_number(lhs) + surgescript_var_get_number(rhs));
+    }
+    else if(strcmp(op, "-") == 0)
+        surgescript_var_set_number(result, surgescript_var_get_number(lhs) - surgescript_var_get_number(rhs));
+    else if(strcmp(op, "*") == 0)
+        surgescript_var_set_number(result, surgescript_var_get_number(lhs) * surgescript_var_get_number(rhs));
+    else if(strcmp(op, "/") == 0)
+        surgescript_var_set_number(result, surgescript_var_get_number(lhs) / surgescript_var_get_number(rhs));
+    else if(strcmp(op, "%") == 0)
+        surgescript_var_set_number(result, fmod(surgescript_var_get_number(lhs), surgescript_var_get_number(rhs)));
+    else if(strcmp(op, "==") == 0)
+        surgescript_var_set_bool(result, surgescript_var_compare(lhs, rhs) == 0);
+    else if(strcmp(op, "!=") == 0)
+        surgescript_var_set_bool(result, surgescript_var_compare(lhs, rhs) != 0);
+    else if(strcmp(op, "===") == 0)
+        surgescript_var_set_bool(result, surgescript_var_typecode(lhs) == surgescript_var_typecode(rhs) && surgescript_var_compare(lhs, rhs) == 0);
+    else if(strcmp(op, "!==") == 0)
+        surgescript_var_set_bool(result, surgescript_var_typecode(lhs) != surgescript_var_typecode(rhs) || surgescript_var_compare(lhs, rhs) != 0);
+    else if(strcmp(op, "<") == 0)
+        surgescript_var_set_bool(result, surgescript_var_compare(lhs, rhs) < 0);
+    else if(strcmp(op, "<=") == 0)
+        surgescript_var_set_bool(result, surgescript_var_compare(lhs, rhs) <= 0);
+    else if(strcmp(op, ">") == 0)
+        surgescript_var_set_bool(result, surgescript_var_compare(lhs, rhs) > 0);
+    else if(strcmp(op, ">=") == 0)
+        surgescript_var_set_bool(result, surgescript_var_compare(lhs, rhs) >= 0);
+    else
+        return false;
+
+    return true;
+}
+
+/* folds a binary expression emitted from first_line onwards, provided that both operands are literals:
+   ( load t[0], lhs_constant ; mov t[lhs], t[0] ; load t[0], rhs_constant ; <operation> ) */
+void fold_binary(surgescript_nodecontext_t context, int first_line, unsigned lhs, const char* op)
+{
+    surgescript_program_operator_t save_op;
+    surgescript_program_operand_t save_a, save_b;
+    surgescript_var_t* value[3];
+
+    /* the left operand must have been kept in a scratch register */
+    if(lhs == 1 || first_line < 3)
+        return;
+    surgescript_program_read_line(context.program, first_line - 2, &save_op, &save_a, &save_b);
+    if(!(save_op == SSOP_MOV && save_a.u == lhs && save_b.u == 0))
+        return;
+
+    /* evaluate the expression at compile-time */
+    value[0] = surgescript_var_create();
+    value[1] = surgescript_var_create();
+    value[2] = surgescript_var_create();
+    if(read_constant(context, first_line - 3, value[0]) && read_constant(context, first_line - 1, value[1]) && evaluate_binary(op, value[0], value[1], value[2])) {
+        if(surgescript_program_remove_lines(context.program, first_line - 2) > 0)
+            write_constant(context, first_line - 3, value[2]);
+    }
+    surgescript_var_destroy(value[2]);
+    surgescript_var_destroy(value[1]);
+    surgescript_var_destroy(value[0]);
+}
+
+/* folds an unary operation (located at line) on a literal */
+void fold_unary(surgescript_nodecontext_t context, int line, const char* op)
+{
+    surgescript_var_t* value = surgescript_var_create();
+
+    if(read_constant(context, line - 1, value)) {
+        if(surgescript_program_remove_lines(context.program, line) > 0) {
+            if(*op == '-')
+                surgescript_var_set_number(value, -surgescript_var_get_number(value));
+            else if(*op == '!')
+                surgescript_var_set_bool(value, !surgescript_var_get_bool(value));
+            write_constant(context, line - 1, value);
+        }
+    }
+
+    surgescript_var_destroy(value);
+}
+
+/* folds a conditional branch ( test t[0], t[0] ; je / jne label ) on a constant condition:
+   the branch becomes an unconditional jump if it is always taken, or is removed otherwise */
+void fold_branch(surgescript_nodecontext_t context, int test_line)
+{
+    surgescript_var_t* value = surgescript_var_create();
+
+    if(read_constant(context, test_line - 1, value) && !surgescript_program_is_jump_target(context.program, test_line)) {
+        surgescript_program_operator_t jump;
+        surgescript_program_operand_t label;
+        bool taken;
+
+        surgescript_program_read_line(context.program, test_line + 1, &jump, &label, NULL);
+        taken = ((surgescript_var_get_rawbits(value) != 0) == (jump == SSOP_JNE)); /* test yields the raw bits of t[0] */
+
+        if(!taken)
+            surgescript_program_remove_lines(context.program, test_line);
+        else if(surgescript_program_remove_lines(context.program, test_line + 1) > 0)
+            surgescript_program_chg_line(context.program, test_line, SSOP_JMP, label, U(0));
+    }
+
+    surgescript_var_destroy(value);
+}
+
+/* return f(...): if the last thing done before a RET is a function call,
+   i.e., call f, n; popn n+1; make it a tail call. The POPN and the RET
+   are kept for when the callee can't reuse the stack frame */
+void mark_tail_call(surgescript_nodecontext_t context)
+{
+    int line = surgescript_program_count_lines(context.program) - 2;
+    surgescript_program_operator_t call_op, popn_op;
+    surgescript_program_operand_t call_a, call_b, popn_a;
+
+    if(line < 0 || surgescript_program_is_jump_target(context.program, line + 1))
+        return;
+
+    surgescript_program_read_line(context.program, line, &call_op, &call_a, &call_b);
+    surgescript_program_read_line(context.program, line + 1, &popn_op, &popn_a, NULL);
+    if(call_op == SSOP_CALL && popn_op == SSOP_POPN && popn_a.u == call_b.u + 1)
+        surgescript_program_chg_line(context.program, line, SSOP_TAILCALL, call_a, call_b);
+}
@@ -50,6 +50,9 @@ void emit_relationalexpr1(surgescript_nodecontext_t context);
 void emit_relationalexpr2(surgescript_nodecontext_t context, const char* relationalop);
 void emit_additiveexpr1(surgescript_nodecontext_t context);
 void emit_additiveexpr2(surgescript_nodecontext_t context, const char* additiveop);
+int emit_concatexpr1(surgescript_nodecontext_t context, int count);
+int emit_concatexpr2(surgescript_nodecontext_t context, int count);
+void emit_concatexpr3(surgescript_nodecontext_t context, int count);
 void emit_multiplicativeexpr1(surgescript_nodecontext_t context);
 void emit_multiplicativeexpr2(surgescript_nodecontext_t context, const char* multiplicativeop);
 void emit_unarysign(surgescript_nodecontext_t context, const char* op);
@@ -84,6 +84,7 @@ static void remove_object_definition(surgescript_programpool_t* pool, const char
 static bool forbid_duplicates(const surgescript_parser_t* parser, const char* object_name);
 static bool is_state_context(surgescript_nodecontext_t context);
 static char* randstr(char* buf, size_t size);
+static void remove_unreachable_code(surgescript_nodecontext_t context, int first_line);
 static bool is_large_name(const char* name);
 static bool is_valid_name(const char* name);
 
@@ -549,6 +550,16 @@ char* randstr(char* buf, size_t size)
     return ret;
 }
 
+/* removes a block of code that starts right after an unconditional jump,
+   unless a jump lands on it (this happens when a condition is constant) */
+void remove_unreachable_code(surgescript_nodecontext_t context, int first_line)
+{
+    surgescript_program_operator_t op;
+
+    if(surgescript_program_read_line(context.program, first_line - 1, &op, NULL, NULL) && op == SSOP_JMP)
+        surgescript_program_remove_lines(context.program, first_line);
+}
+
 /* is the given [object|program|tag] name too large? */
 bool is_large_name(const char* name)
 {
@@ -1043,15 +1054,26 @@ void relationalexpr(surgescript_parser_t* parser, surgescript_nodecontext_t cont
 
 void additiveexpr(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 {
+    int concat_count = 0; /* number of operands of a chain of string concatenations */
+
     multiplicativeexpr(parser, context);
     while(got_type(parser, SSTOK_ADDITIVEOP)) {
         char* op = ssstrdup(surgescript_token_lexeme(parser->lookahead));
         match(parser, SSTOK_ADDITIVEOP);
-        emit_additiveexpr1(context);
-        multiplicativeexpr(parser, context);
-        emit_additiveexpr2(context, op);
+        if(*op == '+' && (concat_count = emit_concatexpr1(context, concat_count)) > 0) {
+            multiplicativeexpr(parser, context);
+            concat_count = emit_concatexpr2(context, concat_count);
+        }
+        else {
+            emit_concatexpr3(context, concat_count);
+            concat_count = 0;
+            emit_additiveexpr1(context);
+            multiplicativeexpr(parser, context);
+            emit_additiveexpr2(context, op);
+        }
         ssfree(op);
     }
+    emit_concatexpr3(context, concat_count);
 }
 
 void multiplicativeexpr(surgescript_parser_t* parser, surgescript_nodecontext_t context)
@@ -1540,6 +1562,7 @@ void exprstmt(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 void condstmt(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 {
     surgescript_program_label_t nope = surgescript_program_new_label(context.program);
+    int block;
 
     match(parser, SSTOK_IF);
     match(parser, SSTOK_LPAREN);
@@ -1548,15 +1571,19 @@ void condstmt(surgescript_parser_t* parser, surgescript_nodecontext_t context)
 
     /* evaluate the if-condition */
     emit_if(context, nope);
+    block = surgescript_program_count_lines(context.program);
     if(!stmt(parser, context))
         unexpected_symbol(parser);
+    remove_unreachable_code(context, block); /* the condition is always false */
 
     /* is there an else block? match the inner-most if */
     if(optmatch(parser, SSTOK_ELSE)) {
         surgescript_program_label_t done = surgescript_program_new_label(context.program);
         emit_else(context, nope, done);
+        block = surgescript_program_count_lines(context.program);
         if(!stmt(parser, context))
             unexpected_symbol(parser);
+        remove_unreachable_code(context, block); /* the condition is always true */
         emit_endif(context, done);
     }
     else
@@ -1723,13 +1750,17 @@ void loopstmt(surgescript_parser_t* parser, surgescript_nodecontext_t context)
     /* what kind of loop do we have? */
     if(optmatch(parser, SSTOK_WHILE)) {
         /* while loops */
+        int body;
+
         emit_while1(context, begin);
         match(parser, SSTOK_LPAREN);
         expr(parser, context); /* loop condition */
         match(parser, SSTOK_RPAREN);
         emit_whilecheck(context, end);
+        body = surgescript_program_count_lines(context.program);
         if(!stmt(parser, context)) /* loop body */
             unexpected_symbol(parser);
+        remove_unreachable_code(context, body); /* the loop condition is always false */
         emit_while2(context, begin, end);
     }
     else if(optmatch(parser, SSTOK_DO)) {
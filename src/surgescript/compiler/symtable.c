@@ -19,6 +19,7 @@
  * SurgeScript Compiler: symbol table
  */
 
+#include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include "symtable.h"
@@ -45,6 +46,7 @@ static void write_static(surgescript_symtable_entry_t* entry, surgescript_progra
 static char* pack_plugin_path(const char* path);
 static char* unpack_plugin_path(const char* symbol);
 static const char* plugin_symbol(const char* path);
+static int scratch_register(surgescript_symtable_t* symtable, surgescript_program_t* program, int depth);
 
 /* vtable for the entries of the symbol table */
 struct surgescript_symtable_entry_vtable_t
@@ -74,6 +76,7 @@ struct surgescript_symtable_t
 {
     surgescript_symtable_t* parent; /* pointer to its parent (parent scope) */
     SSARRAY(surgescript_symtable_entry_t, entry); /* an entry of the symbol table */
+    int scratch_depth; /* number of scratch registers currently in use */
 };
 
 
@@ -87,6 +90,7 @@ surgescript_symtable_t* surgescript_symtable_create(surgescript_symtable_t* pare
 {
     surgescript_symtable_t* symtable = ssmalloc(sizeof *symtable);
     symtable->parent = parent;
+    symtable->scratch_depth = 0;
     ssarray_init(symtable->entry);
     return symtable;
 }
@@ -239,6 +243,27 @@ void surgescript_symtable_emit_read(surgescript_symtable_t* symtable, const char
         ssfatal("Compile Error: undefined symbol \"%s\".", symbol);
 }
 
+/*
+ * surgescript_symtable_push_scratch()
+ * Reserves a scratch register for an intermediate value of an expression.
+ * Scratch registers are anonymous local variables; returns -1 if there is
+ * no such register (e.g., we're not inside a function)
+ */
+int surgescript_symtable_push_scratch(surgescript_symtable_t* symtable, surgescript_program_t* program)
+{
+    return scratch_register(symtable, program, symtable->scratch_depth++);
+}
+
+/*
+ * surgescript_symtable_pop_scratch()
+ * Releases the scratch register that was most recently reserved, returning it (or -1)
+ */
+int surgescript_symtable_pop_scratch(surgescript_symtable_t* symtable, surgescript_program_t* program)
+{
+    ssassert(symtable->scratch_depth > 0);
+    return scratch_register(symtable, program, --symtable->scratch_depth);
+}
+
 /*
  * surgescript_symtable_local_count()
  * How many symbols does this table have?
@@ -290,7 +315,12 @@ void read_from_heap(surgescript_symtable_entry_t* entry, surgescript_program_t*
 void read_from_stack(surgescript_symtable_entry_t* entry, surgescript_program_t* program, unsigned k)
 {
     surgescript_stackptr_t address = entry->stackaddr;
-    surgescript_program_add_line(program, SSOP_SPEEK, SSOPu(k), SSOPi(address));
+    int r = surgescript_program_register_of(program, address);
+
+    if(r >= 0)
+        surgescript_program_add_line(program, SSOP_MOV, SSOPu(k), SSOPu(r));
+    else
+        surgescript_program_add_line(program, SSOP_SPEEK, SSOPu(k), SSOPi(address));
 }
 
 void write_to_heap(surgescript_symtable_entry_t* entry, surgescript_program_t* program, unsigned k)
@@ -302,7 +332,12 @@ void write_to_heap(surgescript_symtable_entry_t* entry, surgescript_program_t* p
 void write_to_stack(surgescript_symtable_entry_t* entry, surgescript_program_t* program, unsigned k)
 {
     surgescript_stackptr_t address = entry->stackaddr;
-    surgescript_program_add_line(program, SSOP_SPOKE, SSOPu(k), SSOPi(address));
+    int r = surgescript_program_register_of(program, address);
+
+    if(r >= 0)
+        surgescript_program_add_line(program, SSOP_MOV, SSOPu(r), SSOPu(k));
+    else
+        surgescript_program_add_line(program, SSOP_SPOKE, SSOPu(k), SSOPi(address));
 }
 
 void read_static(surgescript_symtable_entry_t* entry, surgescript_program_t* program, unsigned k)
@@ -396,6 +431,27 @@ void write_to_setter(surgescript_symtable_entry_t* entry, surgescript_program_t*
     ssfree(fun_name);
 }
 
+/* the scratch register of a certain depth, or -1 if there is none */
+int scratch_register(surgescript_symtable_t* symtable, surgescript_program_t* program, int depth)
+{
+    char symbol[16];
+    int j;
+
+    /* scratch registers are stored in the stack frame of a function */
+    if(symtable->parent == NULL)
+        return -1;
+
+    /* scratch symbols can't be valid identifiers */
+    snprintf(symbol, sizeof(symbol), "$%d", depth);
+    if((j = indexof_symbol(symtable, symbol)) < 0) {
+        surgescript_stackptr_t address = 1 + surgescript_symtable_local_count(symtable) - surgescript_program_arity(program); /* fact: local_count >= arity */
+        surgescript_symtable_put_stack_symbol(symtable, symbol, address);
+        j = indexof_symbol(symtable, symbol);
+    }
+
+    return surgescript_program_register_of(program, symtable->entry[j].stackaddr);
+}
+
 char* pack_plugin_path(const char* path)
 {
     const char* symbol = plugin_symbol(path);
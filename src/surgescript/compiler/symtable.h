@@ -46,6 +46,10 @@ void surgescript_symtable_emit_write(surgescript_symtable_t* symtable, const cha
 /* emit surgescript program code so that the content stored by the symbol is read to t[k] */
 void surgescript_symtable_emit_read(surgescript_symtable_t* symtable, const char* symbol, struct surgescript_program_t* program, unsigned k);
 
+/* reserve a scratch register for an intermediate value of an expression; returns -1 if there is no such register */
+int surgescript_symtable_push_scratch(surgescript_symtable_t* symtable, struct surgescript_program_t* program);
+int surgescript_symtable_pop_scratch(surgescript_symtable_t* symtable, struct surgescript_program_t* program); /* returns the register released */
+
 /* does the table have a certain symbol? */
 bool surgescript_symtable_has_symbol(surgescript_symtable_t* symtable, const char* symbol);
 bool surgescript_symtable_has_local_symbol(surgescript_symtable_t* symtable, const char* symbol);
@@ -19,6 +19,7 @@
  * SurgeScript heap
  */
 
+#include <string.h>
 #include "heap.h"
 #include "variable.h"
 #include "../util/util.h"
@@ -31,10 +32,23 @@ static const size_t SSHEAP_MAX_SIZE = 10 * 1024 * 1024; /* 10M cells max */
 struct surgescript_heap_t
 {
     size_t size;                /* size of the heap */
-    surgescript_heapptr_t ptr;  /* allocation pointer */
-    surgescript_var_t** mem;    /* data memory */
+    surgescript_heapptr_t ptr;  /* allocation pointer: all cells below it are in use */
+    surgescript_var_t* mem;     /* data memory: the values are stored inline */
+    uint64_t* in_use;           /* a bitmap telling which cells are in use (the free cells are null) */
+    surgescript_var_t* initial_mem; /* the initial cells, stored along with the heap */
+    bool is_embedded;           /* is the heap stored in memory provided by the caller? */
+    uint64_t initial_data[];    /* the initial cells followed by their bitmap */
 };
 
+/* bitmap */
+#define BITMAP_WORDS(size)      (((size) + 63) / 64)
+#define IS_IN_USE(heap, ptr)    (((heap)->in_use[(ptr) >> 6] >> ((ptr) & 63)) & 1)
+#define SET_IN_USE(heap, ptr)   ((heap)->in_use[(ptr) >> 6] |= UINT64_C(1) << ((ptr) & 63))
+#define SET_FREE(heap, ptr)     ((heap)->in_use[(ptr) >> 6] &= ~(UINT64_C(1) << ((ptr) & 63)))
+
+/* private stuff */
+static void grow(surgescript_heap_t* heap);
+
 
 /* -------------------------------
  * public methods
@@ -46,58 +60,90 @@ struct surgescript_heap_t
  */
 surgescript_heap_t* surgescript_heap_create()
 {
-    surgescript_heap_t* heap = ssmalloc(sizeof *heap);
-    size_t size = SSHEAP_INITIAL_SIZE;
+    surgescript_heap_t* heap = surgescript_heap_create_at(ssmalloc(surgescript_heap_footprint(SSHEAP_INITIAL_SIZE)), SSHEAP_INITIAL_SIZE);
+    heap->is_embedded = false;
+    return heap;
+}
+
+/*
+ * surgescript_heap_create_at()
+ * Creates a new heap with an initial capacity of the given number of cells
+ * in a block of memory provided by the caller. The block must be suitably
+ * aligned and hold at least surgescript_heap_footprint(initial_size) bytes
+ */
+surgescript_heap_t* surgescript_heap_create_at(void* memory, size_t initial_size)
+{
+    surgescript_heap_t* heap = (surgescript_heap_t*)memory;
 
-    heap->mem = ssmalloc(size * sizeof(*(heap->mem)));
-    heap->size = size;
-    heap->ptr = size;
-    while(heap->ptr)
-        heap->mem[--heap->ptr] = NULL;
+    heap->size = initial_size;
+    heap->ptr = 0;
+    heap->initial_mem = surgescript_var_init_array(heap->initial_data, initial_size);
+    heap->mem = heap->initial_mem;
+    heap->in_use = heap->initial_data + initial_size * SURGESCRIPT_VAR_SIZE / sizeof(uint64_t);
+    memset(heap->in_use, 0, BITMAP_WORDS(initial_size) * sizeof(uint64_t));
 
+    heap->is_embedded = true;
     return heap;
 }
 
+/*
+ * surgescript_heap_footprint()
+ * The size in bytes of a newly created heap with the given number of cells
+ */
+size_t surgescript_heap_footprint(size_t initial_size)
+{
+    return sizeof(surgescript_heap_t) + initial_size * SURGESCRIPT_VAR_SIZE + BITMAP_WORDS(initial_size) * sizeof(uint64_t);
+}
+
 /*
  * surgescript_heap_destroy()
  * Destroys an existing heap
  */
 surgescript_heap_t* surgescript_heap_destroy(surgescript_heap_t* heap)
 {
-    for(heap->ptr = 0; heap->ptr < heap->size; heap->ptr++) {
-        if(heap->mem[heap->ptr] != NULL)
-            surgescript_var_destroy(heap->mem[heap->ptr]);
+    /* the free cells are null; clearing them is harmless */
+    surgescript_var_clear_array(heap->mem, heap->size);
+
+    if(heap->mem != heap->initial_mem) {
+        ssfree(heap->mem);
+        ssfree(heap->in_use);
     }
 
-    ssfree(heap->mem);
-    return ssfree(heap);
+    /* the memory of an embedded heap belongs to the caller */
+    return heap->is_embedded ? NULL : ssfree(heap);
 }
 
 /*
  * surgescript_heap_malloc()
- * Allocates a memory cell
+ * Allocates a memory cell. This is always the free cell with the lowest address
  */
 surgescript_heapptr_t surgescript_heap_malloc(surgescript_heap_t* heap)
 {
-    for(; heap->ptr < heap->size; heap->ptr++) {
-        if(heap->mem[heap->ptr] == NULL) {
-            heap->mem[heap->ptr] = surgescript_var_create();
-            return heap->ptr;
+    /* skip the words of the bitmap that are full */
+    size_t word = heap->ptr >> 6, words = BITMAP_WORDS(heap->size);
+    while(word < words && heap->in_use[word] == UINT64_MAX)
+        word++;
+
+    /* find the free cell */
+    if(word < words) {
+        surgescript_heapptr_t ptr = ssmax(heap->ptr, word << 6);
+        while(ptr < heap->size && IS_IN_USE(heap, ptr))
+            ptr++;
+
+        if(ptr < heap->size) {
+            SET_IN_USE(heap, ptr);
+            heap->ptr = ptr + 1;
+            return ptr;
         }
     }
 
+    /* no free cells are left */
     if(heap->size * 2 >= SSHEAP_MAX_SIZE) { /* just in case... */
         ssfatal("surgescript_heap_malloc(): max size exceeded.");
         return heap->size - 1;
     }
 
-
-    if(heap->size * 2 >= 256)
-        sslog("surgescript_heap_malloc(): resizing heap to %d cells.", heap->size * 2);
-    heap->mem = ssrealloc(heap->mem, (heap->size * 2) * sizeof(*(heap->mem)));
-    while(heap->ptr)
-        heap->mem[heap->size + --(heap->ptr)] = NULL;
-    heap->size *= 2;
+    grow(heap);
     return surgescript_heap_malloc(heap);
 }
 
@@ -107,9 +153,11 @@ surgescript_heapptr_t surgescript_heap_malloc(surgescript_heap_t* heap)
  */
 surgescript_heapptr_t surgescript_heap_free(surgescript_heap_t* heap, surgescript_heapptr_t ptr)
 {
-    if(ptr >= 0 && ptr < heap->size && heap->mem[ptr] != NULL) {
-        heap->mem[ptr] = surgescript_var_destroy(heap->mem[ptr]);
-        heap->ptr = ptr;
+    if(ptr >= 0 && ptr < heap->size && IS_IN_USE(heap, ptr)) {
+        surgescript_var_set_null(surgescript_var_at(heap->mem, ptr));
+        SET_FREE(heap, ptr);
+        if(ptr < heap->ptr)
+            heap->ptr = ptr;
     }
 
     return 0;
@@ -117,12 +165,13 @@ surgescript_heapptr_t surgescript_heap_free(surgescript_heap_t* heap, surgescrip
 
 /*
  * surgescript_heap_at()
- * Returns the memory cell pointed by ptr
+ * Returns the memory cell pointed by ptr. The returned
+ * pointer is valid until the next call to surgescript_heap_malloc()
  */
 surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescript_heapptr_t ptr)
 {
-    if(ptr >= 0 && ptr < heap->size && heap->mem[ptr] != NULL)
-        return heap->mem[ptr];
+    if(ptr >= 0 && ptr < heap->size && IS_IN_USE(heap, ptr))
+        return surgescript_var_at(heap->mem, ptr);
 
     ssfatal("surgescript_heap_at(0x%X): null pointer exception.", ptr);
     return NULL;
@@ -134,13 +183,13 @@ surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescri
  */
 void surgescript_heap_scan_objects(surgescript_heap_t* heap, void* userdata, bool (*callback)(unsigned,void*))
 {
+    /* the free cells are null, so there is no need to check the bitmap */
     for(surgescript_heapptr_t ptr = 0; ptr < heap->size; ptr++) {
-        if(heap->mem[ptr] != NULL) {
-            unsigned handle = surgescript_var_get_objecthandle(heap->mem[ptr]);
-            if(handle != 0) { /* if heap->mem[ptr] is an object and not null */
-                if(!callback(handle, userdata)) /* if the handle is broken */
-                    surgescript_var_set_null(heap->mem[ptr]); /* fix it */
-            }
+        surgescript_var_t* var = surgescript_var_at(heap->mem, ptr);
+        unsigned handle = surgescript_var_get_objecthandle(var);
+        if(handle != 0) { /* if var is an object and not null */
+            if(!callback(handle, userdata)) /* if the handle is broken */
+                surgescript_var_set_null(var); /* fix it */
         }
     }
 }
@@ -152,8 +201,8 @@ void surgescript_heap_scan_objects(surgescript_heap_t* heap, void* userdata, boo
 bool surgescript_heap_scan_all(surgescript_heap_t* heap, void* userdata, bool (*callback)(surgescript_var_t*,surgescript_heapptr_t,void*))
 {
     for(surgescript_heapptr_t ptr = 0; ptr < heap->size; ptr++) {
-        if(heap->mem[ptr] != NULL) {
-            if(!callback(heap->mem[ptr], ptr, userdata))
+        if(IS_IN_USE(heap, ptr)) {
+            if(!callback(surgescript_var_at(heap->mem, ptr), ptr, userdata))
                 return false; /* stop iteration */
         }
     }
@@ -176,7 +225,7 @@ size_t surgescript_heap_size(const surgescript_heap_t* heap)
  */
 bool surgescript_heap_validaddress(const surgescript_heap_t* heap, surgescript_heapptr_t ptr)
 {
-    return (ptr >= 0 && ptr < heap->size && heap->mem[ptr] != NULL);
+    return (ptr >= 0 && ptr < heap->size && IS_IN_USE(heap, ptr));
 }
 
 /*
@@ -188,9 +237,39 @@ size_t surgescript_heap_memspent(const surgescript_heap_t* heap)
     size_t size = 0;
 
     for(surgescript_heapptr_t ptr = 0; ptr < heap->size; ptr++) {
-        if(heap->mem[ptr] != NULL)
-            size += surgescript_var_size(heap->mem[ptr]);
+        if(IS_IN_USE(heap, ptr))
+            size += surgescript_var_size(surgescript_var_at(heap->mem, ptr));
     }
 
     return size;
 }
+
+
+
+/* -------------------------------
+ * private methods
+ * ------------------------------- */
+
+/* doubles the size of the heap. The values are moved to the new memory */
+void grow(surgescript_heap_t* heap)
+{
+    size_t new_size = ssmax(heap->size * 2, SSHEAP_INITIAL_SIZE);
+    surgescript_var_t* mem = surgescript_var_create_array(new_size);
+    uint64_t* in_use = ssmalloc(BITMAP_WORDS(new_size) * sizeof(uint64_t));
+
+    if(new_size >= 256)
+        sslog("surgescript_heap_malloc(): resizing heap to %d cells.", new_size);
+
+    memcpy(mem, heap->mem, heap->size * SURGESCRIPT_VAR_SIZE);
+    memcpy(in_use, heap->in_use, BITMAP_WORDS(heap->size) * sizeof(uint64_t));
+    memset(in_use + BITMAP_WORDS(heap->size), 0, (BITMAP_WORDS(new_size) - BITMAP_WORDS(heap->size)) * sizeof(uint64_t));
+
+    if(heap->mem != heap->initial_mem) {
+        ssfree(heap->mem);
+        ssfree(heap->in_use);
+    }
+
+    heap->mem = mem;
+    heap->in_use = in_use;
+    heap->size = new_size;
+}
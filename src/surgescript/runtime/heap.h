@@ -35,10 +35,12 @@ struct surgescript_var_t;
 
 /* public methods */
 surgescript_heap_t* surgescript_heap_create();
+surgescript_heap_t* surgescript_heap_create_at(void* memory, size_t initial_size); /* creates a heap of initial_size cells in a block of surgescript_heap_footprint(initial_size) bytes */
+size_t surgescript_heap_footprint(size_t initial_size); /* size in bytes of a newly created heap of initial_size cells */
 surgescript_heap_t* surgescript_heap_destroy(surgescript_heap_t* heap);
 surgescript_heapptr_t surgescript_heap_malloc(surgescript_heap_t* heap);
 surgescript_heapptr_t surgescript_heap_free(surgescript_heap_t* heap, surgescript_heapptr_t ptr);
-struct surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescript_heapptr_t ptr);
+struct surgescript_var_t* surgescript_heap_at(const surgescript_heap_t* heap, surgescript_heapptr_t ptr); /* valid until the next surgescript_heap_malloc() */
 void surgescript_heap_scan_objects(surgescript_heap_t* heap, void* userdata, bool (*callback)(unsigned,void*));
 bool surgescript_heap_scan_all(surgescript_heap_t* heap, void* userdata, bool (*callback)(struct surgescript_var_t*,surgescript_heapptr_t,void*));
 size_t surgescript_heap_size(const surgescript_heap_t* heap);
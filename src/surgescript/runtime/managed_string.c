@@ -20,54 +20,107 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include "managed_string.h"
 #include "../util/ssarray.h"
 #include "../util/util.h"
 #include "../third_party/utf8.h"
+#include "../third_party/uthash.h"
 
 /* constants */
-#define MAXLEN          63      /* the maximum length of a pooled string */
-#define PAGE_CAPACITY   1024    /* the number of strings that a page holds */
+#define MAXLEN          511     /* the maximum length of a pooled string */
+#define PAGE_SIZE       65536   /* the size of a page of the pool, in bytes */
+#define NUM_CLASSES     6       /* the number of size classes of the pool */
+#define LARGE           NUM_CLASSES /* the size class of the strings that don't fit in the pool */
 #define WANT_POOLING    1       /* keep it enabled in production; for testing only */
 #define WANT_VALIDATION 0       /* enable utf-8 validation? it takes extra cycles */
+#define UNKNOWN_COUNT   SIZE_MAX /* the number of characters hasn't been computed yet */
 
-SS_STATIC_ASSERT(MAXLEN <= SS_NAMEMAX, managed_string);
+SS_STATIC_ASSERT(MAXLEN >= SS_NAMEMAX, managed_string); /* names are always pooled */
 
-typedef struct surgescript_managedstringpool_t surgescript_managedstringpool_t;
 typedef struct surgescript_managedstringpage_t surgescript_managedstringpage_t;
+typedef struct surgescript_managedstringclass_t surgescript_managedstringclass_t;
+typedef struct surgescript_managedstringentry_t surgescript_managedstringentry_t;
 
-/* managed string */
+/* managed string (immutable and shared: copies just bump the reference count) */
 struct surgescript_managedstring_t
 {
     char* data; /* pointer to a C string; this must be the first field */
-    bool in_use;
-    surgescript_managedstring_t* next; /* free list */
+    unsigned ref_count; /* zero if not in use */
+    unsigned size_class; /* index of the size class of this string, or LARGE */
+    size_t length; /* length in bytes */
+    size_t char_count; /* number of UTF-8 characters (cached), or UNKNOWN_COUNT */
+    size_t cursor_char, cursor_byte; /* cached lookup: character cursor_char begins at byte cursor_byte */
+    union {
+        surgescript_managedstringpool_t* owner; /* the pool of the string (in use), or NULL if it isn't pooled */
+        surgescript_managedstring_t* next; /* free list (not in use) */
+    };
+    char buffer[]; /* the string data is stored right after the header */
 };
 
-/* a page of managed strings */
+/* a page of memory of a string pool. Each page serves a single size class */
 struct surgescript_managedstringpage_t
 {
-    /* each page holds PAGE_CAPACITY managed strings */
-    surgescript_managedstring_t managed_string[PAGE_CAPACITY];
-    char buffer[(1 + MAXLEN) * PAGE_CAPACITY];
+    char memory[PAGE_SIZE];
+    int size_class; /* the size class served by this page */
+    int free_count; /* number of free blocks (computed when compacting the pool) */
+};
+
+/* a size class: strings of similar size are allocated from the same pages */
+struct surgescript_managedstringclass_t
+{
+    size_t capacity; /* the maximum size of a string of this class, including the '\0' */
+    size_t block_size; /* header + capacity */
+    surgescript_managedstring_t* head; /* the head of the free list */
+    char *top, *end; /* bump allocation in the current page */
+    size_t free_blocks; /* the length of the free list */
+    size_t allocations; /* statistics */
+    size_t deallocations;
+};
+
+/* an entry of the table of interned strings */
+struct surgescript_managedstringentry_t
+{
+    surgescript_managedstring_t* managed_string; /* the table holds a reference to it */
+    UT_hash_handle hh;
 };
 
 /* a pool of managed strings */
 struct surgescript_managedstringpool_t
 {
-    /* a pool holds pages of managed strings */
+    /* a pool holds pages of memory */
     SSARRAY(surgescript_managedstringpage_t*, page);
 
-    /* the head of the free list */
-    surgescript_managedstring_t* head;
+    /* segregated size classes, plus the statistics of the large strings */
+    surgescript_managedstringclass_t size_class[1 + NUM_CLASSES];
+
+    /* number of strings in use */
+    size_t live, peak;
+
+    /* interned strings: these live until the pool is released */
+    surgescript_managedstringentry_t* interned;
+
+    /* the allocator of the pages and of the large strings */
+    const surgescript_allocator_t* allocator;
 };
 
+/* the capacity of each size class, in bytes */
+static const size_t CLASS_CAPACITY[NUM_CLASSES] = { 16, 32, 64, 128, 256, 1 + MAXLEN };
+
 /* private */
+#if WANT_VALIDATION
 static inline char* convert_to_ascii(char* str);
+#endif
+static inline int size_class_of(size_t size);
+static surgescript_managedstring_t* allocate_block(int size_class);
 static surgescript_managedstringpage_t* allocate_page();
 static surgescript_managedstringpage_t* deallocate_page(surgescript_managedstringpage_t* page);
-static surgescript_managedstringpool_t pool;
+static int compare_pages(const void* a, const void* b);
+static surgescript_managedstringpage_t* find_page(const surgescript_managedstring_t* block);
+static inline size_t blocks_per_page(const surgescript_managedstringclass_t* size_class);
+static void* release_memory(void* ptr, const surgescript_allocator_t* allocator);
+static SS_THREAD_LOCAL surgescript_managedstringpool_t* pool = NULL; /* the pool selected by the calling thread */
 
 
 
@@ -79,86 +132,87 @@ static surgescript_managedstringpool_t pool;
 
 /*
  * surgescript_managedstring_create()
- * Quickly acquires a managed string from the pool
+ * Quickly acquires a managed string from the selected pool. If no pool
+ * is selected (i.e., we're outside of a VM), the string is allocated
+ * separately using the default allocator
  */
 surgescript_managedstring_t* surgescript_managedstring_create(const char* string)
 {
     surgescript_managedstring_t* managed_string = NULL;
     size_t length = strlen(string);
-
-#if WANT_POOLING
-    /* strings of the pool are all small (up to MAXLEN characters) */
-    if(length <= MAXLEN) {
-#else
-    if(false) {
-#endif
-        /* quickly prepare a managed string from the pool */
-        ssassert(pool.head != NULL && !pool.head->in_use);
-        managed_string = pool.head;
-        managed_string->in_use = true;
-        pool.head = managed_string->next;
-
-        /* copy string */
-        memcpy(managed_string->data, string, length + 1); /* we already know that length <= MAXLEN */
-
-        /* let's allocate a new page if necessary */
-        if(pool.head == NULL) {
-            surgescript_managedstringpage_t* page = allocate_page();
-            ssarray_push(pool.page, page);
-            pool.head = managed_string->next = &page->managed_string[0];
-        }
-
-        /* now managed_string->next != NULL */
-    }
+    int size_class = (pool != NULL) ? size_class_of(length + 1) : LARGE;
+
+    /* get a block of a size class. Large strings are allocated separately;
+       they are not expected to be released immediately after allocation */
+    if(size_class != LARGE)
+        managed_string = allocate_block(size_class);
+    else if(pool != NULL)
+        managed_string = ssmalloc(sizeof(*managed_string) + (length + 1) * sizeof(char));
     else {
-       /* if the string is too long, we don't use the pool. We allocate
-          memory. In usual circumstances, large strings are not expected to be
-          released immediately after allocation, so no severe performance hit
-          is expected here. */
-
-#if 0
-        /* impose a maximum length */
-        ssassert(length < 1048576);
-#endif
+        const surgescript_allocator_t* previous = surgescript_util_set_allocator(NULL);
+        managed_string = ssmalloc(sizeof(*managed_string) + (length + 1) * sizeof(char));
+        surgescript_util_set_allocator(previous);
+    }
 
-        managed_string = ssmalloc(sizeof *managed_string);
-        managed_string->data = ssstrdup(string);
-        managed_string->in_use = true;
-        managed_string->next = NULL; /* the managed string is not in the pool */
+    if(pool != NULL) {
+        pool->size_class[size_class].allocations++;
+        if(++pool->live > pool->peak)
+            pool->peak = pool->live;
     }
 
+    /* copy string */
+    managed_string->data = managed_string->buffer;
+    managed_string->ref_count = 1;
+    managed_string->size_class = size_class;
+    managed_string->owner = pool;
+    memcpy(managed_string->data, string, length + 1);
+
 #if WANT_VALIDATION
     /* validate */
     if(!u8_isvalid(managed_string->data, length))
-        convert_to_ascii(managed_string->data);
-#else
-    (void)convert_to_ascii;
+        length = strlen(convert_to_ascii(managed_string->data));
 #endif
 
+    /* metadata */
+    managed_string->length = length;
+    managed_string->char_count = UNKNOWN_COUNT; /* computed on demand */
+    managed_string->cursor_char = 0;
+    managed_string->cursor_byte = 0;
+
     /* done! */
     return managed_string;
 }
 
 /*
  * surgescript_managedstring_destroy()
- * Quickly releases a managed string back into the pool
+ * Drops a reference to a managed string. When the last reference
+ * is gone, the string is quickly given back to the pool it came from
  */
 surgescript_managedstring_t* surgescript_managedstring_destroy(surgescript_managedstring_t* managed_string)
 {
-    /* check if the managed string is NOT in the pool */
-    if(managed_string->next == NULL) {
-        ssfree(managed_string->data);
-        return ssfree(managed_string);
-    }
-
-    /* the managed string is no longer in use */
-    ssassert(managed_string->in_use);
-    managed_string->in_use = false;
-
-    /* quickly put the managed string back into the pool */
-    ssassert(pool.head != NULL);
-    managed_string->next = pool.head;
-    pool.head = managed_string;
+    surgescript_managedstringpool_t* owner = managed_string->owner;
+    surgescript_managedstringclass_t* size_class;
+
+    /* is the string still shared? */
+    ssassert(managed_string->ref_count > 0);
+    if(--managed_string->ref_count > 0)
+        return NULL;
+
+    /* release a string that isn't pooled */
+    if(owner == NULL)
+        return release_memory(managed_string, NULL);
+
+    /* release a large string */
+    size_class = &owner->size_class[managed_string->size_class];
+    size_class->deallocations++;
+    owner->live--;
+    if(managed_string->size_class == LARGE)
+        return release_memory(managed_string, owner->allocator);
+
+    /* quickly put the block back into the free list of its size class */
+    managed_string->next = size_class->head;
+    size_class->head = managed_string;
+    size_class->free_blocks++;
 
     /* done! */
     return NULL;
@@ -166,42 +220,348 @@ surgescript_managedstring_t* surgescript_managedstring_destroy(surgescript_manag
 
 /*
  * surgescript_managedstring_clone()
- * Clone a managed string
+ * Clone a managed string. Since managed strings are immutable,
+ * this just shares it (nothing is copied). Strings are only shared
+ * within a pool, so that a pool never outlives the strings it holds:
+ * strings of other pools are copied to the selected pool
  */
 surgescript_managedstring_t* surgescript_managedstring_clone(const surgescript_managedstring_t* managed_string)
 {
-    ssassert(managed_string->in_use);
-    return surgescript_managedstring_create(managed_string->data);
+    surgescript_managedstring_t* shared = (surgescript_managedstring_t*)managed_string;
+
+    ssassert(shared->ref_count > 0);
+    if(shared->owner != pool)
+        return surgescript_managedstring_create(shared->data);
+
+    shared->ref_count++;
+
+    return shared;
+}
+
+
+/*
+ * surgescript_managedstring_intern()
+ * Returns a shared reference to the interned copy of string. Interned strings
+ * are unique: equal strings share the same managed string. Release it with
+ * surgescript_managedstring_destroy(), as usual
+ */
+surgescript_managedstring_t* surgescript_managedstring_intern(const char* string)
+{
+    surgescript_managedstringentry_t* entry = NULL;
+
+    /* no pool is selected */
+    if(pool == NULL)
+        return surgescript_managedstring_create(string);
+
+    HASH_FIND_STR(pool->interned, string, entry);
+    if(entry == NULL) {
+        entry = ssmalloc(sizeof *entry);
+        entry->managed_string = surgescript_managedstring_create(string);
+        HASH_ADD_KEYPTR(hh, pool->interned, entry->managed_string->data, strlen(entry->managed_string->data), entry);
+    }
+
+    return surgescript_managedstring_clone(entry->managed_string);
+}
+
+/*
+ * surgescript_managedstring_length()
+ * The length of the string, in bytes
+ */
+size_t surgescript_managedstring_length(const surgescript_managedstring_t* managed_string)
+{
+    return managed_string->length;
 }
 
+/*
+ * surgescript_managedstring_charcount()
+ * The number of UTF-8 characters of the string. It's computed
+ * once and then cached, as managed strings are immutable
+ */
+size_t surgescript_managedstring_charcount(const surgescript_managedstring_t* managed_string)
+{
+    surgescript_managedstring_t* cache = (surgescript_managedstring_t*)managed_string;
 
+    if(cache->char_count == UNKNOWN_COUNT)
+        cache->char_count = u8_strlen(cache->data);
+
+    return cache->char_count;
+}
+
+/*
+ * surgescript_managedstring_offset()
+ * The byte offset of the charnum-th UTF-8 character of the string (or its
+ * length if charnum is out of bounds). This is O(1) for ASCII strings. Other strings are scanned from the last
+ * lookup onwards, so walking a string character by character is O(n)
+ */
+size_t surgescript_managedstring_offset(const surgescript_managedstring_t* managed_string, size_t charnum)
+{
+    surgescript_managedstring_t* cache = (surgescript_managedstring_t*)managed_string;
+    size_t char_count = surgescript_managedstring_charcount(managed_string);
+
+    /* out of bounds */
+    if(charnum >= char_count)
+        return cache->length;
+
+    /* pure ASCII string? */
+    if(char_count == cache->length)
+        return charnum;
+
+    /* scan from the cached lookup, if possible */
+    if(charnum < cache->cursor_char) {
+        cache->cursor_char = 0;
+        cache->cursor_byte = 0;
+    }
+    cache->cursor_byte += u8_offset(cache->data + cache->cursor_byte, charnum - cache->cursor_char);
+    cache->cursor_char = charnum;
+
+    return cache->cursor_byte;
+}
+
+
+/*
+ * surgescript_managedstring_count_size_classes()
+ * The number of size classes of a string pool. The last one holds the large strings,
+ * which are allocated separately
+ */
+int surgescript_managedstring_count_size_classes()
+{
+    return 1 + NUM_CLASSES;
+}
+
+/*
+ * surgescript_managedstring_size_class_capacity()
+ * The maximum size of a string of the given size class, in bytes, including
+ * the terminating '\0'. Large strings have no maximum size (SIZE_MAX)
+ */
+size_t surgescript_managedstring_size_class_capacity(int size_class)
+{
+    ssassert(size_class >= 0 && size_class <= LARGE);
+    return size_class < LARGE ? CLASS_CAPACITY[size_class] : SIZE_MAX;
+}
+
+/*
+ * surgescript_managedstring_size_class_allocations()
+ * The number of strings of the given size class that have been allocated
+ * since the selected pool was created
+ */
+size_t surgescript_managedstring_size_class_allocations(int size_class)
+{
+    ssassert(size_class >= 0 && size_class <= LARGE);
+    return pool->size_class[size_class].allocations;
+}
+
+/*
+ * surgescript_managedstring_size_class_deallocations()
+ * The number of strings of the given size class that have been released
+ * since the selected pool was created
+ */
+size_t surgescript_managedstring_size_class_deallocations(int size_class)
+{
+    ssassert(size_class >= 0 && size_class <= LARGE);
+    return pool->size_class[size_class].deallocations;
+}
+
+
+/*
+ * surgescript_managedstring_pool_statistics()
+ * Reports the number of strings in use, the number of free blocks of
+ * the selected pool (which hold strings that aren't large) and the peak number
+ * of strings in use
+ */
+void surgescript_managedstring_pool_statistics(size_t* live, size_t* free, size_t* peak)
+{
+    bool selected = (pool != NULL); /* report zeros if no pool is selected */
+
+    if(live != NULL)
+        *live = selected ? pool->live : 0;
+
+    if(free != NULL) {
+        *free = 0;
+        for(int i = 0; i < NUM_CLASSES && selected; i++) {
+            const surgescript_managedstringclass_t* size_class = &pool->size_class[i];
+            *free += size_class->free_blocks + (size_class->end - size_class->top) / size_class->block_size;
+        }
+    }
+
+    if(peak != NULL)
+        *peak = selected ? pool->peak : 0;
+}
+
+/*
+ * surgescript_managedstring_compact_pool()
+ * Gives the pages of the selected pool that hold no strings back to the system.
+ * Returns the number of released bytes
+ */
+size_t surgescript_managedstring_compact_pool()
+{
+    bool compact[NUM_CLASSES];
+    bool worth_it = false;
+    size_t released = 0;
+
+    /* no pool is selected */
+    if(pool == NULL)
+        return 0;
+
+    /* a page can't be empty unless its size class has at least as many free blocks as in a page */
+    for(int i = 0; i < NUM_CLASSES; i++) {
+        const surgescript_managedstringclass_t* size_class = &pool->size_class[i];
+        size_t free_blocks = size_class->free_blocks + (size_class->end - size_class->top) / size_class->block_size;
+        compact[i] = (free_blocks >= blocks_per_page(size_class));
+        worth_it = worth_it || compact[i];
+    }
+
+    if(!worth_it)
+        return 0;
+
+    /* count the free blocks of each page */
+    qsort(pool->page, ssarray_length(pool->page), sizeof(*(pool->page)), compare_pages);
+    for(int i = 0; i < ssarray_length(pool->page); i++)
+        pool->page[i]->free_count = 0;
+
+    for(int i = 0; i < NUM_CLASSES; i++) {
+        if(compact[i]) {
+            for(surgescript_managedstring_t* block = pool->size_class[i].head; block != NULL; block = block->next)
+                find_page(block)->free_count++;
+        }
+    }
+
+    /* find the empty pages. Only part of the current page of a size class has been used */
+    for(int i = 0; i < ssarray_length(pool->page); i++) {
+        surgescript_managedstringpage_t* page = pool->page[i];
+        surgescript_managedstringclass_t* size_class = &pool->size_class[page->size_class];
+        bool is_current = (size_class->top > page->memory && size_class->top <= page->memory + PAGE_SIZE);
+        size_t used_blocks = is_current ? (size_class->top - page->memory) / size_class->block_size : blocks_per_page(size_class);
+
+        if(compact[page->size_class] && (size_t)page->free_count == used_blocks) {
+            page->free_count = -1; /* this page will be released */
+            if(is_current)
+                size_class->top = size_class->end = NULL;
+        }
+    }
+
+    /* rebuild the free lists without the blocks of the empty pages */
+    for(int i = 0; i < NUM_CLASSES; i++) {
+        surgescript_managedstringclass_t* size_class = &pool->size_class[i];
+        surgescript_managedstring_t **tail = &size_class->head;
+
+        if(!compact[i])
+            continue;
+
+        size_class->free_blocks = 0;
+        for(surgescript_managedstring_t* block = size_class->head; block != NULL; block = block->next) {
+            if(find_page(block)->free_count >= 0) {
+                *tail = block;
+                tail = &block->next;
+                size_class->free_blocks++;
+            }
+        }
+        *tail = NULL;
+    }
+
+    /* release the empty pages */
+    for(int i = ssarray_length(pool->page) - 1; i >= 0; i--) {
+        if(pool->page[i]->free_count < 0) {
+            deallocate_page(pool->page[i]);
+            ssarray_remove(pool->page, i);
+            released += sizeof(surgescript_managedstringpage_t);
+        }
+    }
+
+    /* done! */
+    if(released > 0)
+        sslog("Released %zu bytes of the string pool", released);
+
+    return released;
+}
 
 /*
  * surgescript_managedstring_init_pool()
- * Initializes a pool of managed strings
+ * Each VM creates its own pool of strings since SurgeScript 0.6.1.
+ * This function is obsolete, does nothing and has been kept for
+ * backwards compatibility
  */
 void surgescript_managedstring_init_pool()
 {
-    surgescript_managedstringpage_t* page = allocate_page();
-
-    ssarray_init(pool.page);
-    ssarray_push(pool.page, page);
-    pool.head = &page->managed_string[0];
+    /* do nothing */
 }
 
 /*
  * surgescript_managedstring_release_pool()
- * Releases a pool of managed strings
+ * Each VM releases its own pool of strings since SurgeScript 0.6.1.
+ * This function is obsolete, does nothing and has been kept for
+ * backwards compatibility
  */
 void surgescript_managedstring_release_pool()
 {
-    for(int i = ssarray_length(pool.page) - 1; i >= 0; i--)
-        deallocate_page(pool.page[i]);
+    /* do nothing */
+}
+
+/*
+ * surgescript_managedstring_pool_create()
+ * Creates a pool of managed strings. The pool is allocated
+ * using the memory allocator currently in use
+ */
+surgescript_managedstringpool_t* surgescript_managedstring_pool_create()
+{
+    surgescript_managedstringpool_t* new_pool = ssmalloc(sizeof *new_pool);
+
+    ssarray_init(new_pool->page);
+    new_pool->interned = NULL;
+    new_pool->live = new_pool->peak = 0;
+    new_pool->allocator = surgescript_util_allocator();
+
+    for(int i = 0; i <= LARGE; i++) {
+        surgescript_managedstringclass_t* size_class = &new_pool->size_class[i];
+        size_class->capacity = (i < LARGE) ? CLASS_CAPACITY[i] : SIZE_MAX;
+        size_class->block_size = (i < LARGE) ? sizeof(surgescript_managedstring_t) + CLASS_CAPACITY[i] : 0;
+        size_class->head = NULL;
+        size_class->top = size_class->end = NULL; /* pages are allocated on demand */
+        size_class->free_blocks = 0;
+        size_class->allocations = 0;
+        size_class->deallocations = 0;
+    }
 
-    ssarray_release(pool.page);
-    pool.head = NULL;
+    return new_pool;
 }
 
+/*
+ * surgescript_managedstring_pool_destroy()
+ * Destroys a pool of managed strings. Strings allocated
+ * from it must not be used after this call
+ */
+surgescript_managedstringpool_t* surgescript_managedstring_pool_destroy(surgescript_managedstringpool_t* string_pool)
+{
+    surgescript_managedstringpool_t* previous = surgescript_managedstring_pool_select(string_pool);
+    const surgescript_allocator_t* previous_allocator = surgescript_util_set_allocator(string_pool->allocator);
+    surgescript_managedstringentry_t *entry, *tmp;
+
+    HASH_ITER(hh, pool->interned, entry, tmp) {
+        HASH_DEL(pool->interned, entry);
+        surgescript_managedstring_destroy(entry->managed_string);
+        ssfree(entry);
+    }
+
+    for(int i = ssarray_length(pool->page) - 1; i >= 0; i--)
+        deallocate_page(pool->page[i]);
+    ssarray_release(pool->page);
+
+    ssfree(string_pool);
+    surgescript_util_set_allocator(previous_allocator);
+    surgescript_managedstring_pool_select(previous != string_pool ? previous : NULL);
+    return NULL;
+}
+
+/*
+ * surgescript_managedstring_pool_select()
+ * Selects the pool from which the calling thread will allocate new
+ * managed strings (NULL for none). Returns the previously selected pool
+ */
+surgescript_managedstringpool_t* surgescript_managedstring_pool_select(surgescript_managedstringpool_t* string_pool)
+{
+    surgescript_managedstringpool_t* previous = pool;
+    pool = string_pool;
+    return previous;
+}
 
 
 
@@ -209,29 +569,83 @@ void surgescript_managedstring_release_pool()
  * private
  */
 
+/* the smallest size class that fits size bytes, or LARGE */
+int size_class_of(size_t size)
+{
+#if WANT_POOLING
+    for(int i = 0; i < NUM_CLASSES; i++) {
+        if(size <= CLASS_CAPACITY[i])
+            return i;
+    }
+#endif
+
+    return LARGE;
+}
+
+/* take a block from the free list of a size class, or bump-allocate it from its current page */
+surgescript_managedstring_t* allocate_block(int size_class)
+{
+    surgescript_managedstringclass_t* c = &pool->size_class[size_class];
+    surgescript_managedstring_t* block = c->head;
+
+    /* reuse a released block */
+    if(block != NULL) {
+        ssassert(block->ref_count == 0);
+        c->head = block->next;
+        c->free_blocks--;
+        return block;
+    }
+
+    /* the current page is full */
+    if(c->top + c->block_size > c->end) {
+        surgescript_managedstringpage_t* page = allocate_page();
+        page->size_class = size_class;
+        ssarray_push(pool->page, page);
+        c->top = page->memory;
+        c->end = page->memory + blocks_per_page(c) * c->block_size;
+    }
+
+    /* bump allocation */
+    block = (surgescript_managedstring_t*)c->top;
+    c->top += c->block_size;
+    return block;
+}
+
 /* allocate a new page */
 surgescript_managedstringpage_t* allocate_page()
 {
-    surgescript_managedstringpage_t* page = NULL;
-    const int MAXSIZE = 1 + MAXLEN;
-
     sslog("Allocating a new page of strings...");
+    return ssmalloc(sizeof(surgescript_managedstringpage_t));
+}
 
-    /* initialize the page */
-    page = ssmalloc(sizeof *page);
-    for(int i = 0; i < PAGE_CAPACITY; i++) {
-        page->managed_string[i].data = page->buffer + MAXSIZE * i;
-        page->managed_string[i].in_use = false;
+/* compares the addresses of two pages (qsort) */
+int compare_pages(const void* a, const void* b)
+{
+    uintptr_t x = (uintptr_t)(*(const surgescript_managedstringpage_t**)a);
+    uintptr_t y = (uintptr_t)(*(const surgescript_managedstringpage_t**)b);
+    return (x > y) - (x < y);
+}
+
+/* the page that contains a block (the pages must be sorted by address) */
+surgescript_managedstringpage_t* find_page(const surgescript_managedstring_t* block)
+{
+    int low = 0, high = ssarray_length(pool->page) - 1;
+
+    while(low < high) {
+        int mid = (low + high + 1) / 2;
+        if((uintptr_t)pool->page[mid]->memory <= (uintptr_t)block)
+            low = mid;
+        else
+            high = mid - 1;
     }
-    for(int i = 1; i < PAGE_CAPACITY; i++)
-        page->managed_string[i-1].next = page->managed_string + i;
-    page->managed_string[PAGE_CAPACITY-1].next = NULL;
 
-    /* reset string data */
-    memset(page->buffer, '\0', sizeof(page->buffer));
+    return pool->page[low];
+}
 
-    /* done! */
-    return page;
+/* the number of blocks of a page of a size class */
+size_t blocks_per_page(const surgescript_managedstringclass_t* size_class)
+{
+    return PAGE_SIZE / size_class->block_size;
 }
 
 /* deallocate an existing page */
@@ -240,6 +654,16 @@ surgescript_managedstringpage_t* deallocate_page(surgescript_managedstringpage_t
     return ssfree(page);
 }
 
+/* releases memory using the given allocator (NULL for the default one), whichever is in use */
+void* release_memory(void* ptr, const surgescript_allocator_t* allocator)
+{
+    const surgescript_allocator_t* previous = surgescript_util_set_allocator(allocator);
+    ssfree(ptr);
+    surgescript_util_set_allocator(previous);
+    return NULL;
+}
+
+#if WANT_VALIDATION
 /* convert string to ascii */
 char* convert_to_ascii(char* str)
 {
@@ -252,4 +676,5 @@ char* convert_to_ascii(char* str)
 
     *q = '\0';
     return str;
-}
\ No newline at end of file
+}
+#endif
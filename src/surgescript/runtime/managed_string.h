@@ -22,18 +22,38 @@
 #ifndef _SURGESCRIPT_RUNTIME_MANAGED_STRING_H
 #define _SURGESCRIPT_RUNTIME_MANAGED_STRING_H
 
+#include <stddef.h>
+
 typedef struct surgescript_managedstring_t surgescript_managedstring_t;
+typedef struct surgescript_managedstringpool_t surgescript_managedstringpool_t;
 
 /* create & destroy */
 surgescript_managedstring_t* surgescript_managedstring_create(const char* string);
 surgescript_managedstring_t* surgescript_managedstring_destroy(surgescript_managedstring_t* managed_string);
 surgescript_managedstring_t* surgescript_managedstring_clone(const surgescript_managedstring_t* managed_string);
+surgescript_managedstring_t* surgescript_managedstring_intern(const char* string);
 
 /* quickly read the string */
 #define surgescript_managedstring_data(managed_string) (*((const char**)managed_string))
 
+/* UTF-8 metadata */
+size_t surgescript_managedstring_length(const surgescript_managedstring_t* managed_string); /* length in bytes */
+size_t surgescript_managedstring_charcount(const surgescript_managedstring_t* managed_string); /* number of UTF-8 characters */
+size_t surgescript_managedstring_offset(const surgescript_managedstring_t* managed_string, size_t charnum); /* byte offset of a character */
+
+/* allocator statistics, per size class */
+int surgescript_managedstring_count_size_classes(); /* the last size class holds the large strings */
+size_t surgescript_managedstring_size_class_capacity(int size_class); /* maximum size of a string of the size class, in bytes */
+size_t surgescript_managedstring_size_class_allocations(int size_class); /* how many strings of the size class have been allocated */
+size_t surgescript_managedstring_size_class_deallocations(int size_class); /* how many strings of the size class have been released */
+
 /* string pool */
-void surgescript_managedstring_init_pool();
-void surgescript_managedstring_release_pool();
+surgescript_managedstringpool_t* surgescript_managedstring_pool_create(); /* creates a pool of managed strings */
+surgescript_managedstringpool_t* surgescript_managedstring_pool_destroy(surgescript_managedstringpool_t* pool); /* destroys a pool of managed strings */
+surgescript_managedstringpool_t* surgescript_managedstring_pool_select(surgescript_managedstringpool_t* pool); /* selects the pool used by surgescript_managedstring_create() & friends in the calling thread (NULL for none); returns the previously selected pool */
+size_t surgescript_managedstring_compact_pool(); /* releases the empty pages of the selected pool; returns the number of released bytes */
+void surgescript_managedstring_pool_statistics(size_t* live, size_t* free, size_t* peak); /* number of strings in use, free blocks and peak usage of the selected pool */
+void surgescript_managedstring_init_pool(); /* (obsolete) does nothing; each VM creates its own pool */
+void surgescript_managedstring_release_pool(); /* (obsolete) does nothing; each VM releases its own pool */
 
 #endif
\ No newline at end of file
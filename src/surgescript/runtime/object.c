@@ -20,6 +20,7 @@
  */
 
 #include <string.h>
+#include <stddef.h>
 #include "object.h"
 #include "program_pool.h"
 #include "tag_system.h"
@@ -29,17 +30,20 @@
 #include "stack.h"
 #include "renv.h"
 #include "vm_time.h"
+#include "vm_memory.h"
 #include "../util/transform.h"
 #include "../util/ssarray.h"
 #include "../util/util.h"
 #include "../third_party/gettimeofday.h"
 
 /* object structure */
+#define INLINE_CHILDREN 4 /* how many children can be stored without extra allocations */
 struct surgescript_object_t
 {
     /* general properties */
-    char* name; /* my name */
+    const char* name; /* my name (shared by all objects of my class) */
     surgescript_objectclassid_t class_id; /* the ID of the class of objects */
+    const surgescript_programpool_vtable_t* vtable; /* method table of the class of objects */
     surgescript_heap_t* heap; /* each object has its own heap */
     surgescript_renv_t* renv; /* runtime environment */
 
@@ -47,6 +51,7 @@ struct surgescript_object_t
     surgescript_objecthandle_t handle; /* "this" pointer in the object manager */
     surgescript_objecthandle_t parent; /* handle to the parent in the object manager */
     SSARRAY(surgescript_objecthandle_t, child); /* handles to the children */
+    surgescript_objecthandle_t small_child[INLINE_CHILDREN]; /* the first few children are stored inline */
     int depth; /* object depth */
 
     /* inner state */
@@ -72,6 +77,17 @@ struct surgescript_object_t
     void* user_data; /* custom user-data */
 };
 
+/* an object is stored in a single block of memory,
+   along with its runtime environment and its heap */
+typedef struct surgescript_objectblock_t surgescript_objectblock_t;
+struct surgescript_objectblock_t
+{
+    surgescript_object_t object;
+    surgescript_renv_t renv;
+    surgescript_var_t* tmp[SURGESCRIPT_RENV_MAX_TMPVARS];
+    max_align_t heap[]; /* surgescript_heap_footprint(heap_size) bytes */
+};
+
 /* functions */
 void surgescript_object_release(surgescript_object_t* object);
 
@@ -100,23 +116,29 @@ static inline void call_object_function(surgescript_object_t* object, const char
 
 /*
  * surgescript_object_create()
- * Creates a new blank object
+ * Creates a new blank object in a block of surgescript_object_footprint(heap_size)
+ * bytes provided by the caller. heap_size is the number of cells of its heap that
+ * are stored along with it (the heap grows as needed). The name must outlive the object
  */
-surgescript_object_t* surgescript_object_create(const char* name, surgescript_objectclassid_t class_id, surgescript_objecthandle_t handle, surgescript_objectmanager_t* object_manager, surgescript_programpool_t* program_pool, surgescript_stack_t* stack, const surgescript_vmtime_t* vmtime, void* user_data)
+surgescript_object_t* surgescript_object_create(void* memory, size_t heap_size, const char* name, surgescript_objectclassid_t class_id, surgescript_objecthandle_t handle, surgescript_objectmanager_t* object_manager, surgescript_programpool_t* program_pool, surgescript_stack_t* stack, const surgescript_vmtime_t* vmtime, void* user_data)
 {
-    surgescript_object_t* obj = ssmalloc(sizeof *obj);
+    surgescript_objectblock_t* block = (surgescript_objectblock_t*)memory;
+    surgescript_object_t* obj = &(block->object);
 
     if(!object_exists(program_pool, name))
         ssfatal("Runtime Error: can't spawn object \"%s\" - it doesn't exist!", name);
 
-    obj->name = ssstrdup(name);
+    obj->name = name;
     obj->class_id = class_id;
-    obj->heap = surgescript_heap_create();
-    obj->renv = surgescript_renv_create(obj, stack, obj->heap, program_pool, object_manager, NULL);
+    obj->vtable = surgescript_programpool_vtable(program_pool, name);
+    obj->heap = surgescript_heap_create_at(block->heap, heap_size);
+    obj->renv = surgescript_renv_init(&(block->renv), obj, stack, obj->heap, program_pool, object_manager, block->tmp);
 
     obj->handle = handle; /* handle == parent implies I am a root */
     obj->parent = handle;
-    ssarray_init(obj->child);
+    obj->child = obj->small_child; /* no allocation needed for the first few children */
+    obj->child_len = 0;
+    obj->child_cap = INLINE_CHILDREN;
     obj->depth = 0;
 
     obj->state_name = ssstrdup(MAIN_STATE);
@@ -138,9 +160,19 @@ surgescript_object_t* surgescript_object_create(const char* name, surgescript_ob
     return obj;
 }
 
+/*
+ * surgescript_object_footprint()
+ * The size in bytes of the block of memory that stores an object
+ * along with heap_size cells of its heap
+ */
+size_t surgescript_object_footprint(size_t heap_size)
+{
+    return sizeof(surgescript_objectblock_t) + surgescript_heap_footprint(heap_size);
+}
+
 /*
  * surgescript_object_destroy()
- * Destroys an existing object
+ * Destroys an existing object. Its block of memory belongs to the caller
  */
 surgescript_object_t* surgescript_object_destroy(surgescript_object_t* obj)
 {
@@ -162,18 +194,17 @@ surgescript_object_t* surgescript_object_destroy(surgescript_object_t* obj)
         child->parent = child->handle; /* the child is a root now */
         surgescript_objectmanager_delete(manager, child->handle); /* clear up everyone! */
     }
-    ssarray_release(obj->child);
+    if(obj->child != obj->small_child)
+        ssarray_release(obj->child);
 
     /* clear up the local transform, if any */
     if(obj->transform != NULL)
         surgescript_transform_destroy(obj->transform);
 
     /* clear up some data */
-    surgescript_renv_destroy(obj->renv);
+    surgescript_renv_release(obj->renv);
     surgescript_heap_destroy(obj->heap);
     ssfree(obj->state_name);
-    ssfree(obj->name);
-    ssfree(obj);
 
     /* done! */
     return NULL;
@@ -205,6 +236,15 @@ surgescript_objectclassid_t surgescript_object_class_id(const surgescript_object
     return object->class_id; /* fast access */
 }
 
+/*
+ * surgescript_object_vtable()
+ * The method table of my class of objects (used to call functions by method ID)
+ */
+const surgescript_programpool_vtable_t* surgescript_object_vtable(const surgescript_object_t* object)
+{
+    return object->vtable; /* fast access */
+}
+
 /*
  * surgescript_object_heap()
  * Each object has its own heap. This gets mine.
@@ -555,26 +595,28 @@ bool surgescript_object_add_child(surgescript_object_t* object, surgescript_obje
     surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
     surgescript_object_t* child;
 
-    /* check if it doesn't exist already */
-    for(int i = 0; i < ssarray_length(object->child); i++) {
-        if(object->child[i] == child_handle)
-            return true;
-    }
-
     /* check if the child isn't myself */
     if(object->handle == child_handle) {
         ssfatal("Runtime Error: object 0x%X (\"%s\") can't be a child of itself.", object->handle, object->name);
         return false;
     }
 
-    /* check if the child belongs to someone else */
+    /* check if it doesn't exist already (no need to scan the children) */
     child = surgescript_objectmanager_get(manager, child_handle);
+    if(child->parent == object->handle)
+        return true;
+
+    /* check if the child belongs to someone else */
     if(child->parent != child->handle) {
         ssfatal("Runtime Error: can't add child 0x%X (\"%s\") to object 0x%X (\"%s\") - child already registered", child->handle, child->name, object->handle, object->name);
         return false;
     }
 
-    /* add it */
+    /* add it (the children no longer fit in the inline storage? move them) */
+    if(object->child == object->small_child && ssarray_length(object->child) == INLINE_CHILDREN) {
+        object->child = memcpy(ssmalloc(2 * INLINE_CHILDREN * sizeof(*(object->child))), object->small_child, sizeof(object->small_child));
+        object->child_cap = 2 * INLINE_CHILDREN;
+    }
     ssarray_push(object->child, child->handle);
     child->parent = object->handle;
     child->depth = 1 + object->depth;
@@ -888,8 +930,10 @@ bool surgescript_object_update(surgescript_object_t* object)
 
     /* update myself */
     if(object->is_active) {
+        surgescript_vmmemory_t* previous = surgescript_vmmemory_select(surgescript_objectmanager_memory(manager));
         object->time_spent += run_and_measure_current_state(object);
         object->frames_spent++;
+        surgescript_vmmemory_select(previous);
         return object->is_active; /* will generally be true, but not necessarily */
     }
 
@@ -971,7 +1015,11 @@ void surgescript_object_call_state(surgescript_object_t* object, const char* sta
  */
 void surgescript_object_call_current_state(surgescript_object_t* object)
 {
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(surgescript_objectmanager_memory(manager));
+
     run_current_state(object);
+    surgescript_vmmemory_select(previous);
 }
 
 /*
@@ -1003,6 +1051,8 @@ void call_object_function(surgescript_object_t* object, const char* class_name,
     surgescript_programpool_t* program_pool = surgescript_renv_programpool(object->renv);
     surgescript_program_t* program = surgescript_programpool_get(program_pool, class_name, fun_name);
     surgescript_stack_t* stack = surgescript_renv_stack(object->renv);
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(object->renv);
+    surgescript_vmmemory_t* previous;
 
     /* sanity check */
     if(num_params < 0)
@@ -1014,19 +1064,25 @@ void call_object_function(surgescript_object_t* object, const char* class_name,
         return;
     }
 
+    /* the host may call this: select the memory of the VM */
+    previous = surgescript_vmmemory_select(surgescript_objectmanager_memory(manager));
+
     /* parameters are stacked left-to-right */
     surgescript_var_t* self = surgescript_var_set_objecthandle(surgescript_var_create(), object->handle);
     surgescript_stack_push(stack, self);
     for(int i = 0; i < num_params; i++)
-        surgescript_stack_push(stack, surgescript_var_clone(param[i]));
+        surgescript_stack_push_copy(stack, param[i]);
 
     /* call the program */
     surgescript_program_call(program, object->renv, num_params);
-    if(return_value != NULL)
-        surgescript_var_copy(return_value, *(surgescript_renv_tmp(object->renv) + 0)); /* the return value of the function (if any) */
 
     /* pop stuff from the stack */
     surgescript_stack_popn(stack, 1 + num_params);
+    surgescript_vmmemory_select(previous);
+
+    /* the return value of the function (if any) belongs to the caller */
+    if(return_value != NULL)
+        surgescript_var_copy(return_value, *(surgescript_renv_tmp(object->renv) + 0));
 }
 
 char* state2fun(const char* state, char* buffer, size_t size)
@@ -31,6 +31,7 @@ typedef unsigned surgescript_objectclassid_t;
 
 /* forward declarations */
 struct surgescript_programpool_t;
+struct surgescript_programpool_vtable_t;
 struct surgescript_objectmanager_t;
 struct surgescript_program_t;
 struct surgescript_stack_t;
@@ -49,6 +50,7 @@ bool surgescript_object_update(surgescript_object_t* object); /* runs my program
 /* properties */
 const char* surgescript_object_name(const surgescript_object_t* object); /* what's my name? */
 surgescript_objectclassid_t surgescript_object_class_id(const surgescript_object_t* object); /* the ID of my class of objects */
+const struct surgescript_programpool_vtable_t* surgescript_object_vtable(const surgescript_object_t* object); /* the method table of my class of objects */
 struct surgescript_heap_t* surgescript_object_heap(const surgescript_object_t* object); /* each object has its own heap */
 struct surgescript_objectmanager_t* surgescript_object_manager(const surgescript_object_t* object); /* pointer to the object manager */
 void* surgescript_object_userdata(const surgescript_object_t* object); /* custom user data (if any) */
@@ -20,18 +20,22 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include "object_manager.h"
 #include "object.h"
 #include "program_pool.h"
+#include "program.h"
 #include "tag_system.h"
 #include "vm_time.h"
+#include "vm_memory.h"
 #include "stack.h"
 #include "heap.h"
 #include "variable.h"
 #include "../util/ssarray.h"
 #include "../util/util.h"
 #include "../util/perfect_hash.h"
+#include "../third_party/uthash.h"
 
 #define XXH_INLINE_ALL
 #include "../third_party/xxhash.h"
@@ -48,6 +52,29 @@ typedef XXH64_hash_t xxhash_t;
 
 /* types */
 typedef struct surgescript_vmargs_t surgescript_vmargs_t;
+typedef struct surgescript_objectclass_t surgescript_objectclass_t;
+typedef struct surgescript_objectslot_t surgescript_objectslot_t;
+
+/* a class of objects: its objects share its name and are allocated from its slab */
+struct surgescript_objectclass_t
+{
+    char* name; /* the name of the class */
+    size_t heap_size; /* the number of cells of the heap of an object that are stored along with it */
+    surgescript_objectslot_t* free_slot; /* free list */
+    SSARRAY(void*, page); /* the slab: pages of memory holding blocks of objects */
+    int live; /* how many objects of this class exist at the moment */
+    UT_hash_handle hh;
+};
+
+/* a slot of the slab of a class: a small header followed by an object */
+struct surgescript_objectslot_t
+{
+    union {
+        surgescript_objectclass_t* owner; /* the class of the object (slot in use) */
+        surgescript_objectslot_t* next; /* free list (slot not in use) */
+        max_align_t align; /* the object comes right after the header */
+    };
+};
 
 /* object manager */
 struct surgescript_objectmanager_t
@@ -62,6 +89,7 @@ struct surgescript_objectmanager_t
 
     surgescript_vmargs_t* args; /* VM command-line arguments (NULL-terminated array) */
     const surgescript_vmtime_t* vmtime; /* VM time */
+    surgescript_vmmemory_t* memory; /* VM memory */
 
     SSARRAY(surgescript_objecthandle_t, objects_to_be_scanned); /* garbage collection */
     SSARRAY(surgescript_objecthandle_t, objects_scheduled_for_removal); /* a helper for the garbage collector */
@@ -72,6 +100,7 @@ struct surgescript_objectmanager_t
     SSARRAY(char*, plugin_list); /* plugin list */
 
     surgescript_perfecthashseed_t class_id_seed; /* used to generate class IDs from object names */
+    surgescript_objectclass_t* object_class; /* classes of objects & memory allocation */
 };
 
 /* fixed objects */
@@ -104,8 +133,9 @@ static const char* SYSTEM_OBJECTS[] = {
 }; /* this must be a NULL-terminated array */
 
 /* object methods acessible by me */
-extern surgescript_object_t* surgescript_object_create(const char* name, surgescript_objectclassid_t class_id, surgescript_objecthandle_t handle, surgescript_objectmanager_t* object_manager, surgescript_programpool_t* program_pool, surgescript_stack_t* stack, const surgescript_vmtime_t* vmtime, void* user_data); /* creates a new blank object */
-extern surgescript_object_t* surgescript_object_destroy(surgescript_object_t* object); /* destroys an object */
+extern surgescript_object_t* surgescript_object_create(void* memory, size_t heap_size, const char* name, surgescript_objectclassid_t class_id, surgescript_objecthandle_t handle, surgescript_objectmanager_t* object_manager, surgescript_programpool_t* program_pool, surgescript_stack_t* stack, const surgescript_vmtime_t* vmtime, void* user_data); /* creates a new blank object in the given memory */
+extern surgescript_object_t* surgescript_object_destroy(surgescript_object_t* object); /* destroys an object (but doesn't deallocate its memory) */
+extern size_t surgescript_object_footprint(size_t heap_size); /* size in bytes of the memory of an object */
 
 /* the life-cycle of the objects is handled by me */
 extern void surgescript_object_init(surgescript_object_t* object); /* initializes the object (calls constructor, and so on) */
@@ -131,6 +161,21 @@ static void accumulate_object_name(const char* object_name, void* data);
 static inline surgescript_perfecthashkey_t seeded_hash(const char* string, surgescript_perfecthashseed_t seed);
 static inline surgescript_objectclassid_t find_class_id(const surgescript_objectmanager_t* manager, const char* object_name);
 
+/* slab allocation */
+#define SLOT_OBJECT(slot)                 ((void*)((slot) + 1))
+#define OBJECT_SLOT(object)               (((surgescript_objectslot_t*)(object)) - 1)
+static const int MIN_PAGE_CAPACITY = 4; /* initial number of objects per page */
+static const int MAX_PAGE_CAPACITY = 256; /* maximum number of objects per page */
+static const size_t NATIVE_HEAP_SIZE = 8; /* the initial heap size of the objects that aren't written in SurgeScript */
+static surgescript_objectclass_t* find_object_class(surgescript_objectmanager_t* manager, const char* object_name);
+static void* allocate_object(surgescript_objectclass_t* object_class);
+static void deallocate_object(surgescript_object_t* object);
+static size_t release_slab(surgescript_objectclass_t* object_class);
+static void release_object_classes(surgescript_objectmanager_t* manager);
+static inline int page_capacity(int index);
+static inline size_t slot_size(const surgescript_objectclass_t* object_class);
+static size_t count_fields(surgescript_programpool_t* program_pool, const char* object_name);
+
 /* the initial size of the object table
    object handles are recycled, so we pick a large value */
 #define INITIAL_OBJECT_TABLE_SIZE 65536
@@ -148,7 +193,7 @@ SS_STATIC_ASSERT(sizeof(surgescript_objectclassid_t) == sizeof(surgescript_perfe
  * surgescript_objectmanager_create()
  * Creates a new object manager
  */
-surgescript_objectmanager_t* surgescript_objectmanager_create(surgescript_programpool_t* program_pool, surgescript_tagsystem_t* tag_system, surgescript_stack_t* stack, surgescript_vmargs_t* args, const surgescript_vmtime_t* vmtime)
+surgescript_objectmanager_t* surgescript_objectmanager_create(surgescript_programpool_t* program_pool, surgescript_tagsystem_t* tag_system, surgescript_stack_t* stack, surgescript_vmargs_t* args, const surgescript_vmtime_t* vmtime, surgescript_vmmemory_t* memory)
 {
     surgescript_objectmanager_t* manager = ssmalloc(sizeof *manager);
 
@@ -164,6 +209,7 @@ surgescript_objectmanager_t* surgescript_objectmanager_create(surgescript_progra
 
     manager->args = args;
     manager->vmtime = vmtime;
+    manager->memory = memory;
     manager->next_handle = ROOT_HANDLE;
 
     ssarray_init(manager->objects_to_be_scanned);
@@ -175,6 +221,7 @@ surgescript_objectmanager_t* surgescript_objectmanager_create(surgescript_progra
     ssarray_init(manager->plugin_list);
 
     manager->class_id_seed = NO_SEED;
+    manager->object_class = NULL;
 
     return manager;
 }
@@ -194,6 +241,7 @@ surgescript_objectmanager_t* surgescript_objectmanager_destroy(surgescript_objec
     ssarray_release(manager->objects_to_be_scanned);
     ssarray_release(manager->data);
     release_plugin_list(manager);
+    release_object_classes(manager);
 
     return ssfree(manager);
 }
@@ -250,9 +298,13 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn(surgescript_objectman
         return NULL_HANDLE;
     }
 
+    /* the host may call this: select the memory of the VM */
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(manager->memory);
+
     /* create the object */
+    surgescript_objectclass_t* object_class = find_object_class(manager, object_name);
     surgescript_objectclassid_t class_id = find_class_id(manager, object_name);
-    surgescript_object_t *object = surgescript_object_create(object_name, class_id, handle, manager, manager->program_pool, manager->stack, manager->vmtime, user_data);
+    surgescript_object_t *object = surgescript_object_create(allocate_object(object_class), object_class->heap_size, object_class->name, class_id, handle, manager, manager->program_pool, manager->stack, manager->vmtime, user_data);
 
     /* store the object */
     if(handle >= ssarray_length(manager->data)) {
@@ -277,6 +329,7 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn(surgescript_objectman
     surgescript_object_init(object);
 
     /* done! */
+    surgescript_vmmemory_select(previous);
     return handle;
 }
 
@@ -297,8 +350,9 @@ surgescript_objecthandle_t surgescript_objectmanager_spawn_root(surgescript_obje
     char** data[] = { (char**)SYSTEM_OBJECTS, plugins };
 
     /* spawn the root object */
+    surgescript_objectclass_t* root_class = find_object_class(manager, ROOT_OBJECT);
     surgescript_objectclassid_t root_class_id = find_class_id(manager, ROOT_OBJECT);
-    surgescript_object_t* object = surgescript_object_create(ROOT_OBJECT, root_class_id, ROOT_HANDLE, manager, manager->program_pool, manager->stack, manager->vmtime, data);
+    surgescript_object_t* object = surgescript_object_create(allocate_object(root_class), root_class->heap_size, root_class->name, root_class_id, ROOT_HANDLE, manager, manager->program_pool, manager->stack, manager->vmtime, data);
 
     ssassert(ssarray_length(manager->data) > ROOT_HANDLE);
     manager->data[ROOT_HANDLE] = object;
@@ -345,8 +399,12 @@ bool surgescript_objectmanager_delete(surgescript_objectmanager_t* manager, surg
 {
     if(handle < ssarray_length(manager->data)) {
         if(manager->data[handle] != NULL) {
-            manager->data[handle] = surgescript_object_destroy(manager->data[handle]);
+            surgescript_vmmemory_t* previous = surgescript_vmmemory_select(manager->memory);
+            surgescript_object_t* object = manager->data[handle];
+            manager->data[handle] = surgescript_object_destroy(object);
+            deallocate_object(object);
             manager->count--;
+            surgescript_vmmemory_select(previous);
             return true;
         }
     }
@@ -354,6 +412,27 @@ bool surgescript_objectmanager_delete(surgescript_objectmanager_t* manager, surg
     return false;
 }
 
+/*
+ * surgescript_objectmanager_compact()
+ * Gives the memory of the classes of objects that have no
+ * instances back to the system. Returns the number of released bytes
+ */
+size_t surgescript_objectmanager_compact(surgescript_objectmanager_t* manager)
+{
+    surgescript_objectclass_t *object_class, *tmp;
+    size_t released = 0;
+
+    HASH_ITER(hh, manager->object_class, object_class, tmp) {
+        if(object_class->live == 0)
+            released += release_slab(object_class);
+    }
+
+    if(released > 0)
+        sslog("Released %zu bytes of the object slabs", released);
+
+    return released;
+}
+
 /*
  * surgescript_objectmanager_null()
  * Returns a handle to a NULL pointer in the object manager
@@ -487,6 +566,15 @@ surgescript_vmargs_t* surgescript_objectmanager_vmargs(const surgescript_objectm
     return manager->args;
 }
 
+/*
+ * surgescript_objectmanager_memory()
+ * VM memory: the allocator and the pools
+ */
+surgescript_vmmemory_t* surgescript_objectmanager_memory(const surgescript_objectmanager_t* manager)
+{
+    return manager->memory;
+}
+
 /*
  * surgescript_objectmanager_garbagecollect()
  * Runs the garbage collector (incremental mark-and-sweep algorithm)
@@ -494,6 +582,7 @@ surgescript_vmargs_t* surgescript_objectmanager_vmargs(const surgescript_objectm
  */
 bool surgescript_objectmanager_garbagecollect(surgescript_objectmanager_t* manager)
 {
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(manager->memory);
     bool disposed = false;
 
     /* if there are no objects to be scanned, scan the root */
@@ -527,6 +616,7 @@ bool surgescript_objectmanager_garbagecollect(surgescript_objectmanager_t* manag
     }
 
     /* done! */
+    surgescript_vmmemory_select(previous);
     return disposed;
 }
 
@@ -731,3 +821,132 @@ surgescript_objectclassid_t find_class_id(const surgescript_objectmanager_t* man
     surgescript_perfecthashkey_t hash32 = seeded_hash(object_name, manager->class_id_seed); /* perfect hash */
     return (surgescript_objectclassid_t)hash32;
 }
+
+/* finds the class of objects named object_name, registering it if necessary */
+surgescript_objectclass_t* find_object_class(surgescript_objectmanager_t* manager, const char* object_name)
+{
+    surgescript_objectclass_t* object_class = NULL;
+    HASH_FIND_STR(manager->object_class, object_name, object_class);
+
+    if(object_class == NULL) {
+        object_class = ssmalloc(sizeof *object_class);
+        object_class->name = ssstrdup(object_name);
+        object_class->heap_size = count_fields(manager->program_pool, object_name);
+        object_class->free_slot = NULL;
+        ssarray_init(object_class->page);
+        object_class->live = 0;
+        HASH_ADD_KEYPTR(hh, manager->object_class, object_class->name, strlen(object_class->name), object_class);
+    }
+
+    return object_class;
+}
+
+/* allocates memory for an object of the given class */
+void* allocate_object(surgescript_objectclass_t* object_class)
+{
+    surgescript_objectslot_t* slot;
+
+    /* the slab is full? allocate a new page, larger than the previous one */
+    if(object_class->free_slot == NULL) {
+        int capacity = page_capacity(ssarray_length(object_class->page));
+        char* page = ssmalloc(capacity * slot_size(object_class));
+
+        for(int i = capacity - 1; i >= 0; i--) {
+            slot = (surgescript_objectslot_t*)(page + i * slot_size(object_class));
+            slot->next = object_class->free_slot;
+            object_class->free_slot = slot;
+        }
+
+        ssarray_push(object_class->page, page);
+    }
+
+    /* pick a free slot */
+    slot = object_class->free_slot;
+    object_class->free_slot = slot->next;
+    slot->owner = object_class;
+    object_class->live++;
+
+    return SLOT_OBJECT(slot);
+}
+
+/* gives the memory of a destroyed object back to the slab of its class */
+void deallocate_object(surgescript_object_t* object)
+{
+    surgescript_objectslot_t* slot = OBJECT_SLOT(object);
+    surgescript_objectclass_t* object_class = slot->owner;
+
+    slot->next = object_class->free_slot;
+    object_class->free_slot = slot;
+    object_class->live--;
+}
+
+/* releases the slab of a class of objects (there must be no objects of
+   this class). Returns the number of released bytes */
+size_t release_slab(surgescript_objectclass_t* object_class)
+{
+    size_t released = 0;
+
+    ssassert(object_class->live == 0);
+    for(int i = 0; i < ssarray_length(object_class->page); i++) {
+        released += page_capacity(i) * slot_size(object_class);
+        ssfree(object_class->page[i]);
+    }
+
+    ssarray_reset(object_class->page);
+    object_class->free_slot = NULL;
+    return released;
+}
+
+/* releases all classes of objects (there must be no objects) */
+void release_object_classes(surgescript_objectmanager_t* manager)
+{
+    surgescript_objectclass_t *object_class, *tmp;
+
+    HASH_ITER(hh, manager->object_class, object_class, tmp) {
+        HASH_DEL(manager->object_class, object_class);
+        release_slab(object_class);
+        ssarray_release(object_class->page);
+        ssfree(object_class->name);
+        ssfree(object_class);
+    }
+}
+
+/* the number of objects that fit in the index-th page of a slab */
+int page_capacity(int index)
+{
+    int capacity = MIN_PAGE_CAPACITY;
+
+    while(index-- > 0 && capacity < MAX_PAGE_CAPACITY)
+        capacity *= 2;
+
+    return ssmin(capacity, MAX_PAGE_CAPACITY);
+}
+
+/* the size of a slot of the slab of a class, in bytes */
+size_t slot_size(const surgescript_objectclass_t* object_class)
+{
+    /* round up, so that the slots are aligned */
+    const size_t header_size = sizeof(surgescript_objectslot_t);
+    return header_size + header_size * ((surgescript_object_footprint(object_class->heap_size) + header_size - 1) / header_size);
+}
+
+/* the number of fields of the objects of a class, as known by the compiler.
+   These are allocated by the constructor (see emit_object_footer() in asm.c) */
+size_t count_fields(surgescript_programpool_t* program_pool, const char* object_name)
+{
+    surgescript_program_t* constructor;
+    surgescript_program_operator_t op;
+    surgescript_program_operand_t a;
+    size_t count = 0;
+
+    if(!surgescript_programpool_shallowcheck(program_pool, object_name, "__ssconstructor"))
+        return NATIVE_HEAP_SIZE;
+
+    constructor = surgescript_programpool_get(program_pool, object_name, "__ssconstructor");
+    for(int line = 0; surgescript_program_read_line(constructor, line, &op, &a, NULL); line++) {
+        if(op == SSOP_ALLOCN)
+            count += a.u;
+    }
+
+    return count;
+}
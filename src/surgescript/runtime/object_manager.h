@@ -35,12 +35,13 @@ struct surgescript_stack_t;
 struct surgescript_tagsystem_t;
 struct surgescript_vmargs_t;
 struct surgescript_vmtime_t;
+struct surgescript_vmmemory_t;
 
 
 /* public methods */
 
 /* life-cycle */
-surgescript_objectmanager_t* surgescript_objectmanager_create(struct surgescript_programpool_t* program_pool, struct surgescript_tagsystem_t* tag_system, struct surgescript_stack_t* stack, struct surgescript_vmargs_t* args, const struct surgescript_vmtime_t* vmtime);
+surgescript_objectmanager_t* surgescript_objectmanager_create(struct surgescript_programpool_t* program_pool, struct surgescript_tagsystem_t* tag_system, struct surgescript_stack_t* stack, struct surgescript_vmargs_t* args, const struct surgescript_vmtime_t* vmtime, struct surgescript_vmmemory_t* memory);
 surgescript_objectmanager_t* surgescript_objectmanager_destroy(surgescript_objectmanager_t* manager);
 
 /* initialization */
@@ -55,11 +56,13 @@ bool surgescript_objectmanager_delete(surgescript_objectmanager_t* manager, surg
 int surgescript_objectmanager_count(const surgescript_objectmanager_t* manager); /* how many objects there are? */
 void surgescript_objectmanager_install_plugin(surgescript_objectmanager_t* manager, const char* object_name); /* installs a plugin */
 bool surgescript_objectmanager_class_exists(const surgescript_objectmanager_t* manager, const char* object_name); /* does the specified class of objects exist? */
+size_t surgescript_objectmanager_compact(surgescript_objectmanager_t* manager); /* releases the memory of the classes of objects without instances; returns the number of released bytes */
 
 /* components */
 struct surgescript_programpool_t* surgescript_objectmanager_programpool(const surgescript_objectmanager_t* manager); /* pointer to the program pool */
 struct surgescript_tagsystem_t* surgescript_objectmanager_tagsystem(const surgescript_objectmanager_t* manager); /* pointer to the tag manager */
 struct surgescript_vmargs_t* surgescript_objectmanager_vmargs(const surgescript_objectmanager_t* manager); /* VM command-line arguments */
+struct surgescript_vmmemory_t* surgescript_objectmanager_memory(const surgescript_objectmanager_t* manager); /* VM memory (the allocator and the pools) */
 
 /* garbage collector */
 void surgescript_objectmanager_garbagecheck(surgescript_objectmanager_t* manager); /* checks for garbage (incrementally) */
@@ -52,15 +52,84 @@ struct surgescript_program_operation_t
     surgescript_program_operand_t b;
 };
 
+/* a pre-decoded instruction: the compact form of an operation */
+typedef struct surgescript_program_instruction_t surgescript_program_instruction_t;
+struct surgescript_program_instruction_t
+{
+    uint8_t opcode; /* surgescript_program_operator_t */
+    uint8_t a; /* index of a temp */
+    uint8_t b; /* index of a temp */
+    uint8_t reserved;
+    union {
+        uint32_t u;
+        int32_t i;
+    } k; /* immediate: line number, heap / stack address, index of a text / constant / call site... */
+};
+SS_STATIC_ASSERT(sizeof(surgescript_program_instruction_t) == 8, instruction);
+
+/* an entry of the inline cache of a call site */
+typedef struct surgescript_program_cacheentry_t surgescript_program_cacheentry_t;
+struct surgescript_program_cacheentry_t
+{
+    surgescript_objectclassid_t class_id; /* class of a callee */
+    surgescript_program_t* program; /* the program called on objects of that class */
+};
+
+/* a call site with its polymorphic inline cache */
+#define CALLSITE_CACHE_SIZE 4
+typedef struct surgescript_program_callsite_t surgescript_program_callsite_t;
+struct surgescript_program_callsite_t
+{
+    const char* program_name; /* name of the program to be called */
+    int number_of_params; /* number of parameters of the call */
+    int pop_count; /* number of cells popped from the stack after the call */
+    int method_id; /* ID of the name of the program, or -1 if unknown */
+    surgescript_program_cacheentry_t cache[CALLSITE_CACHE_SIZE]; /* cached programs, one per class of callee */
+    int cache_size; /* number of entries of the cache in use */
+    int count; /* how many times has this call site been executed before optimizing? */
+    bool megamorphic; /* are there too many classes of callees? if so, the cache is not used */
+    unsigned hits; /* statistics: calls resolved by the cache */
+    unsigned misses; /* statistics: calls resolved by a lookup in the program pool */
+    int lock; /* lock counter */
+    surgescript_program_t* target; /* program bound at link time (SSOP_DCALL), or NULL */
+    surgescript_objecthandle_t handle; /* callee of a bound call site: a system object, or 0 if it's the owner */
+};
+
+/* an inlining decision taken at link time */
+typedef struct surgescript_program_inlining_t surgescript_program_inlining_t;
+struct surgescript_program_inlining_t
+{
+    const char* program_name; /* name of the called program */
+    const char* decision; /* "inlined" or the reason why the call site hasn't been inlined */
+};
+
+/* a search for a program of Object (see is_inherited_program()) */
+typedef struct surgescript_program_search_t surgescript_program_search_t;
+struct surgescript_program_search_t
+{
+    surgescript_programpool_t* pool; /* where to search */
+    const surgescript_program_t* program; /* the program we're looking for */
+    bool found; /* has the program been found? */
+};
+
 /* the program structure */
 struct surgescript_program_t
 {
     int arity; /* config */
     bool executed; /* has this program ever been executed? */
+    bool referenced; /* is this program referenced by the optimized code of other programs? */
     void (*run)(surgescript_program_t*, const surgescript_renv_t*); /* run function; strategy pattern */
     SSARRAY(surgescript_program_operation_t, line); /* a set of operations (or lines of code) */
     SSARRAY(surgescript_program_label_t, label); /* labels (label[j] is the index of a line of code, j is a label) */
     SSARRAY(char*, text); /* read-only text data */
+    SSARRAY(surgescript_var_t*, literal); /* interned strings; literal[j] holds text[j] or is NULL (see intern_text()) */
+    SSARRAY(surgescript_program_instruction_t, code); /* pre-decoded code; code[j] is generated from line[j] */
+    SSARRAY(surgescript_program_operand_t, constant); /* 64-bit immediates of the pre-decoded code */
+    SSARRAY(surgescript_program_callsite_t, callsite); /* call sites of the pre-decoded code */
+    SSARRAY(surgescript_program_inlining_t, inlining); /* inlining decisions (see inline_callsites()) */
+    int local_count; /* number of local variables reserved by the function header */
+    int register_count; /* size of the register window, including the temps */
+    int eliminated_count; /* number of lines of code eliminated at compile time */
 };
 
 /* a program that encapsulates a C-function */
@@ -69,6 +138,7 @@ struct surgescript_cprogram_t
 {
     surgescript_program_t program; /* base class */
     surgescript_program_cfunction_t cfunction; /* pointer to the C-function */
+    surgescript_program_cfunction_ex_t cfunction_ex; /* pointer to the zero-copy C-function (used if not NULL) */
 };
 
 /* the names of the instructions */
@@ -77,20 +147,52 @@ static const char* instruction_name[] = {
     SURGESCRIPT_PROGRAM_OPERATORS(PRINT_NAME)
 };
 
+/* opcodes of the pre-decoded code take a single byte */
+#define COUNT_OPERATOR(x, y) +1
+SS_STATIC_ASSERT((0 SURGESCRIPT_PROGRAM_OPERATORS(COUNT_OPERATOR)) <= 256, opcode);
+#undef COUNT_OPERATOR
+
 /* utilities */
 static surgescript_program_t* init_program(surgescript_program_t* program, int arity, void (*run_function)(surgescript_program_t*, const surgescript_renv_t*));
 static void run_program(surgescript_program_t* program, const surgescript_renv_t* runtime_environment);
+static surgescript_program_t* execute_program(surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_renv_t* tail_runtime_environment);
 static void run_cprogram(surgescript_program_t* program, const surgescript_renv_t* runtime_environment);
-#ifdef __GNUC__
-static inline __attribute__((flatten,always_inline)) unsigned int run_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, unsigned int ip);
-#else
-static SS_FORCE_INLINE unsigned int run_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, unsigned int ip);
-#endif
-static unsigned int run_call_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_program_operation_t* operation, surgescript_program_operand_t a, surgescript_program_operand_t b);
-static unsigned int run_optcall_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_program_operation_t* operation, surgescript_program_operand_t a, surgescript_program_operand_t b);
-static surgescript_program_t* call_program(const surgescript_renv_t* caller_runtime_environment, int number_of_given_params, const char* program_name, surgescript_program_t* program, surgescript_objectclassid_t* out_class_id);
+static unsigned int run_call_instruction(const surgescript_renv_t* runtime_environment, surgescript_program_instruction_t* instruction, surgescript_program_callsite_t* callsite);
+static unsigned int run_optcall_instruction(const surgescript_renv_t* runtime_environment, surgescript_program_instruction_t* instruction, surgescript_program_callsite_t* callsite);
+static unsigned int run_dcall_instruction(const surgescript_renv_t* runtime_environment, surgescript_program_callsite_t* callsite);
+static surgescript_program_t* prepare_tail_call(const surgescript_renv_t* caller_runtime_environment, const surgescript_program_callsite_t* callsite, surgescript_renv_t* callee_runtime_environment);
+static inline void call_cfunction(surgescript_program_t* program, surgescript_object_t* object, surgescript_stack_t* stack, surgescript_var_t* return_value);
+static inline unsigned int finish_call(const surgescript_renv_t* runtime_environment, const surgescript_program_callsite_t* callsite);
+static surgescript_program_t* call_program(const surgescript_renv_t* caller_runtime_environment, int number_of_given_params, const char* program_name, int method_id, const surgescript_program_callsite_t* cache, surgescript_objectclassid_t* out_class_id);
+static inline surgescript_program_t* cached_program(const surgescript_program_callsite_t* callsite, surgescript_objectclassid_t class_id);
+static bool add_to_cache(surgescript_program_callsite_t* callsite, surgescript_objectclassid_t class_id, surgescript_program_t* program);
 static inline bool is_jump_instruction(surgescript_program_operator_t instruction);
+static void prepare_program(surgescript_program_t* program);
+static void link_callsites(surgescript_program_t* program, const surgescript_renv_t* runtime_environment);
+static void bind_callsites(surgescript_program_t* program, const surgescript_renv_t* runtime_environment);
+static bool is_inherited_program(surgescript_programpool_t* pool, const surgescript_program_t* program);
+static void find_program(const char* program_name, void* data);
+static bool inline_callsites(surgescript_program_t* program);
+static const char* inlining_decision(const surgescript_program_t* program, const surgescript_program_callsite_t* callsite, int first_register);
+static void rename_registers(surgescript_program_operation_t* operation, const surgescript_program_t* callee, int first_register);
 static inline bool remove_labels(surgescript_program_t* program);
+static void add_sentinel(surgescript_program_t* program);
+static void generate_code(surgescript_program_t* program);
+static void simplify_control_flow(surgescript_program_t* program);
+static bool thread_jumps(surgescript_program_t* program);
+static bool remove_unreachable_code(surgescript_program_t* program);
+static void optimize_program(surgescript_program_t* program);
+static bool fuse_operations(surgescript_program_t* program);
+static bool remove_nops(surgescript_program_t* program);
+static inline bool overwrites_register(const surgescript_program_t* program, const surgescript_program_operation_t* operation, unsigned r);
+static inline bool set_comparison(int cmp, unsigned condition, surgescript_var_t** _t);
+static inline unsigned validate_register(const surgescript_program_t* program, unsigned r, int line);
+static uint32_t add_constant(surgescript_program_t* program, surgescript_program_operand_t constant);
+static void intern_text(surgescript_program_t* program, int index);
+static size_t memspent(const surgescript_program_t* program, size_t* source_bytes);
+static inline surgescript_stackptr_t address_of_register(const surgescript_program_t* program, int r);
+static inline bool uses_register_a(surgescript_program_operator_t instruction);
+static inline bool uses_register_b(surgescript_program_operator_t instruction);
 static char* hexdump(unsigned data, char* buf); /* writes the bytes stored in data to buf, in hex format */
 static void fputs_escaped(const char* str, FILE* fp); /* works like fputs, but escapes the string */
 static const int MAX_PROGRAM_ARITY = 256;
@@ -101,9 +203,36 @@ static const int MAX_PROGRAM_ARITY = 256;
 static inline void debug(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, surgescript_var_t** _t);
 #endif
 
+/* count the executed instructions? (for measuring the optimizations only) */
+#define WANT_INSTRUCTION_COUNT          0
+#if WANT_INSTRUCTION_COUNT
+static SS_THREAD_LOCAL uint64_t instruction_count = 0; /* instructions executed on this thread */
+#endif
+
 /* optimizations */
 #define WANT_OPTIMIZED_PROGRAM_CALLS    1
 #define OPTIMIZED_CALL_THRESHOLD        4 /*8*/
+#define WANT_SUPERINSTRUCTIONS          1 /* peephole optimizer */
+#define WANT_CONTROL_FLOW_CLEANUP       1 /* jump threading & dead code elimination */
+#define WANT_STATIC_BINDING             1 /* bind calls on "this" and on system objects at link time */
+#define WANT_INLINING                   1 /* inline small programs into the call sites bound to "this" */
+#define INLINING_THRESHOLD              24 /* maximum number of lines of code of an inlined program */
+#define WANT_TAIL_CALLS                 1 /* tail calls reuse the stack frame */
+
+/* conditions of the fused comparisons (bitmasks: less = 1, equal = 2, greater = 4) */
+#define CONDITION_EQ                    0x2
+#define CONDITION_NE                    0x5
+#define CONDITION_G                     0x4
+#define CONDITION_GE                    0x6
+#define CONDITION_L                     0x1
+#define CONDITION_LE                    0x3
+
+/* direct-threaded dispatch requires labels-as-values (GCC / Clang) */
+#if defined(ENABLE_THREADED_DISPATCH) && ENABLE_THREADED_DISPATCH && defined(__GNUC__)
+#define WANT_THREADED_DISPATCH          1
+#else
+#define WANT_THREADED_DISPATCH          0
+#endif
 
 /* -------------------------------
  * public methods
@@ -128,6 +257,20 @@ surgescript_program_t* surgescript_program_create_native(int arity, surgescript_
 {
     surgescript_cprogram_t* cprogram = ssmalloc(sizeof *cprogram);
     cprogram->cfunction = cfunction;
+    cprogram->cfunction_ex = NULL;
+    return init_program((surgescript_program_t*)cprogram, arity, run_cprogram);
+}
+
+/*
+ * surgescript_program_create_native_ex()
+ * Creates a program that encapsulates a zero-copy C-function, i.e., a
+ * C-function that writes its return value to an output variable
+ */
+surgescript_program_t* surgescript_program_create_native_ex(int arity, surgescript_program_cfunction_ex_t cfunction)
+{
+    surgescript_cprogram_t* cprogram = ssmalloc(sizeof *cprogram);
+    cprogram->cfunction = NULL;
+    cprogram->cfunction_ex = cfunction;
     return init_program((surgescript_program_t*)cprogram, arity, run_cprogram);
 }
 
@@ -137,9 +280,19 @@ surgescript_program_t* surgescript_program_create_native(int arity, surgescript_
  */
 surgescript_program_t* surgescript_program_destroy(surgescript_program_t* program)
 {
+    for(int j = 0; j < ssarray_length(program->literal); j++) {
+        if(program->literal[j] != NULL)
+            surgescript_var_destroy(program->literal[j]);
+    }
+
     for(int j = 0; j < ssarray_length(program->text); j++)
         ssfree(program->text[j]);
 
+    ssarray_release(program->inlining);
+    ssarray_release(program->callsite);
+    ssarray_release(program->constant);
+    ssarray_release(program->code);
+    ssarray_release(program->literal);
     ssarray_release(program->text);
     ssarray_release(program->label);
     ssarray_release(program->line);
@@ -156,20 +309,6 @@ int surgescript_program_add_line(surgescript_program_t* program, surgescript_pro
 {
     surgescript_program_operation_t line = { op, a, b };
     ssarray_push(program->line, line);
-
-#if WANT_OPTIMIZED_PROGRAM_CALLS
-    /* we add two NOPs after every CALL as a trick to help the
-       program optimize itself during its own execution. Each
-       optimized CALL uses 6 operands instead of 2. */
-    if(op == SSOP_CALL) {
-        surgescript_program_operand_t zero = surgescript_program_operand_u(0);
-        surgescript_program_operation_t nop = { SSOP_NOP, zero, zero };
-
-        ssarray_push(program->line, nop);
-        ssarray_push(program->line, nop);
-    }
-#endif
-
     return ssarray_length(program->line) - 1;
 }
 
@@ -180,7 +319,6 @@ int surgescript_program_add_line(surgescript_program_t* program, surgescript_pro
 int surgescript_program_chg_line(surgescript_program_t* program, int line, surgescript_program_operator_t op, surgescript_program_operand_t a, surgescript_program_operand_t b)
 {
     surgescript_program_operation_t newline = { op, a, b };
-    ssassert(op != SSOP_CALL); /* can't change the line do CALL due to the NOP optimization trick in surgescript_program_add_line(); won't change the labels */
 
     if(line >= 0 && line < ssarray_length(program->line)) {
         program->line[line] = newline;
@@ -249,6 +387,60 @@ surgescript_program_label_t surgescript_program_find_label(const surgescript_pro
     return SURGESCRIPT_PROGRAM_UNDEFINED_LABEL;
 }
 
+/*
+ * surgescript_program_is_jump_target()
+ * Checks if a jump of the program lands on the given line of code
+ */
+bool surgescript_program_is_jump_target(const surgescript_program_t* program, int line)
+{
+    for(int i = 0; i < ssarray_length(program->line); i++) {
+        const surgescript_program_operation_t* operation = &(program->line[i]);
+        if(is_jump_instruction(operation->instruction) && operation->a.u < ssarray_length(program->label)) {
+            if(program->label[operation->a.u] == line)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * surgescript_program_remove_lines()
+ * Removes the lines of code from first_line onwards (used by the compiler to
+ * eliminate constant or unreachable code). Nothing is removed if a jump of the
+ * remaining code lands on the removed lines. Returns the number of removed lines
+ */
+int surgescript_program_remove_lines(surgescript_program_t* program, int first_line)
+{
+    int length = ssarray_length(program->line);
+
+    if(first_line < 0 || first_line >= length)
+        return 0;
+
+    /* the removed lines must not be reachable from the remaining code */
+    for(int i = 0; i < first_line; i++) {
+        const surgescript_program_operation_t* operation = &(program->line[i]);
+        if(is_jump_instruction(operation->instruction) && operation->a.u < ssarray_length(program->label)) {
+            surgescript_program_label_t line = program->label[operation->a.u];
+            if(line != SURGESCRIPT_PROGRAM_UNDEFINED_LABEL && line >= first_line)
+                return 0;
+        }
+    }
+
+    /* labels of the removed lines now point to the end of the program */
+    for(int j = 0; j < ssarray_length(program->label); j++) {
+        if(program->label[j] != SURGESCRIPT_PROGRAM_UNDEFINED_LABEL && program->label[j] > first_line)
+            program->label[j] = first_line;
+    }
+
+    /* remove the lines */
+    while(ssarray_length(program->line) > first_line)
+        ssarray_remove(program->line, ssarray_length(program->line) - 1);
+    program->eliminated_count += length - first_line;
+
+    return length - first_line;
+}
+
 /*
  * surgescript_program_add_text()
  * Adds a text to a program (each program has a set of read-only texts)
@@ -320,6 +512,26 @@ int surgescript_program_arity(const surgescript_program_t* program)
     return program->arity;
 }
 
+/*
+ * surgescript_program_register_of()
+ * The register mapped to stack[base + address], or -1 if there is none.
+ * Parameters are stored at negative addresses and local variables at
+ * positive addresses; stack[base] holds the previous base pointer
+ */
+int surgescript_program_register_of(const surgescript_program_t* program, surgescript_stackptr_t address)
+{
+    int r;
+
+    if(address < 0 && address >= -program->arity)
+        r = SURGESCRIPT_PROGRAM_TEMPS + program->arity + address;
+    else if(address > 0)
+        r = SURGESCRIPT_PROGRAM_TEMPS + program->arity + address - 1;
+    else
+        return -1;
+
+    return r < SURGESCRIPT_PROGRAM_MAX_REGISTERS ? r : -1;
+}
+
 /*
  * surgescript_program_call()
  * Low-level SurgeScript program call.
@@ -340,6 +552,21 @@ void surgescript_program_call(surgescript_program_t* program, surgescript_renv_t
 }
 
 
+/*
+ * surgescript_program_instruction_count()
+ * The number of instructions executed so far on the calling thread, for
+ * measuring the optimizations. Superinstructions count as one. This is
+ * always zero unless WANT_INSTRUCTION_COUNT is enabled in program.c
+ */
+uint64_t surgescript_program_instruction_count()
+{
+#if WANT_INSTRUCTION_COUNT
+    return instruction_count;
+#else
+    return 0;
+#endif
+}
+
 /*
  * surgescript_program_is_native()
  * Is the program native (i.e., written in C)?
@@ -355,14 +582,33 @@ bool surgescript_program_executed(const surgescript_program_t* program)
     return program->executed;
 }
 
+/* is this program referenced by the optimized code of other programs? (i.e., it's
+   the target of a static binding or it has been inlined; it must not be replaced) */
+bool surgescript_program_referenced(const surgescript_program_t* program)
+{
+    return program->referenced;
+}
+
 /* dump the program to a file */
 void surgescript_program_dump(surgescript_program_t* program, FILE* fp)
 {
     int i;
     char hex[2][1 + 2 * sizeof(unsigned)];
     surgescript_program_operation_t* op;
-
-    remove_labels(program);
+    size_t source_bytes, compact_bytes;
+    unsigned hits = 0, misses = 0;
+    int megamorphic = 0, bound = 0;
+
+    prepare_program(program);
+    compact_bytes = memspent(program, &source_bytes);
+
+    /* statistics of the inline caches of the call sites */
+    for(i = 0; i < ssarray_length(program->callsite); i++) {
+        hits += program->callsite[i].hits;
+        misses += program->callsite[i].misses;
+        megamorphic += program->callsite[i].megamorphic ? 1 : 0;
+        bound += (program->callsite[i].target != NULL) ? 1 : 0;
+    }
 
     /* print header */
     fprintf(fp,
@@ -395,8 +641,39 @@ void surgescript_program_dump(surgescript_program_t* program, FILE* fp)
         fputs((i < ssarray_length(program->text) - 1) ? "\",\n" : "\"\n", fp);
     }
 
-    /* print footer */
-    fprintf(fp, "    ]\n}\n");
+    /* print the inlining decisions */
+    fprintf(fp,
+        "    ],\n"
+        "    \"inlining\": [\n"
+    );
+
+    for(i = 0; i < ssarray_length(program->inlining); i++) {
+        fputs("        \"", fp);
+        fputs_escaped(program->inlining[i].program_name, fp);
+        fputs(": ", fp);
+        fputs(program->inlining[i].decision, fp);
+        fputs((i < ssarray_length(program->inlining) - 1) ? "\",\n" : "\"\n", fp);
+    }
+
+    /* print memory usage: source operations vs. pre-decoded code */
+    fprintf(fp,
+        "    ],\n"
+        "    \"memory\": {\n"
+        "        \"lines\": %d,\n"
+        "        \"source\": %zu,\n"
+        "        \"compact\": %zu,\n"
+        "        \"constants\": %d,\n"
+        "        \"callsites\": %d\n"
+        "    },\n"
+        "    \"optimizations\": {\n"
+        "        \"eliminated\": %d,\n"
+        "        \"cache_hits\": %u,\n"
+        "        \"cache_misses\": %u,\n"
+        "        \"megamorphic\": %d,\n"
+        "        \"bound\": %d\n"
+        "    }\n"
+        "}\n",
+    (int)ssarray_length(program->line), source_bytes, compact_bytes, (int)ssarray_length(program->constant), (int)ssarray_length(program->callsite), program->eliminated_count, hits, misses, megamorphic, bound);
 }
 
 
@@ -415,445 +692,842 @@ surgescript_program_t* init_program(surgescript_program_t* program, int arity, v
     /* initialization */
     program->arity = ssmax(0, arity);
     program->executed = false;
+    program->referenced = false;
     program->run = run_function;
 
     ssarray_init(program->line);
     ssarray_init(program->label);
     ssarray_init(program->text);
+    ssarray_init(program->literal);
+    ssarray_init(program->code);
+    ssarray_init(program->constant);
+    ssarray_init(program->callsite);
+    ssarray_init(program->inlining);
+    program->local_count = 0;
+    program->register_count = SURGESCRIPT_PROGRAM_TEMPS;
+    program->eliminated_count = 0;
 
     return program;
 }
 
-/* runs a SurgeScript program */
+/* runs a SurgeScript program. A tail call runs the callee in place of the program */
 void run_program(surgescript_program_t* program, const surgescript_renv_t* runtime_environment)
 {
-    unsigned int ip = 0; /* instruction pointer */
-
-    program->executed = true;
-    if(ssarray_length(program->label) > 0)
-        remove_labels(program);
-
-    while(ip < ssarray_length(program->line))
-        ip = run_instruction(program, runtime_environment, ip);
-}
-
-/* runs a C-program */
-void run_cprogram(surgescript_program_t* program, const surgescript_renv_t* runtime_environment)
-{
-    surgescript_cprogram_t* cprogram = (surgescript_cprogram_t*)program;
-    surgescript_object_t* object = surgescript_renv_owner(runtime_environment);
     surgescript_stack_t* stack = surgescript_renv_stack(runtime_environment);
-    const surgescript_var_t** param = program->arity > 0 ? alloca(program->arity * sizeof(*param)) : NULL;
-    surgescript_var_t* return_value = NULL;
-
-    /* set the execution flag */
-    program->executed = true;
-
-    /* grab parameters from the stack (stacked in left-to-right order) */
-    for(int i = 1; i <= program->arity; i++)
-        param[program->arity-i] = surgescript_stack_peek(stack, -i);
-
-    /* call C-function */
-    return_value = cprogram->cfunction(object, param, program->arity);
-    if(return_value != NULL) {
-        surgescript_var_copy(*(surgescript_renv_tmp(runtime_environment) + 0), return_value);
-        surgescript_var_destroy(return_value);
+    surgescript_renv_t tail_runtime_environment;
+    surgescript_program_t* callee;
+    int arity = program->arity; /* number of parameters pushed by the caller of the program */
+    int shift = 0; /* how many cells the frame has been moved up */
+
+    while((callee = execute_program(program, runtime_environment, &tail_runtime_environment)) != NULL) {
+        /* reuse the frame. It's moved up if the callee takes more parameters than
+           the caller has pushed, so that the frame doesn't grow with each call */
+        int new_shift = ssmax(0, callee->arity - arity);
+        surgescript_stack_reuseenv(stack, callee->arity, program->arity, new_shift - shift);
+        shift = new_shift;
+
+        /* run the callee */
+        runtime_environment = &tail_runtime_environment;
+        program = callee;
     }
-    else
-        surgescript_var_set_null(*(surgescript_renv_tmp(runtime_environment) + 0));
+
+    /* the caller of the program pops the frame from where it was */
+    if(shift > 0)
+        surgescript_stack_reuseenv(stack, 0, program->arity, -shift);
 }
 
-/* runs an instruction and returns a new value for the instruction pointer */
-unsigned int run_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, unsigned int ip)
+/* executes the code of a SurgeScript program. Returns the callee of a tail
+   call, which will reuse the stack frame within tail_runtime_environment, or NULL */
+surgescript_program_t* execute_program(surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_renv_t* tail_runtime_environment)
 {
-    /* helper macro */
+    /* helper macros */
     #ifdef t
     #undef t
     #endif
-    #define t(k)             _t[(k).u & 3]
+    #define t(k)             _t[k]
+
+    /* dispatch macros */
+    #if WANT_THREADED_DISPATCH
+    /* direct threading: each instruction jumps straight into the next one */
+    static const void* const dispatch_table[] = {
+        #define DISPATCH_LABEL(x, y) &&L_##x,
+        SURGESCRIPT_PROGRAM_OPERATORS(DISPATCH_LABEL)
+        #undef DISPATCH_LABEL
+    };
+    #define INSTRUCTION(x)   L_##x:
+    #define DISPATCH()       do { FETCH(); goto *dispatch_table[instruction->opcode]; } while(0)
+    #define NEXT()           do { ++ip; DISPATCH(); } while(0)
+    #define JUMP(addr)       do { ip = (addr); DISPATCH(); } while(0)
+    #else
+    /* portable switch-based dispatch */
+    #define INSTRUCTION(x)   case x:
+    #define DISPATCH()       continue
+    #define NEXT()           { ++ip; continue; } /* can't wrap continue in do-while */
+    #define JUMP(addr)       { ip = (addr); continue; }
+    #endif
 
-    /* temporary variables */
+    /* quickening: rewrite the current instruction in place, as with SSOP_OPTCALL.
+       A de-optimized instruction runs again in its generic form */
+    #define QUICKEN(op)      (instruction->opcode = (op))
+    #define DEOPTIMIZE(op)   { instruction->opcode = (op); JUMP(ip); }
+
+    /* read an instruction */
+    #if SURGESCRIPT_DEBUG_MODE
+    #define FETCH()          do { instruction = code + ip; a = instruction->a; b = instruction->b; k = instruction->k.u; COUNT(); debug(program, runtime_environment, program->line[ip].instruction, program->line[ip].a, program->line[ip].b, _t); } while(0)
+    #else
+    #define FETCH()          do { instruction = code + ip; a = instruction->a; b = instruction->b; k = instruction->k.u; COUNT(); } while(0)
+    #endif
+
+    /* instruction counting: the count is kept in a local and published before
+       the program calls other code or returns */
+    #if WANT_INSTRUCTION_COUNT
+    uint32_t executed = 0; /* instructions executed and not yet published */
+    #define COUNT()          (++executed)
+    #define PUBLISH_COUNT()  (instruction_count += executed, executed = 0)
+    #else
+    #define COUNT()          ((void)0)
+    #define PUBLISH_COUNT()  ((void)0)
+    #endif
+
+    /* registers; the temps are shared between caller and callee */
     surgescript_var_t** _t = surgescript_renv_tmp(runtime_environment);
 
-    /* read the operation */
-    surgescript_program_operation_t* operation = program->line + ip;
-    surgescript_program_operand_t a = operation->a;
-    surgescript_program_operand_t b = operation->b;
+    /* program state */
+    surgescript_program_instruction_t* code;
+    surgescript_program_instruction_t* instruction;
+    unsigned int a, b; /* temps */
+    uint32_t k; /* immediate */
+    unsigned int ip = 0; /* instruction pointer */
+    int cmp; /* result of a comparison */
 
-    /* debug mode */
-    #if SURGESCRIPT_DEBUG_MODE
-    debug(program, runtime_environment, operation->instruction, a, b, _t);
+    /* prepare the program */
+    if(!program->executed) {
+        prepare_program(program);
+        link_callsites(program, runtime_environment);
+        program->executed = true;
+    }
+    code = program->code;
+
+    /* set up the register window */
+    if(program->register_count > SURGESCRIPT_PROGRAM_TEMPS) {
+        surgescript_stack_t* stack = surgescript_renv_stack(runtime_environment);
+        surgescript_var_t** window = alloca(program->register_count * sizeof(*window));
+
+        /* reserve the local variables and skip the function header */
+        surgescript_stack_pushn(stack, program->local_count);
+        ip = (program->local_count > 0) ? 1 : 0;
+
+        /* map the registers */
+        for(int r = 0; r < SURGESCRIPT_PROGRAM_TEMPS; r++)
+            window[r] = _t[r];
+        for(int r = SURGESCRIPT_PROGRAM_TEMPS; r < program->register_count; r++)
+            window[r] = surgescript_stack_at(stack, address_of_register(program, r));
+
+        _t = window;
+    }
+
+    /* run the program */
+    #if WANT_THREADED_DISPATCH
+    DISPATCH();
+    #else
+    while(ip < ssarray_length(program->code)) {
+        FETCH();
+        switch(instruction->opcode) {
     #endif
 
-    /* run the instruction */
-    switch(operation->instruction) {
         /* basics */
-        case SSOP_NOP: /* no-operation */
-            break;
+        INSTRUCTION(SSOP_NOP) /* no-operation */
+            NEXT();
 
-        case SSOP_SELF: /* owner object ("this" pointer) */
+        INSTRUCTION(SSOP_SELF) /* owner object ("this" pointer) */
             surgescript_var_set_objecthandle(t(a), surgescript_object_handle(surgescript_renv_owner(runtime_environment)));
-            break;
+            NEXT();
 
-        case SSOP_STATE: /* t[a] receives the current state. If b == -1, then the current state is set to t[a] instead. */
-            if(b.i == -1) {
+        INSTRUCTION(SSOP_STATE) /* t[a] receives the current state. If b == -1, then the current state is set to t[a] instead. */
+            if(instruction->k.i == -1) {
                 char state[256] = "";
                 surgescript_var_to_string(t(a), state, sizeof(state));
                 surgescript_object_set_state(surgescript_renv_owner(runtime_environment), state);
             }
             else
                 surgescript_var_set_string(t(a), surgescript_object_state(surgescript_renv_owner(runtime_environment)));
-            break;
+            NEXT();
 
-        case SSOP_CALLER: /* caller object */
+        INSTRUCTION(SSOP_CALLER) /* caller object */
             surgescript_var_set_objecthandle(t(a), surgescript_renv_caller(runtime_environment));
-            break;
+            NEXT();
 
         /* assignment operations */
-        case SSOP_MOVN: /* move null */
+        INSTRUCTION(SSOP_MOVN) /* move null */
             surgescript_var_set_null(t(a));
-            break;
+            NEXT();
 
-        case SSOP_MOVB: /* move boolean */
-            surgescript_var_set_bool(t(a), b.b);
-            break;
+        INSTRUCTION(SSOP_MOVB) /* move boolean */
+            surgescript_var_set_bool(t(a), k != 0);
+            NEXT();
 
-        case SSOP_MOVF: /* move number */
-            surgescript_var_set_number(t(a), b.f);
-            break;
+        INSTRUCTION(SSOP_MOVF) /* move number */
+            surgescript_var_set_number(t(a), program->constant[k].f);
+            NEXT();
 
-        case SSOP_MOVS: /* move string */
-            if(b.u < ssarray_length(program->text))
-                surgescript_var_set_string(t(a), program->text[b.u]);
-            break;
+        INSTRUCTION(SSOP_MOVS) /* move string */
+            surgescript_var_copy(t(a), program->literal[k]); /* shares the interned string */
+            NEXT();
 
-        case SSOP_MOVO: /* move object handle */
-            surgescript_var_set_objecthandle(t(a), b.u);
-            break;
+        INSTRUCTION(SSOP_MOVO) /* move object handle */
+            surgescript_var_set_objecthandle(t(a), k);
+            NEXT();
 
-        case SSOP_MOVX: /* move int64 */
-            surgescript_var_set_rawbits(t(a), b.i64);
-            break;
+        INSTRUCTION(SSOP_MOVX) /* move int64 */
+            surgescript_var_set_rawbits(t(a), program->constant[k].i64);
+            NEXT();
 
-        case SSOP_MOV: /* move temp */
+        INSTRUCTION(SSOP_MOV) /* move temp */
             surgescript_var_copy(t(a), t(b));
-            break;
+            NEXT();
 
-        case SSOP_XCHG: /* fast exchange */
+        INSTRUCTION(SSOP_XCHG) /* fast exchange */
             surgescript_var_swap(t(a), t(b));
-            break;
+            NEXT();
 
         /* heap operations */
-        case SSOP_ALLOC:
+        INSTRUCTION(SSOP_ALLOC)
             surgescript_var_set_number(t(a), surgescript_heap_malloc(surgescript_renv_heap(runtime_environment)));
-            break;
+            NEXT();
 
-        case SSOP_PEEK:
-            surgescript_var_copy(t(a), surgescript_heap_at(surgescript_renv_heap(runtime_environment), b.u));
-            break;
+        INSTRUCTION(SSOP_ALLOCN)
+            for(surgescript_heap_t* heap = surgescript_renv_heap(runtime_environment); k > 0; k--)
+                surgescript_heap_malloc(heap);
+            NEXT();
 
-        case SSOP_POKE:
-            surgescript_var_copy(surgescript_heap_at(surgescript_renv_heap(runtime_environment), b.u), t(a));
-            break;
+        INSTRUCTION(SSOP_PEEK)
+            surgescript_var_copy(t(a), surgescript_heap_at(surgescript_renv_heap(runtime_environment), k));
+            NEXT();
+
+        INSTRUCTION(SSOP_POKE)
+            surgescript_var_copy(surgescript_heap_at(surgescript_renv_heap(runtime_environment), k), t(a));
+            NEXT();
 
         /* stack operations */
-        case SSOP_PUSH:
-            surgescript_stack_push(surgescript_renv_stack(runtime_environment), surgescript_var_clone(t(a)));
-            break;
+        INSTRUCTION(SSOP_PUSH)
+            surgescript_stack_push_copy(surgescript_renv_stack(runtime_environment), t(a));
+            NEXT();
 
-        case SSOP_POP:
+        INSTRUCTION(SSOP_POP)
             surgescript_var_copy(t(a), surgescript_stack_top(surgescript_renv_stack(runtime_environment)));
             surgescript_stack_pop(surgescript_renv_stack(runtime_environment));
-            break;
+            NEXT();
 
-        case SSOP_SPEEK:
-            surgescript_var_copy(t(a), surgescript_stack_peek(surgescript_renv_stack(runtime_environment), b.i));
-            break;
+        INSTRUCTION(SSOP_SPEEK)
+            surgescript_var_copy(t(a), surgescript_stack_peek(surgescript_renv_stack(runtime_environment), instruction->k.i));
+            NEXT();
 
-        case SSOP_SPOKE:
-            surgescript_stack_poke(surgescript_renv_stack(runtime_environment), b.i, t(a));
-            break;
+        INSTRUCTION(SSOP_SPOKE)
+            surgescript_stack_poke(surgescript_renv_stack(runtime_environment), instruction->k.i, t(a));
+            NEXT();
 
-        case SSOP_PUSHN:
-            surgescript_stack_pushn(surgescript_renv_stack(runtime_environment), a.u);
-            break;
+        INSTRUCTION(SSOP_PUSHN)
+            surgescript_stack_pushn(surgescript_renv_stack(runtime_environment), k);
+            NEXT();
 
-        case SSOP_POPN:
-            surgescript_stack_popn(surgescript_renv_stack(runtime_environment), a.u);
-            break;
+        INSTRUCTION(SSOP_POPN)
+            surgescript_stack_popn(surgescript_renv_stack(runtime_environment), k);
+            NEXT();
 
         /* basic arithmetic */
-        case SSOP_INC:
-            if(a.u != 2)
-                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) + 1);
-            else
+        INSTRUCTION(SSOP_INC)
+            if(a == 2)
                 surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) + 1);
-            break;
-
-        case SSOP_DEC:
-            if(a.u != 2)
-                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) - 1);
+            else if(surgescript_var_fast_increment(t(a), 1.0))
+                QUICKEN(SSOP_INCN);
             else
+                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) + 1);
+            NEXT();
+
+        INSTRUCTION(SSOP_DEC)
+            if(a == 2)
                 surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) - 1);
-            break;
+            else if(surgescript_var_fast_increment(t(a), -1.0))
+                QUICKEN(SSOP_DECN);
+            else
+                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) - 1);
+            NEXT();
 
-        case SSOP_ADD:
-            surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) + surgescript_var_get_number(t(b)));
-            break;
+        INSTRUCTION(SSOP_ADD)
+            if(surgescript_var_fast_add(t(a), t(a), t(b)))
+                QUICKEN(SSOP_ADDN);
+            else
+                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) + surgescript_var_get_number(t(b)));
+            NEXT();
 
-        case SSOP_SUB:
-            surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) - surgescript_var_get_number(t(b)));
-            break;
+        INSTRUCTION(SSOP_SUB)
+            if(surgescript_var_fast_sub(t(a), t(a), t(b)))
+                QUICKEN(SSOP_SUBN);
+            else
+                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) - surgescript_var_get_number(t(b)));
+            NEXT();
 
-        case SSOP_MUL:
-            surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) * surgescript_var_get_number(t(b)));
-            break;
+        INSTRUCTION(SSOP_MUL)
+            if(surgescript_var_fast_mul(t(a), t(a), t(b)))
+                QUICKEN(SSOP_MULN);
+            else
+                surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) * surgescript_var_get_number(t(b)));
+            NEXT();
 
-        case SSOP_DIV:
+        INSTRUCTION(SSOP_DIV)
             /* division by zero should follow the IEEE-754 */
             surgescript_var_set_number(t(a), surgescript_var_get_number(t(a)) / surgescript_var_get_number(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_REM:
+        INSTRUCTION(SSOP_REM)
             /* the remainder a % b takes the sign of a (the dividend) */
             surgescript_var_set_number(t(a), fmod(surgescript_var_get_number(t(a)), surgescript_var_get_number(t(b))));
-            break;
+            NEXT();
 
-        case SSOP_NEG:
+        INSTRUCTION(SSOP_NEG)
             surgescript_var_set_number(t(a), -surgescript_var_get_number(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_LNOT:
+        INSTRUCTION(SSOP_LNOT)
             surgescript_var_set_bool(t(a), !surgescript_var_get_bool(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_LNOT2:
+        INSTRUCTION(SSOP_LNOT2)
             surgescript_var_set_bool(t(a), surgescript_var_get_bool(t(b)));
-            break;
+            NEXT();
 
         /* bitwise operations */
-        case SSOP_NOT:
+        INSTRUCTION(SSOP_NOT)
             surgescript_var_set_rawbits(t(a), ~surgescript_var_get_rawbits(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_AND:
+        INSTRUCTION(SSOP_AND)
             surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) & surgescript_var_get_rawbits(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_OR:
+        INSTRUCTION(SSOP_OR)
             surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) | surgescript_var_get_rawbits(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_XOR:
+        INSTRUCTION(SSOP_XOR)
             surgescript_var_set_rawbits(t(a), surgescript_var_get_rawbits(t(a)) ^ surgescript_var_get_rawbits(t(b)));
-            break;
+            NEXT();
+
+        INSTRUCTION(SSOP_CAT) { /* concatenation of the k topmost values of the stack */
+            const surgescript_stack_t* stack = surgescript_renv_stack(runtime_environment);
+            const surgescript_var_t* operand[SURGESCRIPT_PROGRAM_MAX_CONCAT];
+
+            for(uint32_t i = 0; i < k; i++)
+                operand[i] = surgescript_stack_peek_top(stack, k - 1 - i);
+
+            surgescript_var_concat(t(a), operand, k, surgescript_renv_objectmanager(runtime_environment));
+            NEXT();
+        }
+
+        INSTRUCTION(SSOP_STR) /* converts an object to a string using its toString() */
+            if(surgescript_var_is_objecthandle(t(a))) {
+                char* str = surgescript_var_get_string(t(a), surgescript_renv_objectmanager(runtime_environment));
+                surgescript_var_set_string(t(a), str);
+                ssfree(str);
+            }
+            NEXT();
 
         /* comparing & testing */
-        case SSOP_TEST:
-            if(a.u64 == b.u64)
+        INSTRUCTION(SSOP_TEST)
+            if(a == b)
                 surgescript_var_set_rawbits(_t[2], surgescript_var_get_rawbits(t(a)));
             else
                 surgescript_var_set_rawbits(_t[2], surgescript_var_get_rawbits(t(a)) & surgescript_var_get_rawbits(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_TCHK:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(t(a), b.i));
-            break;
+        INSTRUCTION(SSOP_TCHK)
+            surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(t(a), instruction->k.i));
+            NEXT();
 
-        case SSOP_TC01:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(_t[0], a.i) & surgescript_var_typecheck(_t[1], a.i));
-            break;
+        INSTRUCTION(SSOP_TC01)
+            surgescript_var_set_rawbits(_t[2], surgescript_var_typecheck(_t[0], instruction->k.i) & surgescript_var_typecheck(_t[1], instruction->k.i));
+            NEXT();
 
-        case SSOP_TCMP:
+        INSTRUCTION(SSOP_TCMP)
             surgescript_var_set_rawbits(_t[2], surgescript_var_typecode(t(a)) ^ surgescript_var_typecode(t(b)));
-            break;
+            NEXT();
 
-        case SSOP_CMP:
-            surgescript_var_set_rawbits(_t[2], surgescript_var_compare(t(a), t(b)));
-            break;
+        INSTRUCTION(SSOP_CMP)
+            if(surgescript_var_fast_compare(t(a), t(b), &cmp))
+                QUICKEN(SSOP_CMPN);
+            else
+                cmp = surgescript_var_compare(t(a), t(b));
+            surgescript_var_set_rawbits(_t[2], cmp);
+            NEXT();
 
         /* jumping */
-        case SSOP_JMP:
-            return a.u;
+        INSTRUCTION(SSOP_JMP)
+            JUMP(k);
 
-        case SSOP_JE:
+        INSTRUCTION(SSOP_JE)
             if(!surgescript_var_get_rawbits(_t[2]))
-                return a.u;
-            break;
+                JUMP(k);
+            NEXT();
 
-        case SSOP_JNE:
+        INSTRUCTION(SSOP_JNE)
             if(surgescript_var_get_rawbits(_t[2]))
-                return a.u;
-            break;
+                JUMP(k);
+            NEXT();
 
-        case SSOP_JL:
+        INSTRUCTION(SSOP_JL)
             if(surgescript_var_get_rawbits(_t[2]) < 0)
-                return a.u;
-            break;
+                JUMP(k);
+            NEXT();
 
-        case SSOP_JG:
+        INSTRUCTION(SSOP_JG)
             if(surgescript_var_get_rawbits(_t[2]) > 0)
-                return a.u;
-            break;
+                JUMP(k);
+            NEXT();
 
-        case SSOP_JLE:
+        INSTRUCTION(SSOP_JLE)
             if(surgescript_var_get_rawbits(_t[2]) <= 0)
-                return a.u;
-            break;
+                JUMP(k);
+            NEXT();
 
-        case SSOP_JGE:
+        INSTRUCTION(SSOP_JGE)
             if(surgescript_var_get_rawbits(_t[2]) >= 0)
-                return a.u;
-            break;
+                JUMP(k);
+            NEXT();
 
         /* function calls */
-        case SSOP_RET:
-            return ssarray_length(program->line);
+        INSTRUCTION(SSOP_RET)
+            PUBLISH_COUNT();
+            return NULL;
+
+        INSTRUCTION(SSOP_CALL)
+            PUBLISH_COUNT();
+            JUMP(ip + run_call_instruction(runtime_environment, instruction, program->callsite + k));
+
+        INSTRUCTION(SSOP_OPTCALL)
+            PUBLISH_COUNT();
+            JUMP(ip + run_optcall_instruction(runtime_environment, instruction, program->callsite + k));
+
+        INSTRUCTION(SSOP_DCALL)
+            PUBLISH_COUNT();
+            JUMP(ip + run_dcall_instruction(runtime_environment, program->callsite + k));
+
+        INSTRUCTION(SSOP_TAILCALL) {
+            surgescript_program_t* callee_program = prepare_tail_call(runtime_environment, program->callsite + k, tail_runtime_environment);
+            surgescript_objectclassid_t class_id = 0;
+            PUBLISH_COUNT();
+
+            /* run the callee in place of this program */
+            if(callee_program != NULL)
+                return callee_program;
+
+            /* a regular call is followed by a RET */
+            call_program(runtime_environment, program->callsite[k].number_of_params, program->callsite[k].program_name, program->callsite[k].method_id, NULL, &class_id);
+            JUMP(ip + finish_call(runtime_environment, program->callsite + k));
+        }
 
-        case SSOP_CALL:
-            return ip + run_call_instruction(program, runtime_environment, operation, a, b);
+        /* superinstructions */
+        INSTRUCTION(SSOP_CMPB)
+            if(surgescript_var_fast_compare(t(a), t(b), &cmp))
+                QUICKEN(SSOP_CMPBN);
+            else
+                cmp = surgescript_var_compare(t(a), t(b));
+            set_comparison(cmp, instruction->reserved, _t);
+            NEXT();
 
-        case SSOP_OPTCALL:
-            return ip + run_optcall_instruction(program, runtime_environment, operation, a, b);
-    }
+        INSTRUCTION(SSOP_CMPJE)
+            if(surgescript_var_fast_compare(t(a), t(b), &cmp))
+                QUICKEN(SSOP_CMPJEN);
+            else
+                cmp = surgescript_var_compare(t(a), t(b));
+            if(!set_comparison(cmp, instruction->reserved, _t)) {
+                surgescript_var_set_rawbits(_t[2], 0);
+                JUMP(k);
+            }
+            surgescript_var_set_rawbits(_t[2], 1);
+            NEXT();
 
-    /* next line */
-    return ip + 1;
+        INSTRUCTION(SSOP_TJE)
+            surgescript_var_set_rawbits(_t[2], surgescript_var_get_rawbits(t(b)));
+            if(!surgescript_var_get_rawbits(_t[2]))
+                JUMP(k);
+            NEXT();
 
-    /* done */
-    #undef t
-}
+        INSTRUCTION(SSOP_TJNE)
+            surgescript_var_set_rawbits(_t[2], surgescript_var_get_rawbits(t(b)));
+            if(surgescript_var_get_rawbits(_t[2]))
+                JUMP(k);
+            NEXT();
 
-/* run a SSOP_CALL instruction */
-unsigned int run_call_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_program_operation_t* operation, surgescript_program_operand_t a, surgescript_program_operand_t b)
-{
-    /* validate; this should never happen */
-    if(a.u >= ssarray_length(program->text))
-        return +1; /* next line; treat it as a NOP */
+        INSTRUCTION(SSOP_ADDF)
+            surgescript_var_set_number(t(a), program->constant[k].f + surgescript_var_get_number(t(b)));
+            NEXT();
 
-#if !(WANT_OPTIMIZED_PROGRAM_CALLS)
-    /* unoptimized version */
-    surgescript_objectclassid_t class_id = 0;
-    call_program(runtime_environment, b.u, program->text[a.u], NULL, &class_id);
-    return +1; /* next line */
-#else
-    /* optimized version */
-    surgescript_objectclassid_t class_id = 0;
-    bool is_locked = (operation[2].b.i != 0);
+        INSTRUCTION(SSOP_SUBF)
+            surgescript_var_set_number(t(a), surgescript_var_get_number(t(b)) - program->constant[k].f);
+            NEXT();
 
-    operation[2].b.i++; /* lock */
-    surgescript_program_t* callee_program = call_program(runtime_environment, b.u, program->text[a.u], NULL, &class_id);
-    operation[2].b.i--; /* unlock */
+        INSTRUCTION(SSOP_MULF)
+            surgescript_var_set_number(t(a), program->constant[k].f * surgescript_var_get_number(t(b)));
+            NEXT();
 
-    /* don't modify this call instruction if it's locked. This
-       prevents data corruption with (possibly indirect) recursion. */
-    if(is_locked) {
-        /* faster counter */
-        /*
-        if(operation[1].a.u == class_id)
-            operation[1].b.i++;
-        else
-            operation[1].b.i = 0;
-        */
-    }
-    /* count the number of consecutive times the program has been
-       executed with this same callee or equivalent object of the
-       same class (a: class_id; b: count) */
-    else if(operation[1].a.u == class_id) {
-        if(++operation[1].b.i >= OPTIMIZED_CALL_THRESHOLD) {
-            /* the program has run enough consecutive times with
-               the same or equivalent callee. Let's optimize. */
-
-            /* cache the program */
-            operation[2].a = surgescript_program_operand_p(callee_program);
-
-            /* let's change this instruction */
-            operation[0].instruction = SSOP_OPTCALL;
-        }
-    }
-    else {
-        /* new class. Reset the counter */
-        operation[1].a = surgescript_program_operand_u(class_id);
-        operation[1].b = surgescript_program_operand_i(1);
-    }
+        INSTRUCTION(SSOP_DIVF)
+            surgescript_var_set_number(t(a), surgescript_var_get_number(t(b)) / program->constant[k].f);
+            NEXT();
 
-    /* skip the two NOPs placed after every CALL */
-    return +3;
-#endif
-}
+        INSTRUCTION(SSOP_PUSHF)
+            surgescript_var_set_number(t(a), program->constant[k].f);
+            surgescript_stack_push_copy(surgescript_renv_stack(runtime_environment), t(a));
+            NEXT();
 
-/* run a SSOP_OPTCALL instruction */
-unsigned int run_optcall_instruction(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_program_operation_t* operation, surgescript_program_operand_t a, surgescript_program_operand_t b)
+        INSTRUCTION(SSOP_PUSHS)
+            surgescript_var_copy(t(a), program->literal[k]);
+            surgescript_stack_push_copy(surgescript_renv_stack(runtime_environment), t(a));
+            NEXT();
+
+        INSTRUCTION(SSOP_PUSHO)
+            surgescript_var_set_objecthandle(t(a), k);
+            surgescript_stack_push_copy(surgescript_renv_stack(runtime_environment), t(a));
+            NEXT();
+
+        INSTRUCTION(SSOP_PUSHSELF)
+            surgescript_var_set_objecthandle(t(a), surgescript_object_handle(surgescript_renv_owner(runtime_environment)));
+            surgescript_stack_push_copy(surgescript_renv_stack(runtime_environment), t(a));
+            NEXT();
+
+        /* quickened instructions */
+        INSTRUCTION(SSOP_ADDN)
+            if(!surgescript_var_fast_add(t(a), t(a), t(b)))
+                DEOPTIMIZE(SSOP_ADD);
+            NEXT();
+
+        INSTRUCTION(SSOP_SUBN)
+            if(!surgescript_var_fast_sub(t(a), t(a), t(b)))
+                DEOPTIMIZE(SSOP_SUB);
+            NEXT();
+
+        INSTRUCTION(SSOP_MULN)
+            if(!surgescript_var_fast_mul(t(a), t(a), t(b)))
+                DEOPTIMIZE(SSOP_MUL);
+            NEXT();
+
+        INSTRUCTION(SSOP_INCN)
+            if(!surgescript_var_fast_increment(t(a), 1.0))
+                DEOPTIMIZE(SSOP_INC);
+            NEXT();
+
+        INSTRUCTION(SSOP_DECN)
+            if(!surgescript_var_fast_increment(t(a), -1.0))
+                DEOPTIMIZE(SSOP_DEC);
+            NEXT();
+
+        INSTRUCTION(SSOP_CMPN)
+            if(!surgescript_var_fast_compare(t(a), t(b), &cmp))
+                DEOPTIMIZE(SSOP_CMP);
+            surgescript_var_set_rawbits(_t[2], cmp);
+            NEXT();
+
+        INSTRUCTION(SSOP_CMPBN)
+            if(!surgescript_var_fast_compare(t(a), t(b), &cmp))
+                DEOPTIMIZE(SSOP_CMPB);
+            set_comparison(cmp, instruction->reserved, _t);
+            NEXT();
+
+        INSTRUCTION(SSOP_CMPJEN)
+            if(!surgescript_var_fast_compare(t(a), t(b), &cmp))
+                DEOPTIMIZE(SSOP_CMPJE);
+            if(!set_comparison(cmp, instruction->reserved, _t)) {
+                surgescript_var_set_rawbits(_t[2], 0);
+                JUMP(k);
+            }
+            surgescript_var_set_rawbits(_t[2], 1);
+            NEXT();
+
+    #if !WANT_THREADED_DISPATCH
+        }
+    }
+    PUBLISH_COUNT();
+    return NULL;
+    #endif
+
+    /* done */
+    #undef PUBLISH_COUNT
+    #undef COUNT
+    #undef FETCH
+    #undef DEOPTIMIZE
+    #undef QUICKEN
+    #undef JUMP
+    #undef NEXT
+    #undef DISPATCH
+    #undef INSTRUCTION
+    #undef t
+}
+
+/* runs a C-program */
+void run_cprogram(surgescript_program_t* program, const surgescript_renv_t* runtime_environment)
+{
+    /* set the execution flag */
+    program->executed = true;
+
+    /* call C-function */
+    call_cfunction(program, surgescript_renv_owner(runtime_environment), surgescript_renv_stack(runtime_environment), *(surgescript_renv_tmp(runtime_environment) + 0));
+}
+
+/* calls the C-function of a C-program, storing its return value in return_value */
+void call_cfunction(surgescript_program_t* program, surgescript_object_t* object, surgescript_stack_t* stack, surgescript_var_t* return_value)
+{
+    surgescript_cprogram_t* cprogram = (surgescript_cprogram_t*)program;
+    const surgescript_var_t** param = program->arity > 0 ? alloca(program->arity * sizeof(*param)) : NULL;
+    surgescript_var_t* result = NULL;
+
+    /* grab parameters from the stack (stacked in left-to-right order) */
+    for(int i = 1; i <= program->arity; i++)
+        param[program->arity-i] = surgescript_stack_peek(stack, -i);
+
+    /* call a zero-copy C-function */
+    if(cprogram->cfunction_ex != NULL) {
+        surgescript_var_set_null(return_value);
+        cprogram->cfunction_ex(object, param, program->arity, return_value);
+        return;
+    }
+
+    /* call C-function */
+    result = cprogram->cfunction(object, param, program->arity);
+    if(result != NULL) {
+        surgescript_var_copy(return_value, result);
+        surgescript_var_destroy(result);
+    }
+    else
+        surgescript_var_set_null(return_value);
+}
+
+/* run a SSOP_CALL instruction */
+unsigned int run_call_instruction(const surgescript_renv_t* runtime_environment, surgescript_program_instruction_t* instruction, surgescript_program_callsite_t* callsite)
+{
+#if !(WANT_OPTIMIZED_PROGRAM_CALLS)
+    /* unoptimized version */
+    surgescript_objectclassid_t class_id = 0;
+    call_program(runtime_environment, callsite->number_of_params, callsite->program_name, callsite->method_id, NULL, &class_id);
+    return finish_call(runtime_environment, callsite);
+#else
+    /* optimized version */
+    surgescript_objectclassid_t class_id = 0;
+    bool is_locked = (callsite->lock != 0);
+
+    callsite->lock++; /* lock */
+    surgescript_program_t* callee_program = call_program(runtime_environment, callsite->number_of_params, callsite->program_name, callsite->method_id, NULL, &class_id);
+    callsite->lock--; /* unlock */
+    callsite->misses++;
+
+    /* don't modify this call instruction if it's locked. This
+       prevents data corruption with (possibly indirect) recursion. */
+    if(is_locked || callsite->megamorphic) {
+        ;
+    }
+    /* count the number of times this call site has been executed.
+       The callees need not be of the same class, since the cache
+       holds the programs of a few different classes */
+    else if(++callsite->count >= OPTIMIZED_CALL_THRESHOLD) {
+        /* the call site has run enough times. Let's optimize. */
+
+        /* cache the program */
+        add_to_cache(callsite, class_id, callee_program);
+
+        /* let's change this instruction */
+        instruction->opcode = SSOP_OPTCALL;
+    }
+
+    /* next line */
+    return finish_call(runtime_environment, callsite);
+#endif
+}
+
+/* run a SSOP_OPTCALL instruction */
+unsigned int run_optcall_instruction(const surgescript_renv_t* runtime_environment, surgescript_program_instruction_t* instruction, surgescript_program_callsite_t* callsite)
 {
 #if !(WANT_OPTIMIZED_PROGRAM_CALLS)
     /* no operation */
     return +1;
 #else
-    /* run the cached program. We can afford to cache because
+    /* run a cached program. We can afford to cache because
        surgescript_program_t* entries of the program pool will not
        change after execution */
-    surgescript_objectclassid_t expected_class_id = operation[1].a.u;
-    surgescript_program_t* expected_program = operation[2].a.p;
-    const char* program_name = program->text[a.u];
+    surgescript_objectclassid_t class_id = 0;
 
-    bool is_locked = (operation[2].b.i != 0);
-    operation[2].b.i++; /* lock */
-    bool success = (call_program(runtime_environment, b.u, program_name, expected_program, &expected_class_id) != NULL);
-    operation[2].b.i--; /* unlock */
+    bool is_locked = (callsite->lock != 0);
+    callsite->lock++; /* lock */
+    bool success = (call_program(runtime_environment, callsite->number_of_params, callsite->program_name, callsite->method_id, callsite, &class_id) != NULL);
+    callsite->lock--; /* unlock */
 
-    if(!success) {
+    if(success) {
+        callsite->hits++;
+    }
+    else {
 
-        /* Got an incompatible callee. Execution was aborted! */
+        /* Got a callee of a class that isn't cached.
+           Execution was aborted! Let's perform a regular lookup. */
+        surgescript_program_t* callee_program;
+
+        callsite->lock++; /* lock */
+        callee_program = call_program(runtime_environment, callsite->number_of_params, callsite->program_name, callsite->method_id, NULL, &class_id);
+        callsite->lock--; /* unlock */
+        callsite->misses++;
+
+        /* cache the program. If the cache is full, then this call
+           site is megamorphic: we restore the original CALL, which
+           always performs a regular lookup. We can't modify this
+           call instruction if it's locked. */
+        if(!is_locked && !add_to_cache(callsite, class_id, callee_program)) {
+            callsite->megamorphic = true;
+            callsite->cache_size = 0;
+            instruction->opcode = SSOP_CALL;
+        }
 
-        if(!is_locked) {
+    }
 
-            /* Let's de-optimize */
+    /* next line */
+    return finish_call(runtime_environment, callsite);
+#endif
+}
 
-            /* reset the counter */
-            operation[1].a = surgescript_program_operand_u(0);
-            operation[1].b = surgescript_program_operand_i(0);
-            operation[2].a = surgescript_program_operand_p(NULL);
+/* run a SSOP_DCALL instruction */
+unsigned int run_dcall_instruction(const surgescript_renv_t* runtime_environment, surgescript_program_callsite_t* callsite)
+{
+    surgescript_program_t* program = callsite->target;
+    surgescript_object_t* object = surgescript_renv_owner(runtime_environment);
+    surgescript_stack_t* stack = surgescript_renv_stack(runtime_environment);
 
-            /* restore the original CALL */
-            operation[0].instruction = SSOP_CALL;
+    /* the callee is known in advance: either the owner or a system object.
+       System objects are not supposed to be destroyed, but let's be safe */
+    if(callsite->handle != 0) {
+        surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(runtime_environment);
+        if(!surgescript_objectmanager_exists(manager, callsite->handle)) {
+            surgescript_objectclassid_t class_id = 0;
+            call_program(runtime_environment, callsite->number_of_params, callsite->program_name, callsite->method_id, NULL, &class_id);
+            return finish_call(runtime_environment, callsite);
+        }
+        object = surgescript_objectmanager_get(manager, callsite->handle);
+    }
 
-            /* run the same instruction again */
-            return +0;
+    /* the arity has been checked at link time */
+    surgescript_stack_pushenv(stack);
+    if(program->run == run_cprogram) {
+        /* call the C-function directly */
+        call_cfunction(program, object, stack, *(surgescript_renv_tmp(runtime_environment) + 0));
+    }
+    else {
+        /* the parameters are pushed onto the stack (left-to-right) */
+        surgescript_renv_t callee_runtime_environment = {
+            object,
+            stack,
+            surgescript_object_heap(object),
+            surgescript_renv_programpool(runtime_environment),
+            surgescript_renv_objectmanager(runtime_environment),
+            surgescript_renv_tmp(runtime_environment),
+            NULL,
+            surgescript_object_handle(surgescript_renv_owner(runtime_environment))
+        };
 
-        }
-        else {
+        program->run(program, &callee_runtime_environment);
+    }
+    surgescript_stack_popenv(stack);
 
-            /* We can't de-optimize */
+    /* next line */
+    return finish_call(runtime_environment, callsite);
+}
 
-            /* execution was aborted, but this CALL instruction is
-               locked. Let's perform a regular lookup. Running
-               call_program() twice is slightly slower than having
-               no optimization at all, so this shouldn't happen often. */
-            call_program(runtime_environment, b.u, program_name, NULL, &expected_class_id);
+/* prepares a SSOP_TAILCALL instruction, reusing the stack frame of the caller.
+   Returns the program that will run in place of the caller with the runtime
+   environment written to callee_runtime_environment, or NULL if the callee
+   can't reuse the frame. In that case, a regular call must be performed */
+surgescript_program_t* prepare_tail_call(const surgescript_renv_t* caller_runtime_environment, const surgescript_program_callsite_t* callsite, surgescript_renv_t* callee_runtime_environment)
+{
+#if !(WANT_TAIL_CALLS)
+    /* unoptimized version */
+    return NULL;
+#else
+    surgescript_stack_t* stack = surgescript_renv_stack(caller_runtime_environment);
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(caller_runtime_environment);
+    surgescript_programpool_t* pool = surgescript_renv_programpool(caller_runtime_environment);
+    const surgescript_var_t* callee = surgescript_stack_peek_top(stack, callsite->number_of_params); /* 1st param, left-to-right */
+    surgescript_objecthandle_t object_handle = surgescript_var_get_objecthandle(callee);
+    int number_of_params = callsite->number_of_params;
+    surgescript_program_t* program;
+    surgescript_object_t* object;
 
-            /* signal that this event is undesirable */
-            /*operation[1].b.i -= OPTIMIZED_CALL_THRESHOLD;*/
+    /* surgescript can also call programs on primitive types */
+    if(!surgescript_var_is_objecthandle(callee))
+        number_of_params++; /* object_handle points to the appropriate wrapper */
 
-            /* testing */
-            /*printf("undesirable event %u %s\n", expected_class_id, program_name);*/
+    /* the callee must exist */
+    if(!surgescript_objectmanager_exists(manager, object_handle))
+        return NULL;
 
-        }
-    }
-    else {
+    /* find the program */
+    object = surgescript_objectmanager_get(manager, object_handle);
+    program = surgescript_programpool_dispatch(surgescript_object_vtable(object), callsite->method_id);
+    if(program == NULL)
+        program = surgescript_programpool_get(pool, surgescript_object_name(object), callsite->program_name);
+
+    /* a C-program has no frame to reuse. Errors are reported by the regular call */
+    if(program == NULL || program->run != run_program || program->arity != number_of_params)
+        return NULL;
+
+    /* the frame will be reused by run_program() */
+    *callee_runtime_environment = (surgescript_renv_t){
+        object,
+        stack,
+        surgescript_object_heap(object),
+        pool,
+        manager,
+        surgescript_renv_tmp(caller_runtime_environment),
+        NULL,
+        surgescript_object_handle(surgescript_renv_owner(caller_runtime_environment))
+    };
 
-        /* Optimized execution was successful! */
-        ;
+    /* done */
+    return program;
+#endif
+}
 
+/* pops the cells of a call site after the call ends; returns +1 (next line) */
+unsigned int finish_call(const surgescript_renv_t* runtime_environment, const surgescript_program_callsite_t* callsite)
+{
+    if(callsite->pop_count > 0)
+        surgescript_stack_popn(surgescript_renv_stack(runtime_environment), callsite->pop_count);
+
+    return +1;
+}
+
+/* finds the cached program of a class of callee; returns NULL if there is none */
+surgescript_program_t* cached_program(const surgescript_program_callsite_t* callsite, surgescript_objectclassid_t class_id)
+{
+    for(int i = 0; i < callsite->cache_size; i++) {
+        if(callsite->cache[i].class_id == class_id)
+            return callsite->cache[i].program;
     }
 
-    /* skip the two NOPs placed after every CALL */
-    return +3;
-#endif
+    return NULL;
+}
+
+/* adds a program to the cache of a call site. Returns false if the cache is full */
+bool add_to_cache(surgescript_program_callsite_t* callsite, surgescript_objectclassid_t class_id, surgescript_program_t* program)
+{
+    if(cached_program(callsite, class_id) != NULL)
+        return true;
+    else if(callsite->cache_size >= CALLSITE_CACHE_SIZE)
+        return false;
+
+    callsite->cache[callsite->cache_size].class_id = class_id;
+    callsite->cache[callsite->cache_size].program = program;
+    callsite->cache_size++;
+    return true;
 }
 
 /* calls a program */
-surgescript_program_t* call_program(const surgescript_renv_t* caller_runtime_environment, int number_of_given_params, const char* program_name, surgescript_program_t* program, surgescript_objectclassid_t* inout_class_id)
+surgescript_program_t* call_program(const surgescript_renv_t* caller_runtime_environment, int number_of_given_params, const char* program_name, int method_id, const surgescript_program_callsite_t* cache, surgescript_objectclassid_t* out_class_id)
 {
+    surgescript_program_t* program = NULL;
+
     /* preparing the stack */
     surgescript_stack_t* stack = surgescript_renv_stack(caller_runtime_environment);
     surgescript_stack_pushenv(stack);
@@ -874,16 +1548,18 @@ surgescript_program_t* call_program(const surgescript_renv_t* caller_runtime_env
         const char* object_name = surgescript_object_name(object);
         surgescript_objectclassid_t class_id = surgescript_object_class_id(object);
 
-        if(program == NULL) {
-            /* do a program lookup. this is a bottleneck!
-               use a cached program if possible */
-            program = surgescript_programpool_get(pool, object_name, program_name);
-            *inout_class_id = class_id;
+        *out_class_id = class_id;
+        if(cache == NULL) {
+            /* find the program in the method table of the class. If
+               there is no method ID, do a program lookup by name. this
+               is a bottleneck! use a cached program if possible */
+            program = surgescript_programpool_dispatch(surgescript_object_vtable(object), method_id);
+            if(program == NULL)
+                program = surgescript_programpool_get(pool, object_name, program_name);
         }
-        else if(class_id != *inout_class_id) {
-            /* we're using a cached program, but the callee
-               is incompatible. Let's abort the execution. */
-            program = NULL;
+        else if((program = cached_program(cache, class_id)) == NULL) {
+            /* we're using the cache of a call site, but the class
+               of the callee isn't there. Let's abort the execution. */
             goto cleanup;
         }
 #if 0
@@ -981,6 +1657,9 @@ bool is_jump_instruction(surgescript_program_operator_t instruction)
         case SSOP_JGE:
         case SSOP_JL:
         case SSOP_JLE:
+        case SSOP_TJE:
+        case SSOP_TJNE:
+        case SSOP_CMPJE:
             return true;
         default:
             return false;
@@ -1013,6 +1692,1176 @@ bool remove_labels(surgescript_program_t* program)
     return true;
 }
 
+/* peephole optimizer: fuses common sequences of operations into superinstructions
+   and removes redundant operations. The labels must have been removed already */
+void optimize_program(surgescript_program_t* program)
+{
+    bool changed;
+
+    /* a fusion may enable another one, so repeat until there is nothing left to do */
+    do {
+        changed = fuse_operations(program);
+        changed = remove_nops(program) || changed;
+    } while(changed);
+}
+
+/* cleans up the control flow of a program whose labels have been removed */
+void simplify_control_flow(surgescript_program_t* program)
+{
+    bool changed;
+
+    /* removing code may create new chains of jumps, and vice-versa */
+    do {
+        changed = thread_jumps(program);
+        changed = remove_unreachable_code(program) || changed;
+        changed = remove_nops(program) || changed;
+    } while(changed);
+}
+
+/* collapses chains of jumps: a jump to an unconditional jump goes straight
+   to the final destination, and a jump to a RET becomes a RET. Jumps to the
+   next line are replaced by NOPs. Returns true if anything has changed */
+bool thread_jumps(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int length = ssarray_length(program->line);
+    bool changed = false;
+
+    for(int i = 0; i < length; i++) {
+        surgescript_program_operator_t instruction = line[i].instruction;
+        unsigned target = line[i].a.u;
+
+        if(!is_jump_instruction(instruction))
+            continue;
+
+        /* follow the chain. The number of hops is bounded, since jumps may form a cycle */
+        for(int hops = 0; hops < length && target < length && line[target].instruction == SSOP_JMP && line[target].a.u != target; hops++)
+            target = line[target].a.u;
+
+        if(target != line[i].a.u) {
+            line[i].a.u = target;
+            changed = true;
+        }
+
+        /* jmp to ret */
+        if(instruction == SSOP_JMP && target < length && line[target].instruction == SSOP_RET) {
+            line[i] = line[target];
+            changed = true;
+        }
+
+        /* jumps to the next line (the superinstructions also change the registers) */
+        else if(target == i + 1 && instruction >= SSOP_JMP && instruction <= SSOP_JLE) {
+            line[i] = (surgescript_program_operation_t){ SSOP_NOP, surgescript_program_operand_u(0), surgescript_program_operand_u(0) };
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/* replaces the operations that can't be reached from the first line of the
+   program by NOPs (e.g., the code after a RET or a JMP). Breakpoints are kept.
+   Returns true if any operations have been removed */
+bool remove_unreachable_code(surgescript_program_t* program)
+{
+    surgescript_program_operation_t* line = program->line;
+    int length = ssarray_length(program->line);
+    bool* reachable = ssmalloc((length + 1) * sizeof(*reachable));
+    int* pending = ssmalloc((length + 1) * sizeof(*pending));
+    int pending_count = 0;
+    bool removed = false;
+
+    /* flood fill, starting at the first line */
+    memset(reachable, 0, (length + 1) * sizeof(*reachable));
+    if(length > 0) {
+        reachable[0] = true;
+        pending[pending_count++] = 0;
+    }
+
+    while(pending_count > 0) {
+        int i = pending[--pending_count];
+        surgescript_program_operator_t instruction = line[i].instruction;
+        unsigned successor[2];
+        int successor_count = 0;
+
+        if(instruction != SSOP_JMP && instruction != SSOP_RET)
+            successor[successor_count++] = i + 1;
+        if(is_jump_instruction(instruction))
+            successor[successor_count++] = line[i].a.u;
+
+        for(int j = 0; j < successor_count; j++) {
+            if(successor[j] < length && !reachable[successor[j]]) {
+                reachable[successor[j]] = true;
+                pending[pending_count++] = successor[j];
+            }
+        }
+    }
+
+    /* remove the dead code */
+    for(int i = 0; i < length; i++) {
+        if(!reachable[i] && line[i].instruction != SSOP_NOP) {
+            line[i] = (surgescript_program_operation_t){ SSOP_NOP, surgescript_program_operand_u(0), surgescript_program_operand_u(0) };
+            removed = true;
+        }
+    }
+
+    ssfree(pending);
+    ssfree(reachable);
+    return removed;
+}
+
+/* a single pass of the peephole optimizer. Fused operations are replaced by NOPs,
+   to be removed later. Returns true if any operations were fused */
+bool fuse_operations(surgescript_program_t* program)
+{
+    #define OP(j)            line[i + (j)].instruction
+    #define A(j)             line[i + (j)].a.u
+    #define B(j)             line[i + (j)].b.u
+    #define IS_SHORT_REG(r)  ((r) < SURGESCRIPT_PROGRAM_MAX_REGISTERS) /* fits in a byte */
+    #define SET(j, op, x, y) (line[i + (j)] = (surgescript_program_operation_t){ (op), (x), (y) })
+    #define DROP(j)          SET(j, SSOP_NOP, surgescript_program_operand_u(0), surgescript_program_operand_u(0))
+
+    surgescript_program_operation_t* line = program->line;
+    int length = ssarray_length(program->line);
+    bool* is_target = ssmalloc((length + 1) * sizeof(*is_target));
+    bool changed = false;
+
+    /* find the targets of the jumps. We can't fuse a sequence
+       of operations if a jump lands in the middle of it */
+    memset(is_target, 0, (length + 1) * sizeof(*is_target));
+    for(int i = 0; i < length; i++) {
+        if(is_jump_instruction(line[i].instruction) && line[i].a.u <= length)
+            is_target[line[i].a.u] = true;
+    }
+
+    /* fuse operations */
+    for(int i = 0; i < length; i++) {
+        int n = 1; /* length of the sequence of operations */
+        while(i + n < length && n < 4 && !is_target[i + n])
+            n++;
+
+        /* cmp x, y; movb t0, true; jcc L; movb t0, false; L: */
+        if(n >= 4 && OP(0) == SSOP_CMP && IS_SHORT_REG(B(0)) &&
+           OP(1) == SSOP_MOVB && A(1) == 0 && line[i+1].b.b &&
+           OP(3) == SSOP_MOVB && A(3) == 0 && !line[i+3].b.b &&
+           A(2) == i + 4 && (OP(2) == SSOP_JG || OP(2) == SSOP_JGE || OP(2) == SSOP_JL || OP(2) == SSOP_JLE)
+        ) {
+            unsigned condition = OP(2) == SSOP_JG ? CONDITION_G : (OP(2) == SSOP_JGE ? CONDITION_GE : (OP(2) == SSOP_JL ? CONDITION_L : CONDITION_LE));
+            SET(0, SSOP_CMPB, line[i].a, surgescript_program_operand_u(B(0) | (condition << 8)));
+            DROP(1); DROP(2); DROP(3);
+            changed = true;
+            i += 3;
+        }
+
+        /* cmp x, y; lnot t0, t2 (or lnot2 t0, t2) */
+        else if(n >= 2 && OP(0) == SSOP_CMP && IS_SHORT_REG(B(0)) &&
+           (OP(1) == SSOP_LNOT || OP(1) == SSOP_LNOT2) && A(1) == 0 && B(1) == 2
+        ) {
+            unsigned condition = OP(1) == SSOP_LNOT ? CONDITION_EQ : CONDITION_NE;
+            SET(0, SSOP_CMPB, line[i].a, surgescript_program_operand_u(B(0) | (condition << 8)));
+            DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* test r, r; je L (or jne L) */
+        else if(n >= 2 && OP(0) == SSOP_TEST && A(0) == B(0) && (OP(1) == SSOP_JE || OP(1) == SSOP_JNE)) {
+            SET(0, OP(1) == SSOP_JE ? SSOP_TJE : SSOP_TJNE, line[i+1].a, line[i].a);
+            DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* cmpb x, y; tje L, t0 */
+        else if(n >= 2 && OP(0) == SSOP_CMPB && IS_SHORT_REG(A(0)) && OP(1) == SSOP_TJE && B(1) == 0) {
+            SET(0, SSOP_CMPJE, line[i+1].a, surgescript_program_operand_u(A(0) | ((B(0) & 0xFF) << 8) | ((B(0) >> 8) << 16)));
+            DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* movf d, c; add d, s (or mul d, s) */
+        else if(n >= 2 && OP(0) == SSOP_MOVF && IS_SHORT_REG(A(0)) &&
+           (OP(1) == SSOP_ADD || OP(1) == SSOP_MUL) && A(1) == A(0) && B(1) != A(0) && IS_SHORT_REG(B(1))
+        ) {
+            SET(0, OP(1) == SSOP_ADD ? SSOP_ADDF : SSOP_MULF, surgescript_program_operand_u(A(0) | (B(1) << 8)), line[i].b);
+            DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* movf d, c; sub s, d (or div s, d); xchg s, d */
+        else if(n >= 3 && OP(0) == SSOP_MOVF && IS_SHORT_REG(A(0)) &&
+           (OP(1) == SSOP_SUB || OP(1) == SSOP_DIV) && B(1) == A(0) && A(1) != A(0) && IS_SHORT_REG(A(1)) &&
+           OP(2) == SSOP_XCHG && ((A(2) == A(1) && B(2) == A(0)) || (A(2) == A(0) && B(2) == A(1)))
+        ) {
+            surgescript_program_operand_t c = line[i].b;
+            SET(0, OP(1) == SSOP_SUB ? SSOP_SUBF : SSOP_DIVF, surgescript_program_operand_u(A(0) | (A(1) << 8)), c);
+            SET(1, SSOP_MOVF, line[i+1].a, c); /* the constant ends up in s */
+            DROP(2);
+            changed = true;
+            i += 2;
+        }
+
+        /* movf r, c; push r (also movs, movo, self) */
+        else if(n >= 2 && OP(1) == SSOP_PUSH && A(1) == A(0) &&
+           (OP(0) == SSOP_MOVF || OP(0) == SSOP_MOVS || OP(0) == SSOP_MOVO || OP(0) == SSOP_SELF)
+        ) {
+            surgescript_program_operator_t op = OP(0) == SSOP_MOVF ? SSOP_PUSHF : (OP(0) == SSOP_MOVS ? SSOP_PUSHS : (OP(0) == SSOP_MOVO ? SSOP_PUSHO : SSOP_PUSHSELF));
+            SET(0, op, line[i].a, line[i].b);
+            DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* call f, n; popn m */
+        else if(n >= 2 && OP(0) == SSOP_CALL && B(0) <= 0xFFFF && OP(1) == SSOP_POPN && A(1) > 0 && A(1) <= 0xFFFF) {
+            SET(0, SSOP_CALL, line[i].a, surgescript_program_operand_u(B(0) | (A(1) << 16)));
+            DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* mov r, r (or xchg r, r) */
+        else if((OP(0) == SSOP_MOV || OP(0) == SSOP_XCHG) && A(0) == B(0)) {
+            DROP(0);
+            changed = true;
+        }
+
+        /* mov x, y; mov y, x */
+        else if(n >= 2 && OP(0) == SSOP_MOV && OP(1) == SSOP_MOV && A(1) == B(0) && B(1) == A(0)) {
+            DROP(1); /* x and y are already equal */
+            changed = true;
+            i += 1;
+        }
+
+        /* xchg x, y; xchg x, y (or xchg y, x) */
+        else if(n >= 2 && OP(0) == SSOP_XCHG && OP(1) == SSOP_XCHG &&
+           ((A(1) == A(0) && B(1) == B(0)) || (A(1) == B(0) && B(1) == A(0)))
+        ) {
+            DROP(0); DROP(1);
+            changed = true;
+            i += 1;
+        }
+
+        /* mov x, y; mov z, x; <overwrite x> */
+        else if(n >= 3 && OP(0) == SSOP_MOV && OP(1) == SSOP_MOV && B(1) == A(0) &&
+           A(0) != B(0) && A(1) != A(0) && overwrites_register(program, &line[i+2], A(0))
+        ) {
+            SET(1, SSOP_MOV, line[i+1].a, line[i].b); /* mov z, y */
+            DROP(0);
+            changed = true;
+            i += 1;
+        }
+    }
+
+    ssfree(is_target);
+    return changed;
+
+    #undef DROP
+    #undef SET
+    #undef IS_SHORT_REG
+    #undef B
+    #undef A
+    #undef OP
+}
+
+/* removes the NOPs of the program (except breakpoints), correcting the
+   jump instructions. Returns true if any operation was removed */
+bool remove_nops(surgescript_program_t* program)
+{
+    int length = ssarray_length(program->line);
+    surgescript_program_operation_t* line = ssmalloc((length + 1) * sizeof(*line));
+    int* new_index = ssmalloc((length + 1) * sizeof(*new_index));
+    bool removed = false;
+
+    /* remove the NOPs; new_index[i] is the new line of the (old) i-th line,
+       or of the line that follows it if it has been removed */
+    memcpy(line, program->line, length * sizeof(*line));
+    ssarray_reset(program->line);
+    for(int i = 0; i < length; i++) {
+        new_index[i] = ssarray_length(program->line);
+        if(line[i].instruction != SSOP_NOP || line[i].a.i == -1) /* a.i == -1 is a breakpoint */
+            ssarray_push(program->line, line[i]);
+        else
+            removed = true;
+    }
+    new_index[length] = ssarray_length(program->line);
+
+    /* correct the jumps */
+    if(removed) {
+        for(int i = 0; i < ssarray_length(program->line); i++) {
+            if(is_jump_instruction(program->line[i].instruction) && program->line[i].a.u <= length)
+                program->line[i].a.u = new_index[program->line[i].a.u];
+        }
+    }
+
+    ssfree(new_index);
+    ssfree(line);
+    return removed;
+}
+
+/* does the operation write to register t[r] without reading it? */
+bool overwrites_register(const surgescript_program_t* program, const surgescript_program_operation_t* operation, unsigned r)
+{
+    switch(operation->instruction) {
+        case SSOP_SELF:
+        case SSOP_CALLER:
+        case SSOP_MOVN:
+        case SSOP_MOVB:
+        case SSOP_MOVF:
+        case SSOP_MOVO:
+        case SSOP_MOVX:
+        case SSOP_ALLOC:
+        case SSOP_PEEK:
+        case SSOP_SPEEK:
+        case SSOP_POP:
+        case SSOP_CAT:
+            return operation->a.u == r;
+
+        case SSOP_MOVS:
+            return operation->a.u == r && operation->b.u < ssarray_length(program->text);
+
+        case SSOP_MOV:
+        case SSOP_NEG:
+        case SSOP_LNOT:
+        case SSOP_LNOT2:
+        case SSOP_NOT:
+            return operation->a.u == r && operation->b.u != r;
+
+        default:
+            return false;
+    }
+}
+
+/* makes sure that the program ends with a RET instruction. With it, the
+   dispatch loop doesn't need to check the instruction pointer for bounds */
+void add_sentinel(surgescript_program_t* program)
+{
+    int length = ssarray_length(program->line);
+    bool needs_sentinel = (length == 0 || program->line[length-1].instruction != SSOP_RET);
+
+    /* a jump may target the end of the program */
+    for(int i = 0; i < length && !needs_sentinel; i++) {
+        if(is_jump_instruction(program->line[i].instruction) && program->line[i].a.u >= length)
+            needs_sentinel = true;
+    }
+
+    if(needs_sentinel) {
+        surgescript_program_operand_t zero = surgescript_program_operand_u(0);
+        surgescript_program_operation_t ret = { SSOP_RET, zero, zero };
+        ssarray_push(program->line, ret);
+    }
+}
+
+/* prepares a program for execution, generating its pre-decoded code */
+void prepare_program(surgescript_program_t* program)
+{
+    /* nothing to do */
+    if(ssarray_length(program->code) > 0)
+        return;
+
+    /* finalize the operations */
+    remove_labels(program);
+#if WANT_CONTROL_FLOW_CLEANUP
+    simplify_control_flow(program);
+#endif
+#if WANT_SUPERINSTRUCTIONS
+    optimize_program(program);
+#endif
+    add_sentinel(program);
+
+    /* lower the operations */
+    generate_code(program);
+}
+
+/* binds the call sites of a program to the IDs of the names of the called programs */
+void link_callsites(surgescript_program_t* program, const surgescript_renv_t* runtime_environment)
+{
+    surgescript_programpool_t* pool = surgescript_renv_programpool(runtime_environment);
+
+    for(int i = 0; i < ssarray_length(program->callsite); i++) {
+        surgescript_program_callsite_t* callsite = &(program->callsite[i]);
+        callsite->method_id = surgescript_programpool_method_id(pool, callsite->program_name);
+    }
+
+#if WANT_STATIC_BINDING
+    bind_callsites(program, runtime_environment);
+#if WANT_INLINING
+    /* the pre-decoded code is generated again, so we link the new call sites */
+    if(inline_callsites(program)) {
+        for(int i = 0; i < ssarray_length(program->callsite); i++) {
+            surgescript_program_callsite_t* callsite = &(program->callsite[i]);
+            callsite->method_id = surgescript_programpool_method_id(pool, callsite->program_name);
+        }
+
+        bind_callsites(program, runtime_environment);
+    }
+#endif
+#endif
+}
+
+/* binds the calls on "this" and on system objects to the called programs,
+   rewriting them as SSOP_DCALL. There is no subclassing apart from Object,
+   so these callees are known at link time. We find them by tracking the
+   stack symbolically: each stacked cell holds the owner, a system object
+   or an unknown value. Calls on "this" made by the programs of Object are
+   not bound, since these programs are shared by all classes */
+void bind_callsites(surgescript_program_t* program, const surgescript_renv_t* runtime_environment)
+{
+    #define UNKNOWN_CELL    -1 /* symbolic values of the cells */
+    #define OWNER_CELL      0 /* any other value is the handle of a system object */
+
+    surgescript_programpool_t* pool = surgescript_renv_programpool(runtime_environment);
+    surgescript_objectmanager_t* manager = surgescript_renv_objectmanager(runtime_environment);
+    surgescript_object_t* owner = surgescript_renv_owner(runtime_environment);
+    const surgescript_program_operation_t* line = program->line;
+    int length = ssarray_length(program->line);
+    bool can_bind_owner = !is_inherited_program(pool, program);
+    int* depth = ssmalloc((length + 1) * sizeof(*depth)); /* depth of the stack before each line */
+    int* first_source = ssmalloc((length + 1) * sizeof(*first_source)); /* first forward jump to each line, or -1 */
+    bool* is_loop = ssmalloc((length + 1) * sizeof(*is_loop)); /* is the line the target of a backward jump? */
+    SSARRAY(int64_t, cell);
+    ssarray_init(cell);
+
+    /* find the targets of the jumps */
+    for(int i = 0; i <= length; i++) {
+        first_source[i] = -1;
+        is_loop[i] = false;
+    }
+    for(int i = 0; i < length; i++) {
+        if(is_jump_instruction(line[i].instruction) && line[i].a.u <= length) {
+            int target = line[i].a.u;
+            if(target <= i)
+                is_loop[target] = true;
+            else if(first_source[target] < 0)
+                first_source[target] = i;
+        }
+    }
+
+    /* simulate the stack */
+    for(int i = 0; i < length; i++) {
+        const surgescript_program_operation_t* operation = &line[i];
+        int size = ssarray_length(cell);
+
+        /* merge the paths that lead to this line. The cells that are kept
+           have not been touched since the first jump to this line. We
+           require the jumps to have the same stack depth */
+        depth[i] = size;
+        if(is_loop[i]) {
+            for(int j = 0; j < size; j++)
+                cell[j] = UNKNOWN_CELL;
+        }
+        else if(first_source[i] >= 0) {
+            int keep = size;
+            for(int j = first_source[i]; j < i; j++) {
+                keep = ssmin(keep, depth[j]);
+                if(is_jump_instruction(line[j].instruction) && line[j].a.u == i && depth[j] != size)
+                    keep = 0;
+            }
+            for(int j = keep; j < size; j++)
+                cell[j] = UNKNOWN_CELL;
+        }
+
+        /* update the stack */
+        switch(operation->instruction) {
+            case SSOP_PUSHSELF:
+                ssarray_push(cell, OWNER_CELL);
+                break;
+
+            case SSOP_PUSHO:
+                ssarray_push(cell, (int64_t)operation->b.u);
+                break;
+
+            case SSOP_PUSH:
+                /* self t[r]; push t[r] or movo t[r], h; push t[r] */
+                if(i > 0 && !is_loop[i] && first_source[i] < 0 && line[i-1].a.u == operation->a.u) {
+                    if(line[i-1].instruction == SSOP_SELF) {
+                        ssarray_push(cell, OWNER_CELL);
+                        break;
+                    }
+                    else if(line[i-1].instruction == SSOP_MOVO) {
+                        ssarray_push(cell, (int64_t)line[i-1].b.u);
+                        break;
+                    }
+                }
+                ssarray_push(cell, UNKNOWN_CELL);
+                break;
+
+            case SSOP_PUSHF:
+            case SSOP_PUSHS:
+                ssarray_push(cell, UNKNOWN_CELL);
+                break;
+
+            case SSOP_PUSHN:
+                for(int j = 0; j < operation->a.u; j++)
+                    ssarray_push(cell, UNKNOWN_CELL);
+                break;
+
+            case SSOP_POP:
+                ssarray_remove(cell, ssarray_length(cell) - 1);
+                break;
+
+            case SSOP_POPN:
+                for(int j = 0; j < operation->a.u; j++)
+                    ssarray_remove(cell, ssarray_length(cell) - 1);
+                break;
+
+            case SSOP_SPOKE:
+                /* stack[base + b] is a local variable */
+                if(operation->b.i >= 1 && operation->b.i <= size)
+                    cell[operation->b.i - 1] = UNKNOWN_CELL;
+                break;
+
+            case SSOP_CALL: {
+                /* code[i] is generated from line[i] (see generate_code()) */
+                surgescript_program_instruction_t* instruction = &(program->code[i]);
+                surgescript_program_callsite_t* callsite;
+                int callee;
+
+                if(instruction->opcode != SSOP_CALL)
+                    break; /* invalid call */
+
+                callsite = &(program->callsite[instruction->k.u]);
+                callee = size - 1 - callsite->number_of_params;
+                if(callee >= 0 && callsite->method_id >= 0 && cell[callee] != UNKNOWN_CELL) {
+                    surgescript_program_t* target = NULL;
+                    surgescript_objecthandle_t handle = (surgescript_objecthandle_t)cell[callee];
+
+                    if(handle == OWNER_CELL) {
+                        if(can_bind_owner)
+                            target = surgescript_programpool_dispatch(surgescript_object_vtable(owner), callsite->method_id);
+                    }
+                    else if(surgescript_objectmanager_exists(manager, handle) && handle == surgescript_objectmanager_system_object(manager, surgescript_object_name(surgescript_objectmanager_get(manager, handle)))) {
+                        surgescript_object_t* object = surgescript_objectmanager_get(manager, handle);
+                        target = surgescript_programpool_dispatch(surgescript_object_vtable(object), callsite->method_id);
+                    }
+
+                    /* a mismatched arity is reported by the regular call */
+                    if(target != NULL && target->arity == callsite->number_of_params) {
+                        callsite->target = target;
+                        callsite->handle = handle;
+                        instruction->opcode = SSOP_DCALL;
+                        target->referenced = true;
+                    }
+                }
+
+                for(int j = 0; j < callsite->pop_count; j++)
+                    ssarray_remove(cell, ssarray_length(cell) - 1);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    ssarray_release(cell);
+    ssfree(is_loop);
+    ssfree(first_source);
+    ssfree(depth);
+
+    #undef OWNER_CELL
+    #undef UNKNOWN_CELL
+}
+
+/* substitutes the bodies of small programs into the call sites bound to
+   "this" (see bind_callsites()), regenerating the pre-decoded code. The
+   parameters and the local variables of an inlined program are moved to
+   new local variables of the caller, so no stack frame is needed. Returns
+   true if any call site has been inlined */
+bool inline_callsites(surgescript_program_t* program)
+{
+    int length = ssarray_length(program->line);
+    int first_register = SURGESCRIPT_PROGRAM_TEMPS + program->arity + program->local_count; /* registers of the inlined frames */
+    int extra_locals = 0; /* the inlined frames share the new local variables */
+    bool inlined = false; /* has any call site been inlined? */
+    surgescript_program_operation_t* line = ssmalloc((length + 1) * sizeof(*line));
+    int* new_index = ssmalloc((length + 1) * sizeof(*new_index));
+    surgescript_program_operand_t zero = surgescript_program_operand_u(0);
+    SSARRAY(bool, is_inlined); /* is_inlined[j] is true if the j-th new line comes from an inlined program */
+    ssarray_init(is_inlined);
+
+    /* the function header reserves the local variables. If there is none, add one */
+    memcpy(line, program->line, length * sizeof(*line));
+    ssarray_reset(program->line);
+    if(program->local_count == 0) {
+        surgescript_program_operation_t header = { SSOP_PUSHN, zero, zero };
+        ssarray_push(program->line, header);
+        ssarray_push(is_inlined, false);
+    }
+
+    /* expand the call sites */
+    for(int i = 0; i < length; i++) {
+        const surgescript_program_instruction_t* instruction = &(program->code[i]);
+        const surgescript_program_callsite_t* callsite;
+        surgescript_program_t* callee;
+        const char* decision;
+        int n, first_line, end;
+
+        new_index[i] = ssarray_length(program->line);
+
+        /* is this a call on "this"? */
+        if(instruction->opcode != SSOP_DCALL || program->callsite[instruction->k.u].handle != 0) {
+            ssarray_push(program->line, line[i]);
+            ssarray_push(is_inlined, false);
+            continue;
+        }
+
+        /* should we inline it? */
+        callsite = &(program->callsite[instruction->k.u]);
+        callee = callsite->target;
+        decision = inlining_decision(program, callsite, first_register);
+        if(strcmp(decision, "inlined") != 0) {
+            ssarray_push(program->inlining, ((surgescript_program_inlining_t){ callsite->program_name, decision }));
+            ssarray_push(program->line, line[i]);
+            ssarray_push(is_inlined, false);
+            continue;
+        }
+
+        /* move the parameters to the registers of the inlined frame and pop the callee */
+        n = callee->arity;
+        for(int j = n - 1; j >= 0; j--) {
+            ssarray_push(program->line, ((surgescript_program_operation_t){ SSOP_POP, surgescript_program_operand_u(first_register + j), zero }));
+            ssarray_push(is_inlined, true);
+        }
+        ssarray_push(program->line, ((surgescript_program_operation_t){ SSOP_POPN, surgescript_program_operand_u(callsite->pop_count - n), zero }));
+        ssarray_push(is_inlined, true);
+
+        /* clear the local variables */
+        for(int j = 0; j < callee->local_count; j++) {
+            ssarray_push(program->line, ((surgescript_program_operation_t){ SSOP_MOVN, surgescript_program_operand_u(first_register + n + j), zero }));
+            ssarray_push(is_inlined, true);
+        }
+        extra_locals = ssmax(extra_locals, n + callee->local_count);
+
+        /* copy the body, skipping the function header. A RET jumps to the end */
+        first_line = (callee->local_count > 0) ? 1 : 0;
+        end = ssarray_length(program->line) + ssarray_length(callee->line) - first_line;
+        for(int j = first_line; j < ssarray_length(callee->line); j++) {
+            surgescript_program_operation_t operation = callee->line[j];
+
+            if(operation.instruction == SSOP_TAILCALL)
+                operation.instruction = SSOP_CALL; /* a tail call of the callee isn't a tail call of the caller */
+
+            if(operation.instruction == SSOP_RET)
+                operation = (surgescript_program_operation_t){ SSOP_JMP, surgescript_program_operand_u(end), zero };
+            else if(is_jump_instruction(operation.instruction))
+                operation.a.u = (operation.a.u < ssarray_length(callee->line)) ? end - (ssarray_length(callee->line) - operation.a.u) : end;
+            else if(operation.instruction == SSOP_CALL)
+                operation.a.u = surgescript_program_add_text(program, callee->text[operation.a.u]);
+            else if(operation.instruction == SSOP_MOVS || operation.instruction == SSOP_PUSHS)
+                operation.b.u = surgescript_program_add_text(program, callee->text[operation.b.u]);
+
+            rename_registers(&operation, callee, first_register);
+            ssarray_push(program->line, operation);
+            ssarray_push(is_inlined, true);
+        }
+
+        /* the body has been substituted. The callee must not be replaced from now on */
+        ssarray_push(program->inlining, ((surgescript_program_inlining_t){ callsite->program_name, decision }));
+        callee->referenced = true;
+        inlined = true;
+    }
+    new_index[length] = ssarray_length(program->line);
+
+    /* nothing has been inlined */
+    if(!inlined) {
+        ssarray_reset(program->line);
+        for(int i = 0; i < length; i++)
+            ssarray_push(program->line, line[i]);
+
+        ssarray_release(is_inlined);
+        ssfree(new_index);
+        ssfree(line);
+        return false;
+    }
+
+    /* correct the jumps of the caller and reserve the new local variables */
+    for(int j = 0; j < ssarray_length(program->line); j++) {
+        if(!is_inlined[j] && is_jump_instruction(program->line[j].instruction) && program->line[j].a.u <= length)
+            program->line[j].a.u = new_index[program->line[j].a.u];
+    }
+    program->line[0].a.u += extra_locals;
+
+    /* no local variables are needed after all? Remove the header that we added */
+    if(program->line[0].a.u == 0) {
+        ssarray_remove(program->line, 0);
+        for(int j = 0; j < ssarray_length(program->line); j++) {
+            if(is_jump_instruction(program->line[j].instruction) && program->line[j].a.u > 0)
+                program->line[j].a.u--;
+        }
+    }
+
+    ssarray_release(is_inlined);
+    ssfree(new_index);
+    ssfree(line);
+
+    /* clean up the code and generate it again */
+#if WANT_CONTROL_FLOW_CLEANUP
+    simplify_control_flow(program);
+#endif
+#if WANT_SUPERINSTRUCTIONS
+    optimize_program(program);
+#endif
+    add_sentinel(program);
+    generate_code(program);
+    return true;
+}
+
+/* should a call site bound to "this" be inlined? Returns "inlined" or the reason why not */
+const char* inlining_decision(const surgescript_program_t* program, const surgescript_program_callsite_t* callsite, int first_register)
+{
+    surgescript_program_t* callee = callsite->target;
+    int size = 0, depth = 0, length;
+    int* depth_at;
+    const char* decision = "inlined";
+
+    if(callee->run != run_program)
+        return "native";
+    else if(callee == program)
+        return "recursive";
+    else if(callsite->pop_count <= callee->arity)
+        return "parameters aren't popped";
+
+    /* the code of the callee is needed */
+    prepare_program(callee);
+    length = ssarray_length(callee->line);
+    if(first_register + callee->arity + callee->local_count > SURGESCRIPT_PROGRAM_MAX_REGISTERS)
+        return "too many registers";
+
+    /* check the body of the callee. Its stack must be balanced when returning,
+       since there is no stack frame that would be cleared by popenv() */
+    depth_at = ssmalloc((length + 1) * sizeof(*depth_at));
+    for(int j = (callee->local_count > 0) ? 1 : 0; j < length; j++) {
+        const surgescript_program_operation_t* operation = &(callee->line[j]);
+        depth_at[j] = depth;
+
+        if(operation->instruction != SSOP_NOP && operation->instruction != SSOP_RET)
+            size++;
+
+        switch(operation->instruction) {
+            case SSOP_PUSH:
+            case SSOP_PUSHF:
+            case SSOP_PUSHS:
+            case SSOP_PUSHO:
+            case SSOP_PUSHSELF:
+                depth++;
+                break;
+
+            case SSOP_PUSHN:
+                depth += operation->a.u;
+                break;
+
+            case SSOP_POP:
+                depth--;
+                break;
+
+            case SSOP_POPN:
+                depth -= operation->a.u;
+                break;
+
+            case SSOP_CALL:
+            case SSOP_TAILCALL:
+                if(strcmp(callee->text[operation->a.u], callsite->program_name) == 0)
+                    decision = "recursive";
+                depth -= operation->b.u >> 16;
+                break;
+
+            case SSOP_RET:
+                if(depth != 0)
+                    decision = "unbalanced stack";
+                break;
+
+            case SSOP_CALLER: /* the caller would change */
+                decision = "uses the caller";
+                break;
+
+            case SSOP_SPEEK:
+            case SSOP_SPOKE:
+                if(surgescript_program_register_of(callee, operation->b.i) < 0)
+                    decision = "unmapped stack address";
+                break;
+
+            default:
+                break;
+        }
+
+        if(depth < 0)
+            decision = "unbalanced stack";
+    }
+
+    /* the stack depth must agree at the targets of the jumps */
+    for(int j = (callee->local_count > 0) ? 1 : 0; j < length; j++) {
+        const surgescript_program_operation_t* operation = &(callee->line[j]);
+        if(is_jump_instruction(operation->instruction)) {
+            int target = operation->a.u;
+            if(target < length ? (target < 1 && callee->local_count > 0) || depth_at[target] != depth_at[j] : depth_at[j] != 0)
+                decision = "unbalanced stack";
+        }
+    }
+
+    ssfree(depth_at);
+
+    /* too large? */
+    if(size > INLINING_THRESHOLD && strcmp(decision, "inlined") == 0)
+        return "too large";
+
+    return decision;
+}
+
+/* renames the registers of an operation of an inlined program, mapping its
+   parameters and its local variables to the caller. stack[base + b] of
+   SSOP_SPEEK and SSOP_SPOKE is converted to a register */
+void rename_registers(surgescript_program_operation_t* operation, const surgescript_program_t* callee, int first_register)
+{
+    #define RENAME(r) ((r) >= SURGESCRIPT_PROGRAM_TEMPS ? (r) - SURGESCRIPT_PROGRAM_TEMPS + first_register : (r))
+
+    switch(operation->instruction) {
+        case SSOP_SPEEK:
+            operation->instruction = SSOP_MOV;
+            operation->b.u = RENAME(surgescript_program_register_of(callee, operation->b.i));
+            operation->a.u = RENAME(operation->a.u);
+            break;
+
+        case SSOP_SPOKE:
+            operation->instruction = SSOP_MOV;
+            operation->b.u = RENAME(operation->a.u);
+            operation->a.u = RENAME(surgescript_program_register_of(callee, operation->b.i));
+            break;
+
+        case SSOP_CMPB:
+            operation->a.u = RENAME(operation->a.u);
+            operation->b.u = (operation->b.u & ~0xFFu) | RENAME(operation->b.u & 0xFF);
+            break;
+
+        case SSOP_CMPJE:
+            operation->b.u = (operation->b.u & ~0xFFFFu) | RENAME(operation->b.u & 0xFF) | (RENAME((operation->b.u >> 8) & 0xFF) << 8);
+            break;
+
+        case SSOP_ADDF:
+        case SSOP_SUBF:
+        case SSOP_MULF:
+        case SSOP_DIVF:
+            operation->a.u = RENAME(operation->a.u & 0xFF) | (RENAME(operation->a.u >> 8) << 8);
+            break;
+
+        default:
+            if(uses_register_a(operation->instruction))
+                operation->a.u = RENAME(operation->a.u);
+            if(uses_register_b(operation->instruction))
+                operation->b.u = RENAME(operation->b.u);
+            break;
+    }
+
+    #undef RENAME
+}
+
+/* is the program inherited from Object? */
+bool is_inherited_program(surgescript_programpool_t* pool, const surgescript_program_t* program)
+{
+    surgescript_program_search_t search = { pool, program, false };
+    surgescript_programpool_foreach_ex(pool, "Object", &search, find_program);
+    return search.found;
+}
+
+/* callback of is_inherited_program() */
+void find_program(const char* program_name, void* data)
+{
+    surgescript_program_search_t* search = (surgescript_program_search_t*)data;
+    if(surgescript_programpool_get(search->pool, "Object", program_name) == search->program)
+        search->found = true;
+}
+
+/* generates the pre-decoded code of the program. Each operation takes
+   24 bytes; each instruction of the pre-decoded code takes 8 bytes.
+   64-bit immediates are moved to a table of constants and call sites
+   get their own array of caches */
+void generate_code(surgescript_program_t* program)
+{
+    ssarray_reset(program->code);
+    ssarray_reset(program->constant);
+    ssarray_reset(program->callsite);
+
+    /* the function header reserves the local variables (see emit_function_header()
+       in asm.c). These are reserved by run_program() when setting up the register window */
+    program->local_count = 0;
+    if(ssarray_length(program->line) > 0 && program->line[0].instruction == SSOP_PUSHN)
+        program->local_count = program->line[0].a.u;
+    program->register_count = ssmin(SURGESCRIPT_PROGRAM_TEMPS + program->arity + program->local_count, SURGESCRIPT_PROGRAM_MAX_REGISTERS);
+
+    /* lower the operations */
+    for(int i = 0; i < ssarray_length(program->line); i++) {
+        const surgescript_program_operation_t* operation = &(program->line[i]);
+        surgescript_program_instruction_t instruction = {
+            .opcode = operation->instruction,
+            .a = 0,
+            .b = 0,
+            .reserved = 0,
+            .k.u = 0
+        };
+
+        /* validate the registers */
+        if(uses_register_a(operation->instruction))
+            instruction.a = validate_register(program, operation->a.u, i);
+
+        if(uses_register_b(operation->instruction))
+            instruction.b = validate_register(program, operation->b.u, i);
+
+        /* decode the immediates */
+        switch(operation->instruction) {
+            case SSOP_MOVB:
+                instruction.k.u = operation->b.b;
+                break;
+
+            case SSOP_MOVF:
+            case SSOP_MOVX:
+            case SSOP_PUSHF:
+                instruction.k.u = add_constant(program, operation->b);
+                break;
+
+            case SSOP_MOVS:
+            case SSOP_PUSHS:
+                if(operation->b.u < ssarray_length(program->text)) {
+                    instruction.k.u = operation->b.u;
+                    intern_text(program, operation->b.u);
+                }
+                else
+                    instruction.opcode = (operation->instruction == SSOP_PUSHS) ? SSOP_PUSH : SSOP_NOP; /* invalid text */
+                break;
+
+            case SSOP_MOVO:
+            case SSOP_PUSHO:
+            case SSOP_PEEK:
+            case SSOP_POKE:
+                instruction.k.u = operation->b.u;
+                break;
+
+            case SSOP_STATE:
+            case SSOP_SPEEK:
+            case SSOP_SPOKE:
+            case SSOP_TCHK:
+                instruction.k.i = operation->b.i;
+                break;
+
+            case SSOP_NOP:
+            case SSOP_TC01:
+                instruction.k.i = operation->a.i;
+                break;
+
+            case SSOP_ALLOCN:
+                instruction.k.u = operation->a.u;
+                break;
+
+            case SSOP_PUSHN:
+                if(i == 0 && program->local_count > 0)
+                    instruction.opcode = SSOP_NOP; /* function header */
+                else
+                    instruction.k.u = operation->a.u;
+                break;
+
+            case SSOP_CAT:
+                instruction.k.u = ssmin(operation->b.u, SURGESCRIPT_PROGRAM_MAX_CONCAT);
+                break;
+
+            case SSOP_POPN:
+            case SSOP_JMP:
+            case SSOP_JE:
+            case SSOP_JNE:
+            case SSOP_JG:
+            case SSOP_JGE:
+            case SSOP_JL:
+            case SSOP_JLE:
+            case SSOP_TJE:
+            case SSOP_TJNE:
+                instruction.k.u = operation->a.u;
+                break;
+
+            case SSOP_CMPB:
+                instruction.b = validate_register(program, operation->b.u & 0xFF, i);
+                instruction.reserved = (operation->b.u >> 8) & 0xFF; /* condition */
+                break;
+
+            case SSOP_CMPJE:
+                instruction.a = validate_register(program, operation->b.u & 0xFF, i);
+                instruction.b = validate_register(program, (operation->b.u >> 8) & 0xFF, i);
+                instruction.reserved = (operation->b.u >> 16) & 0xFF; /* condition */
+                instruction.k.u = operation->a.u;
+                break;
+
+            case SSOP_ADDF:
+            case SSOP_SUBF:
+            case SSOP_MULF:
+            case SSOP_DIVF:
+                instruction.a = validate_register(program, operation->a.u & 0xFF, i);
+                instruction.b = validate_register(program, (operation->a.u >> 8) & 0xFF, i);
+                instruction.k.u = add_constant(program, operation->b);
+                break;
+
+            case SSOP_CALL:
+            case SSOP_OPTCALL:
+            case SSOP_TAILCALL:
+                if(operation->a.u < ssarray_length(program->text)) {
+                    surgescript_program_callsite_t callsite = {
+                        .program_name = program->text[operation->a.u],
+                        .number_of_params = operation->b.u & 0xFFFF,
+                        .pop_count = operation->b.u >> 16,
+                        .method_id = -1,
+                        .cache_size = 0,
+                        .count = 0,
+                        .megamorphic = false,
+                        .hits = 0,
+                        .misses = 0,
+                        .lock = 0,
+                        .target = NULL,
+                        .handle = 0
+                    };
+
+                    instruction.opcode = (operation->instruction == SSOP_TAILCALL) ? SSOP_TAILCALL : SSOP_CALL;
+                    instruction.k.u = ssarray_length(program->callsite);
+                    ssarray_push(program->callsite, callsite);
+                }
+                else
+                    instruction.opcode = SSOP_NOP; /* invalid name; this should never happen */
+                break;
+
+            default:
+                break;
+        }
+
+        ssarray_push(program->code, instruction);
+    }
+}
+
+/* adds a 64-bit immediate to the table of constants, returning its index */
+uint32_t add_constant(surgescript_program_t* program, surgescript_program_operand_t constant)
+{
+    for(int i = 0; i < ssarray_length(program->constant); i++) {
+        if(program->constant[i].u64 == constant.u64)
+            return i;
+    }
+
+    ssarray_push(program->constant, constant);
+    return ssarray_length(program->constant) - 1;
+}
+
+/* interns text[index] as a string literal, unless it's already interned. MOVS
+   and PUSHS copy the literals in O(1), since interned strings are shared. Texts
+   are never modified, so the literals remain valid when the code is generated
+   again (e.g., after inlining) */
+void intern_text(surgescript_program_t* program, int index)
+{
+    while(ssarray_length(program->literal) <= index)
+        ssarray_push(program->literal, NULL);
+
+    if(program->literal[index] == NULL) {
+        program->literal[index] = surgescript_var_create();
+        surgescript_var_set_interned_string(program->literal[index], program->text[index]);
+    }
+}
+
+/* memory used by the pre-decoded code, in bytes. Optionally, the size of the source operations is also returned */
+size_t memspent(const surgescript_program_t* program, size_t* source_bytes)
+{
+    if(source_bytes != NULL)
+        *source_bytes = ssarray_length(program->line) * sizeof(*(program->line));
+
+    return ssarray_length(program->code) * sizeof(*(program->code)) +
+           ssarray_length(program->constant) * sizeof(*(program->constant)) +
+           ssarray_length(program->callsite) * sizeof(*(program->callsite));
+}
+
+/* the stack address (base-relative) mapped to register r of the window */
+surgescript_stackptr_t address_of_register(const surgescript_program_t* program, int r)
+{
+    surgescript_stackptr_t address = r - SURGESCRIPT_PROGRAM_TEMPS - program->arity;
+    return address < 0 ? address : address + 1; /* skip the previous base pointer */
+}
+
+/* checks if t[r] is a register of the program, returning r */
+unsigned validate_register(const surgescript_program_t* program, unsigned r, int line)
+{
+    if(r >= (unsigned)program->register_count)
+        ssfatal("Runtime Error: invalid register t[%u] at line %d of a program with %d registers.", r, line, program->register_count);
+
+    return r;
+}
+
+/* given cmp = compare(x, y), sets t[2] = cmp and t[0] = (bool)(cmp meets the condition), returning t[0] */
+bool set_comparison(int cmp, unsigned condition, surgescript_var_t** _t)
+{
+    bool result = (condition >> ((cmp > 0) - (cmp < 0) + 1)) & 1; /* less = 1, equal = 2, greater = 4 */
+
+    surgescript_var_set_rawbits(_t[2], cmp);
+    surgescript_var_set_bool(_t[0], result);
+    return result;
+}
+
+/* does the instruction read or write register t[a]? */
+bool uses_register_a(surgescript_program_operator_t instruction)
+{
+    switch(instruction)
+    {
+        case SSOP_NOP:
+        case SSOP_ALLOCN:
+        case SSOP_PUSHN:
+        case SSOP_POPN:
+        case SSOP_TC01:
+        case SSOP_JMP:
+        case SSOP_JE:
+        case SSOP_JNE:
+        case SSOP_JG:
+        case SSOP_JGE:
+        case SSOP_JL:
+        case SSOP_JLE:
+        case SSOP_CALL:
+        case SSOP_RET:
+        case SSOP_OPTCALL:
+        case SSOP_DCALL:
+        case SSOP_TAILCALL:
+        case SSOP_CMPJE:
+        case SSOP_TJE:
+        case SSOP_TJNE:
+        case SSOP_ADDF:
+        case SSOP_SUBF:
+        case SSOP_MULF:
+        case SSOP_DIVF:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/* does the instruction read or write register t[b]? */
+bool uses_register_b(surgescript_program_operator_t instruction)
+{
+    switch(instruction)
+    {
+        case SSOP_MOV:
+        case SSOP_XCHG:
+        case SSOP_ADD:
+        case SSOP_SUB:
+        case SSOP_MUL:
+        case SSOP_DIV:
+        case SSOP_REM:
+        case SSOP_NEG:
+        case SSOP_LNOT:
+        case SSOP_LNOT2:
+        case SSOP_NOT:
+        case SSOP_AND:
+        case SSOP_OR:
+        case SSOP_XOR:
+        case SSOP_TEST:
+        case SSOP_TCMP:
+        case SSOP_CMP:
+        case SSOP_TJE:
+        case SSOP_TJNE:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /* debug mode */
 #if SURGESCRIPT_DEBUG_MODE
 void debug(const surgescript_program_t* program, const surgescript_renv_t* runtime_environment, surgescript_program_operator_t instruction, surgescript_program_operand_t a, surgescript_program_operand_t b, surgescript_var_t** _t)
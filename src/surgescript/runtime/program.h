@@ -29,6 +29,7 @@
 #include "program_operators.h"
 #include "variable.h"
 #include "object.h"
+#include "stack.h"
 #include "../util/util.h"
 
 /*
@@ -36,6 +37,10 @@
  * 1. operations = a sequence of ( operator, ( operand_a, operand_b ) )
  * 2. labels = indexes of operations
  * 3. string literals
+ *
+ * Before running a program for the first time, its operations are
+ * optimized by a peephole pass (common sequences are fused into
+ * superinstructions) and then lowered into a compact, pre-decoded code
  */
 
 /* programs */
@@ -45,6 +50,20 @@ struct surgescript_program_t;
 /* C-functions can also be encapsulated in programs */
 typedef surgescript_var_t* (*surgescript_program_cfunction_t)(surgescript_object_t*, const surgescript_var_t**, int);
 
+/* zero-copy C-functions write their return value directly to the last
+   parameter (out), which is null when the function is called. out is
+   shared with the VM: don't call other programs after writing to it */
+typedef void (*surgescript_program_cfunction_ex_t)(surgescript_object_t*, const surgescript_var_t**, int, surgescript_var_t*);
+
+/* registers: t[0 .. 3] are temps shared between caller and callee. The
+   other registers form a window over the parameters and the local
+   variables stored in the stack frame of the program */
+#define SURGESCRIPT_PROGRAM_TEMPS 4
+#define SURGESCRIPT_PROGRAM_MAX_REGISTERS 256
+
+/* the maximum number of values concatenated by a single SSOP_CAT */
+#define SURGESCRIPT_PROGRAM_MAX_CONCAT 32
+
 /* labels */
 typedef unsigned surgescript_program_label_t;
 #define SURGESCRIPT_PROGRAM_UNDEFINED_LABEL (surgescript_program_label_t)(~0u)
@@ -90,6 +109,7 @@ static inline surgescript_program_operand_t surgescript_program_operand_p(void*
 /* life-cycle: create, destroy & run */
 surgescript_program_t* surgescript_program_create(int arity); /* create a new program */
 surgescript_program_t* surgescript_program_create_native(int arity, surgescript_program_cfunction_t cfunction); /* a native C-program must return a newly-allocated surgescript_var_t*, or NULL */
+surgescript_program_t* surgescript_program_create_native_ex(int arity, surgescript_program_cfunction_ex_t cfunction); /* a zero-copy native C-program */
 surgescript_program_t* surgescript_program_destroy(surgescript_program_t* program); /* called by the program pool */
 void surgescript_program_call(surgescript_program_t* program, surgescript_renv_t* runtime_environment, int num_params); /* low-level program call; you'll need to push the stack parameters by yourself */
 
@@ -101,14 +121,18 @@ int surgescript_program_chg_line(surgescript_program_t* program, int line, surge
 bool surgescript_program_read_line(const surgescript_program_t* program, int line, surgescript_program_operator_t* op, surgescript_program_operand_t* a, surgescript_program_operand_t* b); /* reads a line of code of the program */
 int surgescript_program_count_lines(const surgescript_program_t* program); /* the number of lines of code of the program */
 surgescript_program_label_t surgescript_program_find_label(const surgescript_program_t* program, int line); /* finds a label that points to a line of code */
+bool surgescript_program_is_jump_target(const surgescript_program_t* program, int line); /* does a jump of the program land on the given line of code? */
+int surgescript_program_remove_lines(surgescript_program_t* program, int first_line); /* removes the lines of code from first_line onwards, unless a jump of the remaining code lands on them; returns the number of removed lines */
 
 /* program data */
 int surgescript_program_arity(const surgescript_program_t* program); /* what's the arity of this program? (i.e., how many parameters does it take) */
+int surgescript_program_register_of(const surgescript_program_t* program, surgescript_stackptr_t address); /* the register mapped to stack[base + address], or -1 if there is none */
 const char* surgescript_program_get_text(const surgescript_program_t* program, int index); /* reads a string literal (text[index]) from the program */
 int surgescript_program_add_text(surgescript_program_t* program, const char* text); /* adds a read-only string to the program, returning its index */
 int surgescript_program_find_text(const surgescript_program_t* program, const char* text); /* finds the first index such that text[index] == text, or -1 if not found */
 int surgescript_program_text_count(const surgescript_program_t* program); /* how many string literals exist in the program? */
 void surgescript_program_dump(surgescript_program_t* program, FILE* fp); /* dump the program to a file */
 bool surgescript_program_is_native(const surgescript_program_t* program); /* is the program native (i.e., written in C)? */
+uint64_t surgescript_program_instruction_count(); /* the number of instructions executed so far on the calling thread (zero unless WANT_INSTRUCTION_COUNT is enabled) */
 
 #endif
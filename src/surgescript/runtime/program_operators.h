@@ -49,6 +49,7 @@
     F( SSOP_XCHG, "xchg" )                           /* swap(t[a], t[b]) */ \
                                                                             \
     F( SSOP_ALLOC, "alloc" )                   /* t[a] = allocate_cell() */ \
+    F( SSOP_ALLOCN, "allocn" )                       /* allocate a cells */ \
     F( SSOP_PEEK, "peek" )                                /* t[a] = (*b) */ \
     F( SSOP_POKE, "poke" )                                /* (*b) = t[a] */ \
                                                                             \
@@ -73,6 +74,8 @@
     F( SSOP_AND, "and" )                           /* t[a] = t[a] & t[b] */ \
     F( SSOP_OR, "or" )                             /* t[a] = t[a] | t[b] */ \
     F( SSOP_XOR, "xor" )                           /* t[a] = t[a] ^ t[b] */ \
+    F( SSOP_CAT, "cat" )         /* t[a] = concat(stack[top-b+1 .. top]) */ \
+    F( SSOP_STR, "str" )     /* t[a] = string(t[a]) if t[a] is an object */ \
                                                                             \
     F( SSOP_TEST, "test" )                         /* t[2] = t[a] & t[b] */ \
     F( SSOP_TCHK, "tchk" )                  /* t[2] = typecheck(t[a], b) */ \
@@ -89,12 +92,43 @@
     F( SSOP_JLE, "jle" )                  /* jump to line a if t[2] <= 0 */ \
                                                                             \
     F( SSOP_CALL, "call" )                /* call program named text[a], */ \
-                                         /* with b parameters, of object */ \
+                                /* with b & 0xFFFF parameters, of object */ \
                                        /* stack[top-b] and store in t[0] */ \
                                       /* the return value of the program */ \
                                  /* parameters are stacked left-to-right */ \
+                              /* pop (b >> 16) cells after the call ends */ \
     F( SSOP_RET, "ret" )                 /* returns, halting the program */ \
     F( SSOP_OPTCALL, "optcall" )          /* optimized program call with */ \
-                                        /* b parameters and located at a */
+                                        /* b parameters and located at a */ \
+    F( SSOP_DCALL, "dcall" )        /* direct call of a program bound at */ \
+                                   /* link time; same operands as a call */ \
+    F( SSOP_TAILCALL, "tailcall" )   /* call, then return. Same operands */ \
+                         /* as a call; the callee reuses the stack frame */ \
+                                                                            \
+                  /* superinstructions (built by the peephole optimizer) */ \
+    F( SSOP_CMPB, "cmpb" )          /* t[2] = compare(t[a], t[b & 0xFF]) */ \
+                           /* t[0] = (bool)(t[2] meets condition b >> 8) */ \
+    F( SSOP_CMPJE, "cmpje" )     /* cmpb t[b & 0xFF], t[(b >> 8) & 0xFF] */ \
+                           /* (condition b >> 16); test t[0], t[0]; je a */ \
+    F( SSOP_TJE, "tje" )                            /* t[2] = t[b]; je a */ \
+    F( SSOP_TJNE, "tjne" )                         /* t[2] = t[b]; jne a */ \
+    F( SSOP_ADDF, "addf" )    /* t[a & 0xFF] = b + t[a >> 8] (b: number) */ \
+    F( SSOP_SUBF, "subf" )    /* t[a & 0xFF] = t[a >> 8] - b (b: number) */ \
+    F( SSOP_MULF, "mulf" )    /* t[a & 0xFF] = b * t[a >> 8] (b: number) */ \
+    F( SSOP_DIVF, "divf" )    /* t[a & 0xFF] = t[a >> 8] / b (b: number) */ \
+    F( SSOP_PUSHF, "pushf" )              /* t[a] = (number)b; push t[a] */ \
+    F( SSOP_PUSHS, "pushs" )                /* t[a] = text[b]; push t[a] */ \
+    F( SSOP_PUSHO, "pusho" )              /* t[a] = (object)b; push t[a] */ \
+    F( SSOP_PUSHSELF, "pushself" )             /* t[a] = this; push t[a] */ \
+                                                                            \
+          /* quickened instructions (rewritten at runtime; numbers only) */ \
+    F( SSOP_ADDN, "addn" )                                        /* add */ \
+    F( SSOP_SUBN, "subn" )                                        /* sub */ \
+    F( SSOP_MULN, "muln" )                                        /* mul */ \
+    F( SSOP_INCN, "incn" )                                        /* inc */ \
+    F( SSOP_DECN, "decn" )                                        /* dec */ \
+    F( SSOP_CMPN, "cmpn" )                                        /* cmp */ \
+    F( SSOP_CMPBN, "cmpbn" )                                     /* cmpb */ \
+    F( SSOP_CMPJEN, "cmpjen" )                                  /* cmpje */
 
 #endif
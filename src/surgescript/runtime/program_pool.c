@@ -69,6 +69,31 @@ static void traverse_metadata(surgescript_programpool_t* pool, const char* objec
 static void traverse_adapter(const char* program_name, void* callback);
 static void foreach_object_name(surgescript_programpool_t* pool, void* data, void (*callback)(const char*,void*));
 
+/* method tables */
+typedef struct surgescript_programpool_methodid_t surgescript_programpool_methodid_t;
+struct surgescript_programpool_methodid_t /* function names are interned to method IDs */
+{
+    char* program_name; /* key */
+    int method_id; /* value */
+
+    UT_hash_handle hh;
+};
+
+struct surgescript_programpool_vtable_t /* method table of a class of objects */
+{
+    char* object_name; /* key */
+    SSARRAY(surgescript_program_t*, program); /* program[method_id] may be NULL */
+
+    UT_hash_handle hh;
+};
+
+static void build_vtables(surgescript_programpool_t* pool);
+static void update_vtables(surgescript_programpool_t* pool, const char* object_name, const char* program_name);
+static void clear_vtables(surgescript_programpool_t* pool);
+static int intern_method(surgescript_programpool_t* pool, const char* program_name);
+static void set_vtable_entry(surgescript_programpool_vtable_t* vtable, int method_id, surgescript_program_t* program);
+static void add_to_vtable(const char* program_name, void* data);
+
 /* program pool hash type */
 typedef struct surgescript_programpool_hashpair_t surgescript_programpool_hashpair_t;
 struct surgescript_programpool_hashpair_t /* for each function signature, store a reference to its program */
@@ -85,6 +110,11 @@ struct surgescript_programpool_t
     surgescript_programpool_metadata_t* meta;
     bool is_locked;
     xxhash_t seed;
+
+    /* method dispatch */
+    surgescript_programpool_methodid_t* method; /* method IDs */
+    surgescript_programpool_vtable_t* vtable; /* method tables */
+    int method_count; /* number of method IDs */
 };
 
 /* misc */
@@ -109,6 +139,9 @@ surgescript_programpool_t* surgescript_programpool_create()
     pool->meta = NULL;
     pool->is_locked = false;
     pool->seed = surgescript_util_random64(); /* will *probably* generate perfect hashes [!] */
+    pool->method = NULL;
+    pool->vtable = NULL;
+    pool->method_count = 0;
 
     /* [!] we don't know the set of all (classes of) objects at this point, but
            we know that the size of that set is going to be very small compared
@@ -124,6 +157,7 @@ surgescript_programpool_t* surgescript_programpool_create()
  */
 surgescript_programpool_t* surgescript_programpool_destroy(surgescript_programpool_t* pool)
 {
+    clear_vtables(pool);
     fasthash_destroy(pool->hash);
     clear_metadata(pool);
     return ssfree(pool);
@@ -172,6 +206,7 @@ bool surgescript_programpool_put(surgescript_programpool_t* pool, const char* ob
     pair->program = program;
     fasthash_put(pool->hash, pair->signature, pair);
     insert_metadata(pool, object_name, program_name);
+    update_vtables(pool, object_name, program_name);
     return true;
 }
 
@@ -251,11 +286,14 @@ bool surgescript_programpool_replace(surgescript_programpool_t* pool, const char
     if(pair != NULL) {
         /* can't replace an already executed program due to program call optimizations */
         extern bool surgescript_program_executed(const surgescript_program_t* program);
+        extern bool surgescript_program_referenced(const surgescript_program_t* program);
         ssassert(!surgescript_program_executed(pair->program));
+        ssassert(!surgescript_program_referenced(pair->program)); /* statically bound or inlined */
 
         /* replace the program */
         surgescript_program_destroy(pair->program);
         pair->program = program;
+        update_vtables(pool, object_name, program_name);
         return true;
     }
     else {
@@ -274,6 +312,7 @@ void surgescript_programpool_purge(surgescript_programpool_t* pool, const char*
     void* data[] = { pool, (void*)object_name };
     surgescript_programpool_foreach_ex(pool, object_name, data, delete_program);
     remove_object_metadata(pool, object_name);
+    update_vtables(pool, object_name, NULL);
 }
 
 
@@ -290,6 +329,7 @@ void surgescript_programpool_delete(surgescript_programpool_t* pool, const char*
 
     /* delete metadata */
     remove_metadata(pool, object_name, program_name);
+    update_vtables(pool, object_name, program_name);
 }
 
 
@@ -314,6 +354,44 @@ bool surgescript_programpool_is_compiled(surgescript_programpool_t* pool, const
 void surgescript_programpool_lock(surgescript_programpool_t* pool)
 {
     pool->is_locked = true;
+    build_vtables(pool);
+}
+
+/*
+ * surgescript_programpool_method_id()
+ * The ID of a function name, or -1 if there is no such ID. Every function
+ * name is given an ID when the pool is locked
+ */
+int surgescript_programpool_method_id(surgescript_programpool_t* pool, const char* program_name)
+{
+    surgescript_programpool_methodid_t* m = NULL;
+    HASH_FIND_STR(pool->method, program_name, m);
+    return m != NULL ? m->method_id : -1;
+}
+
+/*
+ * surgescript_programpool_vtable()
+ * The method table of a class of objects, or NULL if there is none
+ * (method tables are built when the pool is locked)
+ */
+const surgescript_programpool_vtable_t* surgescript_programpool_vtable(surgescript_programpool_t* pool, const char* object_name)
+{
+    surgescript_programpool_vtable_t* vtable = NULL;
+    HASH_FIND_STR(pool->vtable, object_name, vtable);
+    return vtable;
+}
+
+/*
+ * surgescript_programpool_dispatch()
+ * Gets a program of a class of objects by method ID, with no string hashing.
+ * The method table includes the programs inherited from Object. May return NULL
+ */
+surgescript_program_t* surgescript_programpool_dispatch(const surgescript_programpool_vtable_t* vtable, int method_id)
+{
+    if(vtable != NULL && method_id >= 0 && method_id < ssarray_length(vtable->program))
+        return vtable->program[method_id];
+
+    return NULL;
 }
 
 
@@ -419,6 +497,117 @@ void foreach_object_name(surgescript_programpool_t* pool, void* data, void (*cal
 }
 
 
+/* method tables */
+void build_vtables(surgescript_programpool_t* pool)
+{
+    surgescript_programpool_metadata_t *m = NULL;
+
+    /* a method table for each class of objects, including the
+       inherited programs (surgescript_programpool_get() looks
+       them up in Object) */
+    for(m = pool->meta; m != NULL; m = m->hh.next) {
+        surgescript_programpool_vtable_t* vtable = NULL;
+        HASH_FIND_STR(pool->vtable, m->object_name, vtable);
+
+        if(vtable == NULL) {
+            vtable = ssmalloc(sizeof *vtable);
+            vtable->object_name = ssstrdup(m->object_name);
+            ssarray_init(vtable->program);
+            HASH_ADD_KEYPTR(hh, pool->vtable, vtable->object_name, strlen(vtable->object_name), vtable);
+        }
+
+        traverse_metadata(pool, m->object_name, (void*[]){ pool, vtable }, add_to_vtable);
+        traverse_metadata(pool, "Object", (void*[]){ pool, vtable }, add_to_vtable);
+    }
+}
+
+void update_vtables(surgescript_programpool_t* pool, const char* object_name, const char* program_name)
+{
+    surgescript_programpool_vtable_t *vtable = NULL;
+
+    /* the method tables are built when the pool is locked */
+    if(!pool->is_locked)
+        return;
+
+    /* all program names of a class have changed */
+    if(program_name == NULL) {
+        HASH_FIND_STR(pool->vtable, object_name, vtable);
+        if(vtable != NULL) {
+            surgescript_programpool_methodid_t *m = NULL;
+            for(m = pool->method; m != NULL; m = m->hh.next)
+                set_vtable_entry(vtable, m->method_id, surgescript_programpool_get(pool, object_name, m->program_name));
+        }
+        return;
+    }
+
+    /* a program of Object is inherited by all classes */
+    if(strcmp(object_name, "Object") == 0) {
+        int method_id = intern_method(pool, program_name);
+        for(vtable = pool->vtable; vtable != NULL; vtable = vtable->hh.next)
+            set_vtable_entry(vtable, method_id, surgescript_programpool_get(pool, vtable->object_name, program_name));
+    }
+    else {
+        HASH_FIND_STR(pool->vtable, object_name, vtable);
+        if(vtable != NULL)
+            set_vtable_entry(vtable, intern_method(pool, program_name), surgescript_programpool_get(pool, object_name, program_name));
+        else
+            build_vtables(pool); /* a new class of objects */
+    }
+}
+
+void clear_vtables(surgescript_programpool_t* pool)
+{
+    surgescript_programpool_vtable_t *vtable, *tmp_vtable;
+    surgescript_programpool_methodid_t *m, *tmp_m;
+
+    HASH_ITER(hh, pool->vtable, vtable, tmp_vtable) {
+        HASH_DEL(pool->vtable, vtable);
+        ssarray_release(vtable->program);
+        ssfree(vtable->object_name);
+        ssfree(vtable);
+    }
+
+    HASH_ITER(hh, pool->method, m, tmp_m) {
+        HASH_DEL(pool->method, m);
+        ssfree(m->program_name);
+        ssfree(m);
+    }
+
+    pool->method_count = 0;
+}
+
+int intern_method(surgescript_programpool_t* pool, const char* program_name)
+{
+    surgescript_programpool_methodid_t* m = NULL;
+    HASH_FIND_STR(pool->method, program_name, m);
+
+    if(m == NULL) {
+        m = ssmalloc(sizeof *m);
+        m->program_name = ssstrdup(program_name);
+        m->method_id = pool->method_count++;
+        HASH_ADD_KEYPTR(hh, pool->method, m->program_name, strlen(m->program_name), m);
+    }
+
+    return m->method_id;
+}
+
+void set_vtable_entry(surgescript_programpool_vtable_t* vtable, int method_id, surgescript_program_t* program)
+{
+    while(ssarray_length(vtable->program) <= method_id)
+        ssarray_push(vtable->program, NULL);
+
+    vtable->program[method_id] = program;
+}
+
+void add_to_vtable(const char* program_name, void* data)
+{
+    surgescript_programpool_t* pool = (surgescript_programpool_t*)(((void**)data)[0]);
+    surgescript_programpool_vtable_t* vtable = (surgescript_programpool_vtable_t*)(((void**)data)[1]);
+    int method_id = intern_method(pool, program_name);
+
+    set_vtable_entry(vtable, method_id, surgescript_programpool_get(pool, vtable->object_name, program_name));
+}
+
 /* utilities */
 void delete_pair(void* pair)
 {
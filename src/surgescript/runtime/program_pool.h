@@ -26,6 +26,7 @@
 
 /* types */
 typedef struct surgescript_programpool_t surgescript_programpool_t;
+typedef struct surgescript_programpool_vtable_t surgescript_programpool_vtable_t; /* method table of a class of objects */
 
 /* forward declarations */
 struct surgescript_program_t;
@@ -47,4 +48,9 @@ void surgescript_programpool_purge(surgescript_programpool_t* pool, const char*
 bool surgescript_programpool_is_compiled(surgescript_programpool_t* pool, const char* object_name); /* is there any code for object_name? */
 void surgescript_programpool_lock(surgescript_programpool_t* pool); /* locks the program pool, so that no (programs of) new objects can be added to it */
 
+/* method dispatch (available after the pool is locked) */
+int surgescript_programpool_method_id(surgescript_programpool_t* pool, const char* program_name); /* the ID of a function name, or -1 if there is no such ID */
+const surgescript_programpool_vtable_t* surgescript_programpool_vtable(surgescript_programpool_t* pool, const char* object_name); /* the method table of a class of objects, or NULL */
+struct surgescript_program_t* surgescript_programpool_dispatch(const surgescript_programpool_vtable_t* vtable, int method_id); /* gets a program by method ID, including the ones inherited from Object (may return NULL) */
+
 #endif
@@ -28,10 +28,7 @@
 #include "object_manager.h"
 #include "../util/util.h"
 
-/* how many temporary vars does a runtime environment have? */
-static const int MAX_TMPVARS = 4; /* used for calculations */
-static surgescript_renv_t* full_destructor(surgescript_renv_t* runtime_environment);
-static surgescript_renv_t* partial_destructor(surgescript_renv_t* runtime_environment);
+static inline surgescript_var_t** own_tmp(surgescript_renv_t* runtime_environment);
 
 
 /*
@@ -40,7 +37,11 @@ static surgescript_renv_t* partial_destructor(surgescript_renv_t* runtime_enviro
  */
 surgescript_renv_t* surgescript_renv_create(surgescript_object_t* owner, surgescript_stack_t* stack, surgescript_heap_t* heap, surgescript_programpool_t* program_pool, surgescript_objectmanager_t* object_manager, surgescript_var_t** tmp)
 {
-    surgescript_renv_t* runtime_environment = ssmalloc(sizeof *runtime_environment);
+    /* the temporary variables, if not shared, are stored right after the renv */
+    surgescript_renv_t* runtime_environment = ssmalloc(sizeof *runtime_environment + SURGESCRIPT_RENV_MAX_TMPVARS * sizeof(surgescript_var_t*));
+
+    if(!tmp)
+        return surgescript_renv_init(runtime_environment, owner, stack, heap, program_pool, object_manager, own_tmp(runtime_environment));
 
     runtime_environment->owner = owner; 
     runtime_environment->stack = stack;
@@ -48,19 +49,9 @@ surgescript_renv_t* surgescript_renv_create(surgescript_object_t* owner, surgesc
     runtime_environment->program_pool = program_pool;
     runtime_environment->object_manager = object_manager;
     runtime_environment->caller = surgescript_objectmanager_null(object_manager);
-
-    if(!tmp) {
-        int i;
-        runtime_environment->tmp = ssmalloc(MAX_TMPVARS * sizeof *(runtime_environment->tmp));
-        for(i = 0; i < MAX_TMPVARS; i++)
-            runtime_environment->tmp[i] = surgescript_var_create();
-        runtime_environment->_destructor = full_destructor;
-    }
-    else {
-        runtime_environment->tmp = tmp;
-        surgescript_var_set_null(runtime_environment->tmp[3]);
-        runtime_environment->_destructor = partial_destructor;
-    }
+    runtime_environment->tmp = tmp;
+    runtime_environment->_destructor = NULL;
+    surgescript_var_set_null(runtime_environment->tmp[3]);
 
     return runtime_environment;
 }
@@ -71,21 +62,49 @@ surgescript_renv_t* surgescript_renv_create(surgescript_object_t* owner, surgesc
  */
 surgescript_renv_t* surgescript_renv_destroy(surgescript_renv_t* runtime_environment)
 {
-    return runtime_environment->_destructor(runtime_environment);
+    if(runtime_environment->tmp == own_tmp(runtime_environment))
+        surgescript_renv_release(runtime_environment);
+
+    return ssfree(runtime_environment);
 }
 
+/*
+ * surgescript_renv_init()
+ * Initializes a runtime environment stored in memory provided by the caller.
+ * The renv gets its own temporary variables, stored in the tmp array
+ */
+surgescript_renv_t* surgescript_renv_init(surgescript_renv_t* runtime_environment, surgescript_object_t* owner, surgescript_stack_t* stack, surgescript_heap_t* heap, surgescript_programpool_t* program_pool, surgescript_objectmanager_t* object_manager, surgescript_var_t** tmp)
+{
+    runtime_environment->owner = owner; 
+    runtime_environment->stack = stack;
+    runtime_environment->heap = heap;
+    runtime_environment->program_pool = program_pool;
+    runtime_environment->object_manager = object_manager;
+    runtime_environment->caller = surgescript_objectmanager_null(object_manager);
+
+    runtime_environment->tmp = tmp;
+    runtime_environment->_destructor = NULL;
+    for(int i = 0; i < SURGESCRIPT_RENV_MAX_TMPVARS; i++)
+        runtime_environment->tmp[i] = surgescript_var_create();
 
-/* privates */
+    return runtime_environment;
+}
 
-surgescript_renv_t* full_destructor(surgescript_renv_t* runtime_environment)
+/*
+ * surgescript_renv_release()
+ * Releases a runtime environment initialized with surgescript_renv_init()
+ */
+void surgescript_renv_release(surgescript_renv_t* runtime_environment)
 {
-    for(int i = 0; i < MAX_TMPVARS; i++)
+    for(int i = 0; i < SURGESCRIPT_RENV_MAX_TMPVARS; i++)
         surgescript_var_destroy(runtime_environment->tmp[i]);
-    ssfree(runtime_environment->tmp);
-    return ssfree(runtime_environment);
 }
 
-surgescript_renv_t* partial_destructor(surgescript_renv_t* runtime_environment)
+
+/* privates */
+
+/* where the temporary variables of a renv allocated by surgescript_renv_create() are stored */
+surgescript_var_t** own_tmp(surgescript_renv_t* runtime_environment)
 {
-    return ssfree(runtime_environment);
+    return (surgescript_var_t**)(runtime_environment + 1);
 }
\ No newline at end of file
@@ -29,6 +29,9 @@ struct surgescript_heap_t;
 struct surgescript_programpool_t;
 struct surgescript_objectmanager_t;
 
+/* how many temporary vars does a runtime environment have? */
+#define SURGESCRIPT_RENV_MAX_TMPVARS 4 /* used for calculations */
+
 /* a program, to be run, needs a runtime environment (renv) */
 /* this is composed by an owner object, plus heap-stack-etc, plus some unique temporary variables */
 /* --- instead of messing with this directly, use the functions below --- */
@@ -40,7 +43,7 @@ typedef struct surgescript_renv_t
     struct surgescript_programpool_t* program_pool; /* pointer to the program pool */
     struct surgescript_objectmanager_t* object_manager; /* pointer to the object manager */
     struct surgescript_var_t** tmp; /* temporary variables */
-    struct surgescript_renv_t* (*_destructor)(struct surgescript_renv_t*); /* internal destructor */
+    struct surgescript_renv_t* (*_destructor)(struct surgescript_renv_t*); /* unused; kept for ABI compatibility */
     unsigned caller; /* handle to the object that called this program */
 } surgescript_renv_t ;
 
@@ -50,6 +53,12 @@ surgescript_renv_t* surgescript_renv_create(struct surgescript_object_t* owner,
 /* destroys a renv */
 surgescript_renv_t* surgescript_renv_destroy(surgescript_renv_t* runtime_environment);
 
+/* initializes a renv stored in memory provided by the caller; its own temporary variables are stored in tmp[0 .. SURGESCRIPT_RENV_MAX_TMPVARS-1] */
+surgescript_renv_t* surgescript_renv_init(surgescript_renv_t* runtime_environment, struct surgescript_object_t* owner, struct surgescript_stack_t* stack, struct surgescript_heap_t* heap, struct surgescript_programpool_t* program_pool, struct surgescript_objectmanager_t* object_manager, struct surgescript_var_t** tmp);
+
+/* releases a renv initialized with surgescript_renv_init(), without deallocating it */
+void surgescript_renv_release(surgescript_renv_t* runtime_environment);
+
 /* getters */
 #define surgescript_renv_owner(renv)            ((renv)->owner)
 #define surgescript_renv_stack(renv)            ((renv)->stack)
@@ -32,30 +32,30 @@
 /* private stuff */
 
 /* Array */
-static surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_push(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_pop(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_shift(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_unshift(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_sort(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_reverse(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_shuffle(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_indexof(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static void fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_push(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_pop(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_shift(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_unshift(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_sort(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_reverse(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_shuffle(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_indexof(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
 
 /* ArrayIterator */
-static surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_it_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_it_hasnext(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_it_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static void fun_it_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_it_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_it_next(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_it_hasnext(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_it_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
 
 /* sorting functions */
 typedef int (*surgescript_sortcmp_t)(surgescript_object_t* object, const surgescript_var_t*, const surgescript_var_t*);
@@ -86,36 +86,36 @@ void surgescript_sslib_register_array(surgescript_vm_t* vm)
     surgescript_tagsystem_add_tag(tag_system, "ArrayIterator", "iterator");
 
     /* methods */
-    surgescript_vm_bind(vm, "Array", "constructor", fun_constructor, 0);
-    surgescript_vm_bind(vm, "Array", "destructor", fun_destructor, 0);
-    surgescript_vm_bind(vm, "Array", "state:main", fun_main, 0);
-    surgescript_vm_bind(vm, "Array", "get_length", fun_getlength, 0);
-    surgescript_vm_bind(vm, "Array", "get", fun_get, 1);
-    surgescript_vm_bind(vm, "Array", "set", fun_set, 2);
-    surgescript_vm_bind(vm, "Array", "push", fun_push, 1);
-    surgescript_vm_bind(vm, "Array", "pop", fun_pop, 0);
-    surgescript_vm_bind(vm, "Array", "shift", fun_shift, 0);
-    surgescript_vm_bind(vm, "Array", "unshift", fun_unshift, 1);
-    surgescript_vm_bind(vm, "Array", "clear", fun_clear, 0);
-    surgescript_vm_bind(vm, "Array", "sort", fun_sort, 1);
-    surgescript_vm_bind(vm, "Array", "reverse", fun_reverse, 0);
-    surgescript_vm_bind(vm, "Array", "shuffle", fun_shuffle, 0);
-    surgescript_vm_bind(vm, "Array", "indexOf", fun_indexof, 1);
-    surgescript_vm_bind(vm, "Array", "iterator", fun_iterator, 0);
-    surgescript_vm_bind(vm, "Array", "toString", fun_tostring, 0);
-
-    surgescript_vm_bind(vm, "ArrayIterator", "constructor", fun_it_constructor, 0);
-    surgescript_vm_bind(vm, "ArrayIterator", "state:main", fun_it_main, 0);
-    surgescript_vm_bind(vm, "ArrayIterator", "next", fun_it_next, 0);
-    surgescript_vm_bind(vm, "ArrayIterator", "hasNext", fun_it_hasnext, 0);
-    surgescript_vm_bind(vm, "ArrayIterator", "toString", fun_it_tostring, 0);
+    surgescript_vm_bind_ex(vm, "Array", "constructor", fun_constructor, 0);
+    surgescript_vm_bind_ex(vm, "Array", "destructor", fun_destructor, 0);
+    surgescript_vm_bind_ex(vm, "Array", "state:main", fun_main, 0);
+    surgescript_vm_bind_ex(vm, "Array", "get_length", fun_getlength, 0);
+    surgescript_vm_bind_ex(vm, "Array", "get", fun_get, 1);
+    surgescript_vm_bind_ex(vm, "Array", "set", fun_set, 2);
+    surgescript_vm_bind_ex(vm, "Array", "push", fun_push, 1);
+    surgescript_vm_bind_ex(vm, "Array", "pop", fun_pop, 0);
+    surgescript_vm_bind_ex(vm, "Array", "shift", fun_shift, 0);
+    surgescript_vm_bind_ex(vm, "Array", "unshift", fun_unshift, 1);
+    surgescript_vm_bind_ex(vm, "Array", "clear", fun_clear, 0);
+    surgescript_vm_bind_ex(vm, "Array", "sort", fun_sort, 1);
+    surgescript_vm_bind_ex(vm, "Array", "reverse", fun_reverse, 0);
+    surgescript_vm_bind_ex(vm, "Array", "shuffle", fun_shuffle, 0);
+    surgescript_vm_bind_ex(vm, "Array", "indexOf", fun_indexof, 1);
+    surgescript_vm_bind_ex(vm, "Array", "iterator", fun_iterator, 0);
+    surgescript_vm_bind_ex(vm, "Array", "toString", fun_tostring, 0);
+
+    surgescript_vm_bind_ex(vm, "ArrayIterator", "constructor", fun_it_constructor, 0);
+    surgescript_vm_bind_ex(vm, "ArrayIterator", "state:main", fun_it_main, 0);
+    surgescript_vm_bind_ex(vm, "ArrayIterator", "next", fun_it_next, 0);
+    surgescript_vm_bind_ex(vm, "ArrayIterator", "hasNext", fun_it_hasnext, 0);
+    surgescript_vm_bind_ex(vm, "ArrayIterator", "toString", fun_it_tostring, 0);
 }
 
 
 /* my functions */
 
 /* array constructor */
-surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     /* since we don't ever free() anything from the heap (except the last cell),
        memory cells are allocated contiguously */
@@ -123,45 +123,41 @@ surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescri
     surgescript_heapptr_t length_addr = surgescript_heap_malloc(heap);
     surgescript_var_set_number(surgescript_heap_at(heap, length_addr), 0);
     ssassert(length_addr == LENGTH_ADDR);
-    return NULL;
 }
 
 /* destructor */
-surgescript_var_t* fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     /* the heap gets freed anyway, so why bother? */
-    return NULL;
 }
 
 /* main state */
-surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     /* do nothing */
-    return NULL;
 }
 
 /* returns the length of the array */
-surgescript_var_t* fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
-    return surgescript_var_clone(surgescript_heap_at(heap, LENGTH_ADDR));
+    surgescript_var_copy(out, surgescript_heap_at(heap, LENGTH_ADDR));
 }
 
 /* gets i-th element of the array (indexes are 0-based) */
-surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int index = surgescript_var_get_number(param[0]);
 
     if(index >= 0 && index < ARRAY_LENGTH(heap))
-        return surgescript_var_clone(surgescript_heap_at(heap, BASE_ADDR + index));
+        surgescript_var_copy(out, surgescript_heap_at(heap, BASE_ADDR + index));
 
     /* index out of bounds: fail silently */
-    return NULL;
 }
 
 /* sets the i-th element of the array */
-surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int index = surgescript_var_get_number(param[0]);
@@ -171,7 +167,7 @@ surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t
     /* sanity check & leak prevention */
     if(index < 0 || index >= length + 1024) {
         ssfatal("Can't set %d-%s element of the array: the index is out of bounds.", index, ORDINAL(index));
-        return NULL;
+        return;
     }
 
     /* create memory addresses as needed */
@@ -185,11 +181,11 @@ surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t
     surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + index), value);
 
     /* done! */
-    return NULL; /*surgescript_var_clone(value);*/ /* the C expression (arr[i] = value) returns value */
+    /*surgescript_var_copy(out, value);*/ /* the C expression (arr[i] = value) returns value */
 }
 
 /* pushes a new element into the last position of the array */
-surgescript_var_t* fun_push(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_push(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     const surgescript_var_t* value = param[0];
@@ -199,48 +195,40 @@ surgescript_var_t* fun_push(surgescript_object_t* object, const surgescript_var_
     surgescript_var_copy(surgescript_heap_at(heap, ptr), value);
     surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), ++length);
     ssassert(ptr == BASE_ADDR + (length - 1));
-
-    return NULL;
 }
 
 /* pops the last element from the array */
-surgescript_var_t* fun_pop(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_pop(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int length = ARRAY_LENGTH(heap);
 
     if(length > 0) {
-        surgescript_var_t* value = surgescript_var_clone(surgescript_heap_at(heap, BASE_ADDR + (length - 1)));
+        surgescript_var_copy(out, surgescript_heap_at(heap, BASE_ADDR + (length - 1)));
         surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), length - 1);
         surgescript_heap_free(heap, BASE_ADDR + (length - 1));
-        return value;
     }
-
-    return NULL;
 }
 
 /* removes (and returns) the first element and shifts all others to a lower index */
-surgescript_var_t* fun_shift(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_shift(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int length = ARRAY_LENGTH(heap);
 
     if(length > 0) {
-        surgescript_var_t* value = surgescript_var_clone(surgescript_heap_at(heap, BASE_ADDR + 0));
+        surgescript_var_copy(out, surgescript_heap_at(heap, BASE_ADDR + 0));
 
         for(int i = 0; i < length - 1; i++)
             surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + i), surgescript_heap_at(heap, BASE_ADDR + (i + 1)));
 
         surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), length - 1);
         surgescript_heap_free(heap, BASE_ADDR + (length - 1));
-        return value;
     }
-
-    return NULL;
 }
 
 /* adds an element to the beginning of the array and shifts all others to a higher index */
-surgescript_var_t* fun_unshift(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_unshift(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     const surgescript_var_t* value = param[0];
@@ -253,12 +241,10 @@ surgescript_var_t* fun_unshift(surgescript_object_t* object, const surgescript_v
     for(int i = length - 1; i > 0; i--)
         surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + i), surgescript_heap_at(heap, BASE_ADDR + (i - 1)));
     surgescript_var_copy(surgescript_heap_at(heap, BASE_ADDR + 0), value);
-
-    return NULL;
 }
 
 /* reverses the array. Returns the reversed array. */
-surgescript_var_t* fun_reverse(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_reverse(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int length = ARRAY_LENGTH(heap);
@@ -269,11 +255,11 @@ surgescript_var_t* fun_reverse(surgescript_object_t* object, const surgescript_v
         surgescript_var_swap(a, b);
     }
 
-    return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object));
+    surgescript_var_set_objecthandle(out, surgescript_object_handle(object));
 }
 
 /* sorts the array. Returns the sorted array */
-surgescript_var_t* fun_sort(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_sort(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -282,11 +268,11 @@ surgescript_var_t* fun_sort(surgescript_object_t* object, const surgescript_var_
 
     quicksort(heap, BASE_ADDR, BASE_ADDR + ARRAY_LENGTH(heap) - 1, compare, compare_object);
 
-    return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object));
+    surgescript_var_set_objecthandle(out, surgescript_object_handle(object));
 }
 
 /* shuffles the array. Returns the shuffled array. */
-surgescript_var_t* fun_shuffle(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_shuffle(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int length = ARRAY_LENGTH(heap);
@@ -297,11 +283,11 @@ surgescript_var_t* fun_shuffle(surgescript_object_t* object, const surgescript_v
         surgescript_var_swap(a, b);
     }
 
-    return surgescript_var_set_objecthandle(surgescript_var_create(), surgescript_object_handle(object));
+    surgescript_var_set_objecthandle(out, surgescript_object_handle(object));
 }
 
 /* finds the first i such that array[i] == param[0], or -1 if there is no such a match */
-surgescript_var_t* fun_indexof(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_indexof(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* haystack = surgescript_object_heap(object);
     const surgescript_var_t* needle = param[0];
@@ -309,15 +295,17 @@ surgescript_var_t* fun_indexof(surgescript_object_t* object, const surgescript_v
 
     for(int i = 0; i < length; i++) {
         surgescript_var_t* element = surgescript_heap_at(haystack, BASE_ADDR + i);
-        if(surgescript_var_compare(element, needle) == 0)
-            return surgescript_var_set_number(surgescript_var_create(), i);
+        if(surgescript_var_compare(element, needle) == 0) {
+            surgescript_var_set_number(out, i);
+            return;
+        }
     }
 
-    return surgescript_var_set_number(surgescript_var_create(), -1);
+    surgescript_var_set_number(out, -1);
 }
 
 /* clears the array */
-surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int length = ARRAY_LENGTH(heap);
@@ -327,24 +315,21 @@ surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var
             surgescript_heap_free(heap, BASE_ADDR + i);
         surgescript_var_set_number(surgescript_heap_at(heap, LENGTH_ADDR), 0);
     }
-
-    return NULL;
 }
 
 /* returns an ArrayIterator of this array */
-surgescript_var_t* fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t it_handle = surgescript_objectmanager_spawn(manager, surgescript_object_handle(object), "ArrayIterator", NULL);
-    return surgescript_var_set_objecthandle(surgescript_var_create(), it_handle);
+    surgescript_var_set_objecthandle(out, it_handle);
 }
 
 /* converts to string */
-surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     SSARRAY(char, sb); /* string builder */
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_var_t* stringified_array = surgescript_var_create();
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int length = ARRAY_LENGTH(heap);
     static int depth = 0;
@@ -410,12 +395,9 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
     /* convert sb to string */
     ssarray_push(sb, ']');
     ssarray_push(sb, '\0');
-    surgescript_var_set_string(stringified_array, sb);
+    surgescript_var_set_string(out, sb); /* out is written after the calls to toString() */
     ssarray_release(sb);
     --depth;
-
-    /* done! */
-    return stringified_array;
 }
 
 
@@ -423,7 +405,7 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
 
 /* ArrayIterator */
 
-surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_it_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -439,16 +421,14 @@ surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surges
     surgescript_var_set_number(surgescript_heap_at(heap, IT_COUNTER_ADDR), 0.0);
     if(strcmp(parent_name, "Array") == 0)
         surgescript_var_set_number(surgescript_heap_at(heap, IT_LENGTH_ADDR), ARRAY_LENGTH(parent_heap));
-
-    return NULL;
 }
 
-surgescript_var_t* fun_it_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_it_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
-    return NULL;
+    /* do nothing */
 }
 
-surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_it_next(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int cnt = surgescript_var_get_number(surgescript_heap_at(heap, IT_COUNTER_ADDR));
@@ -459,25 +439,22 @@ surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_v
         surgescript_objecthandle_t parent_handle = surgescript_object_parent(object);
         surgescript_object_t* parent = surgescript_objectmanager_get(manager, parent_handle);
         surgescript_heap_t* parent_heap = surgescript_object_heap(parent);
-        surgescript_var_t* element = surgescript_var_clone(surgescript_heap_at(parent_heap, BASE_ADDR + cnt));
+        surgescript_var_copy(out, surgescript_heap_at(parent_heap, BASE_ADDR + cnt));
         surgescript_var_set_number(surgescript_heap_at(heap, IT_COUNTER_ADDR), cnt + 1);
-        return element;
     }
-
-    return NULL;
 }
 
-surgescript_var_t* fun_it_hasnext(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_it_hasnext(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     int cnt = surgescript_var_get_number(surgescript_heap_at(heap, IT_COUNTER_ADDR));
     int len = surgescript_var_get_number(surgescript_heap_at(heap, IT_LENGTH_ADDR));
-    return surgescript_var_set_bool(surgescript_var_create(), cnt < len);
+    surgescript_var_set_bool(out, cnt < len);
 }
 
-surgescript_var_t* fun_it_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_it_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
-    return surgescript_var_set_string(surgescript_var_create(), "[ArrayIterator]");
+    surgescript_var_set_string(out, "[ArrayIterator]");
 }
 
 
@@ -501,13 +478,14 @@ surgescript_heapptr_t partition(surgescript_heap_t* heap, surgescript_heapptr_t
 
     surgescript_var_swap(pivot, med3(surgescript_heap_at(heap, begin), surgescript_heap_at(heap, begin + (end-begin)/2), pivot));
     for(surgescript_heapptr_t i = begin; i <= end - 1; i++) {
-        if(compare(compare_object, surgescript_heap_at(heap, i), pivot) <= 0) {
+        /* a custom comparison function may change the array, moving its heap */
+        if(compare(compare_object, surgescript_heap_at(heap, i), surgescript_heap_at(heap, end)) <= 0) {
             surgescript_var_swap(surgescript_heap_at(heap, i), surgescript_heap_at(heap, p));
             p++;
         }
     }
 
-    surgescript_var_swap(surgescript_heap_at(heap, p), pivot);
+    surgescript_var_swap(surgescript_heap_at(heap, p), surgescript_heap_at(heap, end));
     return p;
 }
 
@@ -31,17 +31,17 @@
 /* private stuff */
 
 /* Dictionary */
-static surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_getcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_delete(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_has(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_keys(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
-static surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
+static void fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_getcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_delete(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_has(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_keys(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
 
 /* DictionaryIterator */
 static surgescript_var_t* fun_it_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params);
@@ -102,17 +102,17 @@ void surgescript_sslib_register_dictionary(surgescript_vm_t* vm)
     surgescript_tagsystem_add_tag(tag_system, "DictionaryIterator", "iterator");
 
     /* methods */
-    surgescript_vm_bind(vm, "Dictionary", "constructor", fun_constructor, 0);
-    surgescript_vm_bind(vm, "Dictionary", "state:main", fun_main, 0);
-    surgescript_vm_bind(vm, "Dictionary", "get_count", fun_getcount, 0);
-    surgescript_vm_bind(vm, "Dictionary", "get", fun_get, 1);
-    surgescript_vm_bind(vm, "Dictionary", "set", fun_set, 2);
-    surgescript_vm_bind(vm, "Dictionary", "clear", fun_clear, 0);
-    surgescript_vm_bind(vm, "Dictionary", "delete", fun_delete, 1);
-    surgescript_vm_bind(vm, "Dictionary", "has", fun_has, 1);
-    surgescript_vm_bind(vm, "Dictionary", "keys", fun_keys, 0);
-    surgescript_vm_bind(vm, "Dictionary", "iterator", fun_iterator, 0);
-    surgescript_vm_bind(vm, "Dictionary", "toString", fun_tostring, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "constructor", fun_constructor, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "state:main", fun_main, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "get_count", fun_getcount, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "get", fun_get, 1);
+    surgescript_vm_bind_ex(vm, "Dictionary", "set", fun_set, 2);
+    surgescript_vm_bind_ex(vm, "Dictionary", "clear", fun_clear, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "delete", fun_delete, 1);
+    surgescript_vm_bind_ex(vm, "Dictionary", "has", fun_has, 1);
+    surgescript_vm_bind_ex(vm, "Dictionary", "keys", fun_keys, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "iterator", fun_iterator, 0);
+    surgescript_vm_bind_ex(vm, "Dictionary", "toString", fun_tostring, 0);
 
     surgescript_vm_bind(vm, "DictionaryIterator", "constructor", fun_it_constructor, 0);
     surgescript_vm_bind(vm, "DictionaryIterator", "state:main", fun_it_main, 0);
@@ -147,7 +147,7 @@ void surgescript_sslib_register_dictionary(surgescript_vm_t* vm)
 /* A Dictionary is just a facade that implements a Binary Search Tree (BSTNodes) */
 
 /* constructor(): initialize the Dictionary */
-surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -155,18 +155,15 @@ surgescript_var_t* fun_constructor(surgescript_object_t* object, const surgescri
 
     ssassert(DICT_BSTROOT == surgescript_heap_malloc(heap));
     surgescript_var_set_objecthandle(surgescript_heap_at(heap, DICT_BSTROOT), null_handle);
-
-    return NULL;
 }
 
 /* main state: do nothing */
-surgescript_var_t* fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
-    return NULL;
 }
 
 /* getCount(): how many entries does this Dictionary have? */
-surgescript_var_t* fun_getcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_getcount(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -174,16 +171,15 @@ surgescript_var_t* fun_getcount(surgescript_object_t* object, const surgescript_
 
     if(surgescript_objectmanager_exists(manager, bst)) {
         surgescript_object_t* node = surgescript_objectmanager_get(manager, bst);
-        return fun_bst_count(node, NULL, 0);
+        surgescript_var_set_number(out, bst_count(manager, node));
     }
     else
-        return surgescript_var_set_number(surgescript_var_create(), 0);
+        surgescript_var_set_number(out, 0);
 }
 
 /* get(key): gets an entry from the Dictionary */
-surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_get(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
-    surgescript_var_t* get = NULL;
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t bst = surgescript_var_get_objecthandle(surgescript_heap_at(heap, DICT_BSTROOT));
@@ -197,18 +193,17 @@ surgescript_var_t* fun_get(surgescript_object_t* object, const surgescript_var_t
 
         if(surgescript_objectmanager_exists(manager, result_handle)) {
             surgescript_object_t* result_object = surgescript_objectmanager_get(manager, result_handle);
-            get = fun_bst_getvalue(result_object, NULL, 0);
+            surgescript_heap_t* result_heap = surgescript_object_heap(result_object);
+            surgescript_var_copy(out, surgescript_heap_at(result_heap, BST_VALUE));
         }
 
         surgescript_var_destroy(result);
         surgescript_var_destroy(key);
     }
-
-    return get;
 }
 
 /* set(key, value): sets a new entry */
-surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_set(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -227,11 +222,10 @@ surgescript_var_t* fun_set(surgescript_object_t* object, const surgescript_var_t
         surgescript_var_set_objecthandle(root, new_bst_node(object, key, value));
 
     surgescript_var_destroy(key);
-    return NULL;
 }
 
 /* clear(): clears the whole Dictionary, so that no entries are stored */
-surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -245,11 +239,10 @@ surgescript_var_t* fun_clear(surgescript_object_t* object, const surgescript_var
     }
 
     surgescript_var_set_objecthandle(root, null_handle);
-    return NULL;
 }
 
 /* delete(key): deletes a key from the Dictionary */
-surgescript_var_t* fun_delete(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_delete(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_heap_t* heap = surgescript_object_heap(object);
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
@@ -269,12 +262,10 @@ surgescript_var_t* fun_delete(surgescript_object_t* object, const surgescript_va
 
         surgescript_var_destroy(key);
     }
-
-    return NULL;
 }
 
 /* has(key): does this dictionary have an entry with the given key? */
-surgescript_var_t* fun_has(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_has(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     bool has = false;
     surgescript_heap_t* heap = surgescript_object_heap(object);
@@ -294,23 +285,22 @@ surgescript_var_t* fun_has(surgescript_object_t* object, const surgescript_var_t
         surgescript_var_destroy(key);
     }
 
-    return surgescript_var_set_bool(surgescript_var_create(), has);
+    surgescript_var_set_bool(out, has);
 }
 
 /* iterator(): spawns an iterator of this Dictionary */
-surgescript_var_t* fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_iterator(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     /* The DictionaryIterator will set up itself */
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t it_handle = surgescript_objectmanager_spawn(manager, surgescript_object_handle(object), "DictionaryIterator", NULL);
-    return surgescript_var_set_objecthandle(surgescript_var_create(), it_handle);
+    surgescript_var_set_objecthandle(out, it_handle);
 }
 
 /* toString(): converts to string */
-surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_var_t* stringified_dictionary = surgescript_var_create();
     surgescript_object_t* iterator = NULL;
     SSARRAY(char, sb); /* string builder */
     static int depth = 0;
@@ -397,16 +387,13 @@ surgescript_var_t* fun_tostring(surgescript_object_t* object, const surgescript_
     /* convert sb to string */
     ssarray_push(sb, '}');
     ssarray_push(sb, '\0');
-    surgescript_var_set_string(stringified_dictionary, sb);
+    surgescript_var_set_string(out, sb); /* out is written after the calls to other functions */
     ssarray_release(sb);
     --depth;
-
-    /* done! */
-    return stringified_dictionary;
 }
 
 /* keys(): returns an array containing the keys of the dictionary */
-surgescript_var_t* fun_keys(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
+void fun_keys(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
 {
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
     surgescript_objecthandle_t array_handle = surgescript_objectmanager_spawn_array(manager);
@@ -427,7 +414,8 @@ surgescript_var_t* fun_keys(surgescript_object_t* object, const surgescript_var_
     }
 
     /* done! */
-    return surgescript_var_set_objecthandle(tmp, array_handle);
+    surgescript_var_set_objecthandle(out, array_handle);
+    surgescript_var_destroy(tmp);
 }
 
 
@@ -505,8 +493,10 @@ surgescript_var_t* fun_it_next(surgescript_object_t* object, const surgescript_v
         left_handle = surgescript_var_get_objecthandle(surgescript_heap_at(node_heap, BST_LEFT));
         if(surgescript_objectmanager_exists(manager, left_handle)) {
             top_ptr = IT_STACKBASE + surgescript_var_get_number(stacksize);
-            if(!surgescript_heap_validaddress(heap, top_ptr))
+            if(!surgescript_heap_validaddress(heap, top_ptr)) {
                 ssassert(top_ptr == surgescript_heap_malloc(heap));
+                stacksize = surgescript_heap_at(heap, IT_STACKSIZE); /* the heap may have been moved */
+            }
             new_top = surgescript_heap_at(heap, top_ptr);
             surgescript_var_set_objecthandle(new_top, left_handle);
             surgescript_var_set_number(stacksize, surgescript_var_get_number(stacksize) + 1);
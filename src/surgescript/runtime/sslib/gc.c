@@ -26,6 +26,8 @@
 #include "../object.h"
 #include "../object_manager.h"
 #include "../heap.h"
+#include "../variable.h"
+#include "../managed_string.h"
 #include "../../util/util.h"
 
 /* helpers & constants */
@@ -34,6 +36,8 @@ static const int DEFAULT_GC_INTERVAL = 1000;  /* will run GC.collect() every DEF
 static const int MINIMUM_GC_INTERVAL = 0;     /* run the GC as fast as possible */
 static const int MAXIMUM_GC_INTERVAL = 20000;
 static const char GC_INTERVAL_COMMAND_LINE_OPTION_NAME[] = "--surgescript-gc-interval";
+static const int COMPACTION_THRESHOLD = 256;  /* compact the pools if at least this many objects, and at least
+                                                half of them, have been disposed in a single collection */
 static int find_gc_interval(const struct surgescript_vmargs_t* args);
 static inline bool is_integer(const char* str);
 
@@ -131,7 +135,17 @@ surgescript_var_t* fun_destroy(surgescript_object_t* object, const surgescript_v
 surgescript_var_t* fun_collect(surgescript_object_t* object, const surgescript_var_t** param, int num_params)
 {
     surgescript_objectmanager_t* manager = surgescript_object_manager(object);
-    surgescript_objectmanager_garbagecollect(manager);
+
+    if(surgescript_objectmanager_garbagecollect(manager)) {
+        /* give memory back to the system after a spike, e.g., when a level is unloaded */
+        int garbage_count = surgescript_objectmanager_garbagecount(manager);
+        if(garbage_count >= COMPACTION_THRESHOLD && garbage_count >= surgescript_objectmanager_count(manager)) {
+            surgescript_var_compact_pool();
+            surgescript_managedstring_compact_pool();
+            surgescript_objectmanager_compact(manager);
+        }
+    }
+
     return NULL;
 }
 
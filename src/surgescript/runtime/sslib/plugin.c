@@ -95,9 +95,9 @@ surgescript_var_t* fun_spawn(surgescript_object_t* object, const surgescript_var
     if(plugin_handle == surgescript_objectmanager_null(manager)) {
         /* spawn the plugin and save a reference to it in the memory */
         surgescript_heap_t* heap = surgescript_object_heap(object);
-        surgescript_var_t* mem = surgescript_heap_at(heap, surgescript_heap_malloc(heap));
-        plugin_handle = surgescript_objectmanager_spawn(manager, me, plugin_name, NULL);
-        surgescript_var_set_objecthandle(mem, plugin_handle);
+        surgescript_heapptr_t ptr = surgescript_heap_malloc(heap);
+        plugin_handle = surgescript_objectmanager_spawn(manager, me, plugin_name, NULL); /* may install other plugins */
+        surgescript_var_set_objecthandle(surgescript_heap_at(heap, ptr), plugin_handle);
 
         /* create a getter */
         if(is_valid_name(plugin_name)) {
@@ -34,6 +34,7 @@ void surgescript_sslib_register_system(struct surgescript_vm_t* vm);
 void surgescript_sslib_register_boolean(struct surgescript_vm_t* vm);
 void surgescript_sslib_register_number(struct surgescript_vm_t* vm);
 void surgescript_sslib_register_string(struct surgescript_vm_t* vm);
+void surgescript_sslib_register_stringbuilder(struct surgescript_vm_t* vm);
 void surgescript_sslib_register_console(struct surgescript_vm_t* vm);
 void surgescript_sslib_register_math(struct surgescript_vm_t* vm);
 void surgescript_sslib_register_dictionary(struct surgescript_vm_t* vm);
@@ -0,0 +1,183 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2016-2024 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * runtime/sslib/stringbuilder.c
+ * SurgeScript standard library: StringBuilder
+ */
+
+#include <string.h>
+#include "../vm.h"
+#include "../object.h"
+#include "../object_manager.h"
+#include "../../third_party/utf8.h"
+#include "../../util/util.h"
+
+/* private stuff */
+static void fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_append(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_appendline(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+static void fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out);
+
+/* the contents of a StringBuilder: a growable buffer */
+typedef struct stringbuilder_t stringbuilder_t;
+struct stringbuilder_t
+{
+    char* buffer; /* a NUL-terminated UTF-8 string */
+    size_t length; /* length of the buffer, in bytes (excluding the NUL) */
+    size_t capacity; /* allocated bytes */
+    size_t char_count; /* length of the buffer, in UTF-8 characters */
+};
+
+/* utilities */
+static const size_t INITIAL_CAPACITY = 64;
+static void append(stringbuilder_t* sb, const char* str, size_t length);
+static void append_var(stringbuilder_t* sb, const surgescript_var_t* var, const surgescript_objectmanager_t* manager);
+
+/*
+ * surgescript_sslib_register_stringbuilder()
+ * Register methods
+ */
+void surgescript_sslib_register_stringbuilder(surgescript_vm_t* vm)
+{
+    surgescript_vm_bind_ex(vm, "StringBuilder", "constructor", fun_constructor, 0);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "destructor", fun_destructor, 0);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "state:main", fun_main, 0);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "append", fun_append, 1);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "appendLine", fun_appendline, 1);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "clear", fun_clear, 0);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "get_length", fun_getlength, 0);
+    surgescript_vm_bind_ex(vm, "StringBuilder", "toString", fun_tostring, 0);
+}
+
+
+
+/* my functions */
+
+/* constructor: start with an empty buffer */
+void fun_constructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = ssmalloc(sizeof *sb);
+
+    sb->capacity = INITIAL_CAPACITY;
+    sb->buffer = ssmalloc(sb->capacity * sizeof(*(sb->buffer)));
+    sb->buffer[0] = '\0';
+    sb->length = 0;
+    sb->char_count = 0;
+
+    surgescript_object_set_userdata(object, sb);
+}
+
+/* destructor */
+void fun_destructor(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = (stringbuilder_t*)surgescript_object_userdata(object);
+
+    ssfree(sb->buffer);
+    surgescript_object_set_userdata(object, ssfree(sb));
+}
+
+/* main state */
+void fun_main(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    surgescript_object_set_active(object, false); /* we don't need to spend time updating this object */
+}
+
+/* append(value): appends the string representation of value to the buffer. Returns the StringBuilder itself */
+void fun_append(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = (stringbuilder_t*)surgescript_object_userdata(object);
+
+    append_var(sb, param[0], surgescript_object_manager(object));
+    surgescript_var_set_objecthandle(out, surgescript_object_handle(object));
+}
+
+/* appendLine(value): appends value followed by a line break. Returns the StringBuilder itself */
+void fun_appendline(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = (stringbuilder_t*)surgescript_object_userdata(object);
+
+    append_var(sb, param[0], surgescript_object_manager(object));
+    append(sb, "\n", 1);
+    surgescript_var_set_objecthandle(out, surgescript_object_handle(object));
+}
+
+/* clear(): empties the buffer (its memory is kept for reuse). Returns the StringBuilder itself */
+void fun_clear(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = (stringbuilder_t*)surgescript_object_userdata(object);
+
+    sb->buffer[0] = '\0';
+    sb->length = 0;
+    sb->char_count = 0;
+    surgescript_var_set_objecthandle(out, surgescript_object_handle(object));
+}
+
+/* length of the string being built, in characters */
+void fun_getlength(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = (stringbuilder_t*)surgescript_object_userdata(object);
+    surgescript_var_set_number(out, sb->char_count);
+}
+
+/* toString(): the string that has been built */
+void fun_tostring(surgescript_object_t* object, const surgescript_var_t** param, int num_params, surgescript_var_t* out)
+{
+    stringbuilder_t* sb = (stringbuilder_t*)surgescript_object_userdata(object);
+    surgescript_var_set_string(out, sb->buffer);
+}
+
+
+
+/* utilities */
+
+/* appends length bytes of str to the buffer, growing it geometrically */
+void append(stringbuilder_t* sb, const char* str, size_t length)
+{
+    if(sb->length + length >= sb->capacity) {
+        while(sb->length + length >= sb->capacity)
+            sb->capacity *= 2;
+        sb->buffer = ssrealloc(sb->buffer, sb->capacity * sizeof(*(sb->buffer)));
+    }
+
+    memcpy(sb->buffer + sb->length, str, length);
+    sb->length += length;
+    sb->buffer[sb->length] = '\0';
+    sb->char_count += u8_strlen(sb->buffer + sb->length - length);
+}
+
+/* appends the string representation of a variable to the buffer */
+void append_var(stringbuilder_t* sb, const surgescript_var_t* var, const surgescript_objectmanager_t* manager)
+{
+    if(surgescript_var_is_string(var)) {
+        const char* str = surgescript_var_fast_get_string(var);
+        append(sb, str, strlen(str));
+    }
+    else if(surgescript_var_is_objecthandle(var)) {
+        char* str = surgescript_var_get_string(var, manager); /* calls toString() */
+        append(sb, str, strlen(str));
+        ssfree(str);
+    }
+    else {
+        char buf[32];
+        const char* str = surgescript_var_to_string(var, buf, sizeof(buf));
+        append(sb, str, strlen(str));
+    }
+}
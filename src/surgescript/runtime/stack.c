@@ -32,25 +32,46 @@
  * |     some data       |
  * |     some data       |
  * |     some data       |
- * |    previous BP      | <-- BP
+ * |   (frame record)    | <-- BP
  * +---------------------+
  * |     some data       |
  * |     some data       |
- * |   previous BP (0)   |
+ * |   (frame record)    |
  * +---------------------+
+ *
+ * The data is made of segments of contiguous variables (values, not
+ * pointers), so that pushing and popping are plain stores. The stack
+ * starts small and grows one segment at a time up to a maximum size.
+ * Segments never move, so the addresses of the cells are stable.
+ *
+ * The cell at BP is reserved for the frame: the previous BP is kept in
+ * a parallel array of frame records, indexed by the BP of the frame.
+ * Cells above SP are always null.
  */
 
 /* constants */
-static const size_t SSSTACK_INITIAL_SIZE = 65536; /* 64K */
+#define SSSTACK_SEGMENT_SHIFT 10
+#define SSSTACK_SEGMENT_SIZE (1 << SSSTACK_SEGMENT_SHIFT) /* 1K cells per segment */
+#define SSSTACK_SEGMENT_MASK (SSSTACK_SEGMENT_SIZE - 1)
+static const size_t SSSTACK_DEFAULT_MAX_SIZE = 65536; /* 64K */
+static const size_t SSSTACK_MIN_MAX_SIZE = SSSTACK_SEGMENT_SIZE;
 
 /* the stack structure */
 struct surgescript_stack_t
 {
-    size_t size;                     /* size of the stack */
+    size_t size;                     /* size of the stack (allocated cells) */
+    size_t max_size;                 /* the stack can't grow beyond this */
     surgescript_stackptr_t sp, bp;   /* pointers */
-    surgescript_var_t** data;        /* stack data */
+    surgescript_var_t** segment;     /* stack data */
+    size_t segment_count;            /* number of segments */
+    surgescript_stackptr_t* frame;   /* frame[bp] is the previous bp */
 };
 
+/* helpers */
+#define CELL(stack, idx) surgescript_var_at((stack)->segment[(idx) >> SSSTACK_SEGMENT_SHIFT], (idx) & SSSTACK_SEGMENT_MASK)
+static void grow(surgescript_stack_t* stack, size_t required_size);
+static void clear_cells(surgescript_stack_t* stack, surgescript_stackptr_t first, size_t count);
+
 
 /* -------------------------------
  * public methods
@@ -63,15 +84,17 @@ struct surgescript_stack_t
 surgescript_stack_t* surgescript_stack_create()
 {
     surgescript_stack_t* stack = ssmalloc(sizeof *stack);
-    size_t size = SSSTACK_INITIAL_SIZE;
 
-    stack->data = ssmalloc(size * sizeof(*(stack->data)));
-    stack->size = size;
+    stack->segment = NULL;
+    stack->segment_count = 0;
+    stack->frame = NULL;
+    stack->size = 0;
+    stack->max_size = SSSTACK_DEFAULT_MAX_SIZE;
+    grow(stack, 1);
+
     stack->sp = stack->bp = 0;
-    while(size)
-        stack->data[--size] = NULL;
+    stack->frame[0] = 0;
 
-    stack->data[0] = surgescript_var_set_rawbits(surgescript_var_create(), stack->bp);
     return stack;
 }
 
@@ -81,36 +104,46 @@ surgescript_stack_t* surgescript_stack_create()
  */
 surgescript_stack_t* surgescript_stack_destroy(surgescript_stack_t* stack)
 {
-    for(surgescript_stackptr_t i = stack->size - 1; i >= 0; i--) {
-        if(stack->data[i] != NULL)
-            surgescript_var_destroy(stack->data[i]);
-    }
+    for(size_t i = 0; i < stack->segment_count; i++)
+        surgescript_var_destroy_array(stack->segment[i], SSSTACK_SEGMENT_SIZE);
 
-    ssfree(stack->data);
+    ssfree(stack->segment);
+    ssfree(stack->frame);
     ssfree(stack);
     return NULL;
 }
 
 /*
  * surgescript_stack_push()
- * Pushes a variable onto the stack
+ * Pushes a variable onto the stack. The stack stores values, so
+ * the contents of data are moved to the stack and data is destroyed
  */
 void surgescript_stack_push(surgescript_stack_t* stack, surgescript_var_t* data)
 {
-    if(++stack->sp < stack->size)
-        stack->data[stack->sp] = data;
-    else
-        ssfatal("Runtime Error: surgescript_stack_push() - stack overflow");
+    surgescript_stack_push_copy(stack, data);
+    surgescript_var_destroy(data);
+}
+
+/*
+ * surgescript_stack_push_copy()
+ * Pushes a copy of data onto the stack
+ */
+void surgescript_stack_push_copy(surgescript_stack_t* stack, const surgescript_var_t* data)
+{
+    if(++stack->sp >= stack->size)
+        grow(stack, stack->sp + 1);
+
+    surgescript_var_copy(CELL(stack, stack->sp), data);
 }
 
 /*
  * surgescript_stack_pop()
- * Pops a variable from the stack, deallocating it
+ * Pops a variable from the stack
  */
 void surgescript_stack_pop(surgescript_stack_t* stack)
 {
     if(stack->sp > stack->bp) {
-        stack->data[stack->sp] = surgescript_var_destroy(stack->data[stack->sp]);
+        surgescript_var_set_null(CELL(stack, stack->sp));
         stack->sp--;
     }
     else
@@ -123,10 +156,12 @@ void surgescript_stack_pop(surgescript_stack_t* stack)
  */
 void surgescript_stack_pushenv(surgescript_stack_t* stack)
 {
-    /* push prev BP & set new BP */
-    surgescript_var_t* prev_bp = surgescript_var_set_rawbits(surgescript_var_create(), stack->bp);
-    surgescript_stack_push(stack, prev_bp);
-    stack->bp = stack->sp; /* the base of the stack points to the previous bp */
+    /* reserve a cell for the frame & set new BP */
+    if(++stack->sp >= stack->size)
+        grow(stack, stack->sp + 1);
+
+    stack->frame[stack->sp] = stack->bp;
+    stack->bp = stack->sp; /* the base of the stack points to the frame */
 }
 
 /*
@@ -136,15 +171,10 @@ void surgescript_stack_pushenv(surgescript_stack_t* stack)
 void surgescript_stack_popenv(surgescript_stack_t* stack)
 {
     if(stack->sp > 0) {
-        /* get previous bp & deallocate everything in between */
-        surgescript_stackptr_t i, prev_bp = surgescript_var_get_rawbits(stack->data[stack->bp]);
-        for(i = stack->sp; i >= stack->bp; i--) {
-            if(stack->data[i] != NULL)
-                stack->data[i] = surgescript_var_destroy(stack->data[i]);
-        }
-
+        /* clear everything in between & restore the previous bp */
+        clear_cells(stack, stack->bp, stack->sp - stack->bp + 1);
         stack->sp = stack->bp - 1;
-        stack->bp = prev_bp;
+        stack->bp = stack->frame[stack->bp];
     }
     else
         ssfatal("Runtime Error: surgescript_stack_popenv() has found an empty stack");
@@ -156,8 +186,11 @@ void surgescript_stack_popenv(surgescript_stack_t* stack)
  */
 void surgescript_stack_pushn(surgescript_stack_t* stack, size_t n)
 {
-    while(n--)
-        surgescript_stack_push(stack, surgescript_var_create());
+    /* cells above SP are already null */
+    if(stack->sp + n >= stack->size)
+        grow(stack, stack->sp + n + 1);
+
+    stack->sp += n;
 }
 
 /*
@@ -166,8 +199,14 @@ void surgescript_stack_pushn(surgescript_stack_t* stack, size_t n)
  */
 void surgescript_stack_popn(surgescript_stack_t* stack, size_t n)
 {
-    while(n--)
-        surgescript_stack_pop(stack);
+    surgescript_stackptr_t count = n;
+
+    if(stack->sp - stack->bp >= count) {
+        stack->sp -= count;
+        clear_cells(stack, stack->sp + 1, count);
+    }
+    else
+        ssfatal("Runtime Error: can't surgescript_stack_popn() - empty stack");
 }
 
 /*
@@ -176,7 +215,7 @@ void surgescript_stack_popn(surgescript_stack_t* stack, size_t n)
  */
 const surgescript_var_t* surgescript_stack_top(const surgescript_stack_t* stack)
 {
-    return stack->data[stack->sp];
+    return CELL(stack, stack->sp);
 }
 
 
@@ -189,12 +228,62 @@ const surgescript_var_t* surgescript_stack_peek(const surgescript_stack_t* stack
     const surgescript_stackptr_t idx = stack->bp + offset;
 
     if(idx >= 0 && idx <= stack->sp)
-        return stack->data[idx];
+        return CELL(stack, idx);
 
     ssfatal("Runtime Error: surgescript_stack_peek() can't read an element (%d) that is out of bounds [%d, %d]", idx, 0, stack->sp);
     return NULL;
 }
 
+/*
+ * surgescript_stack_peek_top()
+ * Reads the (top-depth)-th element from the stack
+ */
+const surgescript_var_t* surgescript_stack_peek_top(const surgescript_stack_t* stack, surgescript_stackptr_t depth)
+{
+    const surgescript_stackptr_t idx = stack->sp - depth;
+
+    if(idx >= 0 && depth >= 0)
+        return CELL(stack, idx);
+
+    ssfatal("Runtime Error: surgescript_stack_peek_top() can't read an element (%d) that is out of bounds [%d, %d]", idx, 0, stack->sp);
+    return NULL;
+}
+
+/*
+ * surgescript_stack_reuseenv()
+ * Reuses the current environment, which has m parameters (used in tail calls):
+ * the environment is moved offset cells up (down if offset < 0) and the n topmost
+ * elements are copied to its parameters, i.e., to stack[base-n .. base-1] after
+ * the move. The rest of the environment and the old parameters that haven't
+ * been overwritten are cleared. The previous BP is kept
+ */
+void surgescript_stack_reuseenv(surgescript_stack_t* stack, size_t n, size_t m, surgescript_stackptr_t offset)
+{
+    surgescript_stackptr_t count = n;
+    surgescript_stackptr_t base = stack->bp + offset; /* the new BP */
+    surgescript_stackptr_t first = stack->bp - (surgescript_stackptr_t)m; /* the first old parameter */
+
+    if(stack->sp - stack->bp >= count && base - count >= 0 && base <= stack->sp) {
+        /* move the frame record */
+        stack->frame[base] = stack->frame[stack->bp];
+
+        /* copy the parameters. They're copied downwards, so the ones
+           that haven't been copied yet can't be overwritten */
+        for(surgescript_stackptr_t i = 0; i < count; i++)
+            surgescript_var_copy(CELL(stack, base - count + i), CELL(stack, stack->sp - count + 1 + i));
+
+        /* clear the old parameters below the new ones */
+        if(first < base - count)
+            clear_cells(stack, first, base - count - first);
+
+        /* clear the environment */
+        clear_cells(stack, base, stack->sp - base + 1);
+        stack->sp = stack->bp = base;
+    }
+    else
+        ssfatal("Runtime Error: surgescript_stack_reuseenv() can't move %d elements", (int)count);
+}
+
 /*
  * surgescript_stack_poke()
  * Writes data on stack[base+offset]
@@ -204,11 +293,26 @@ void surgescript_stack_poke(surgescript_stack_t* stack, surgescript_stackptr_t o
     const surgescript_stackptr_t idx = stack->bp + offset;
 
     if(idx >= 0 && idx <= stack->sp)
-        surgescript_var_copy(stack->data[idx], data);
+        surgescript_var_copy(CELL(stack, idx), data);
     else
         ssfatal("Runtime Error: surgescript_stack_poke() can't write to an element (%d) that is out of bounds [%d, %d]", idx, 0, stack->sp);
 }
 
+/*
+ * surgescript_stack_at()
+ * Gets the (base+offset)-th element from the stack, so that it can be modified
+ */
+surgescript_var_t* surgescript_stack_at(surgescript_stack_t* stack, surgescript_stackptr_t offset)
+{
+    const surgescript_stackptr_t idx = stack->bp + offset;
+
+    if(idx >= 0 && idx <= stack->sp)
+        return CELL(stack, idx);
+
+    ssfatal("Runtime Error: surgescript_stack_at() can't access an element (%d) that is out of bounds [%d, %d]", idx, 0, stack->sp);
+    return NULL;
+}
+
 /*
  * surgescript_stack_empty()
  * Is the stack empty?
@@ -225,12 +329,10 @@ int surgescript_stack_empty(const surgescript_stack_t* stack)
 void surgescript_stack_scan_objects(surgescript_stack_t* stack, void* userdata, bool (*callback)(unsigned,void*))
 {
     for(surgescript_stackptr_t i = stack->sp - 1; i >= 0; i--) { /* check all environments */
-        if(stack->data[i] != NULL) {
-            unsigned handle = surgescript_var_get_objecthandle(stack->data[i]);
-            if(handle != 0) { /* if it is an object and not null */
-                if(!callback(handle, userdata)) /* if the handle is broken */
-                    surgescript_var_set_null(stack->data[i]); /* fix it */
-            }
+        unsigned handle = surgescript_var_get_objecthandle(CELL(stack, i));
+        if(handle != 0) { /* if it is an object and not null */
+            if(!callback(handle, userdata)) /* if the handle is broken */
+                surgescript_var_set_null(CELL(stack, i)); /* fix it */
         }
     }
 }
@@ -242,4 +344,57 @@ void surgescript_stack_scan_objects(surgescript_stack_t* stack, void* userdata,
 size_t surgescript_stack_size(const surgescript_stack_t* stack)
 {
     return stack->sp;
+}
+
+/*
+ * surgescript_stack_set_max_size()
+ * Sets the maximum number of cells of the stack (it grows on demand up to
+ * this size). The maximum can't be lower than the currently allocated size
+ */
+void surgescript_stack_set_max_size(surgescript_stack_t* stack, size_t max_size)
+{
+    stack->max_size = ssmax(max_size, ssmax(stack->size, SSSTACK_MIN_MAX_SIZE));
+}
+
+/*
+ * surgescript_stack_max_size()
+ * The maximum number of cells of the stack
+ */
+size_t surgescript_stack_max_size(const surgescript_stack_t* stack)
+{
+    return stack->max_size;
+}
+
+
+
+/* -------------------------------
+ * private methods
+ * ------------------------------- */
+
+/* allocates segments until the stack has at least required_size cells */
+void grow(surgescript_stack_t* stack, size_t required_size)
+{
+    if(required_size > stack->max_size)
+        ssfatal("Runtime Error: stack overflow (the maximum stack size is %zu)", stack->max_size);
+
+    while(stack->size < required_size) {
+        stack->segment = ssrealloc(stack->segment, (stack->segment_count + 1) * sizeof(*(stack->segment)));
+        stack->segment[stack->segment_count++] = surgescript_var_create_array(SSSTACK_SEGMENT_SIZE);
+        stack->size += SSSTACK_SEGMENT_SIZE;
+    }
+
+    stack->frame = ssrealloc(stack->frame, stack->size * sizeof(*(stack->frame)));
+}
+
+/* sets count cells to null, starting at stack[first] */
+void clear_cells(surgescript_stack_t* stack, surgescript_stackptr_t first, size_t count)
+{
+    while(count > 0) {
+        size_t offset = first & SSSTACK_SEGMENT_MASK;
+        size_t n = ssmin(count, SSSTACK_SEGMENT_SIZE - offset);
+
+        surgescript_var_clear_array(surgescript_var_at(stack->segment[first >> SSSTACK_SEGMENT_SHIFT], offset), n);
+        first += n;
+        count -= n;
+    }
 }
\ No newline at end of file
@@ -36,17 +36,23 @@ struct surgescript_var_t;
 /* public methods */
 surgescript_stack_t* surgescript_stack_create();
 surgescript_stack_t* surgescript_stack_destroy(surgescript_stack_t* stack);
-void surgescript_stack_push(surgescript_stack_t* stack, struct surgescript_var_t* data); /* pushes data to the stack */
-void surgescript_stack_pop(surgescript_stack_t* stack); /* pops and deallocates a var from the stack */
+void surgescript_stack_push(surgescript_stack_t* stack, struct surgescript_var_t* data); /* pushes data to the stack, destroying data */
+void surgescript_stack_push_copy(surgescript_stack_t* stack, const struct surgescript_var_t* data); /* pushes a copy of data to the stack */
+void surgescript_stack_pop(surgescript_stack_t* stack); /* pops a var from the stack */
 void surgescript_stack_pushenv(surgescript_stack_t* stack); /* pushes an environment */
 void surgescript_stack_popenv(surgescript_stack_t* stack); /* pops an environment */
 void surgescript_stack_pushn(surgescript_stack_t* stack, size_t n); /* pushes n empty variables to the stack */
 void surgescript_stack_popn(surgescript_stack_t* stack, size_t n); /* pops n variables from the stack */
 const struct surgescript_var_t* surgescript_stack_top(const surgescript_stack_t* stack); /* gets the topmost element */
 const struct surgescript_var_t* surgescript_stack_peek(const surgescript_stack_t* stack, surgescript_stackptr_t offset); /* reads stack[base + offset] */
+const struct surgescript_var_t* surgescript_stack_peek_top(const surgescript_stack_t* stack, surgescript_stackptr_t depth); /* reads stack[top - depth] */
+void surgescript_stack_reuseenv(surgescript_stack_t* stack, size_t n, size_t m, surgescript_stackptr_t offset); /* moves the environment, which has m parameters, offset cells up; the n topmost elements become its parameters and the rest is cleared */
 void surgescript_stack_poke(surgescript_stack_t* stack, surgescript_stackptr_t offset, const struct surgescript_var_t* data); /* writes data on stack[base + offset] */
+struct surgescript_var_t* surgescript_stack_at(surgescript_stack_t* stack, surgescript_stackptr_t offset); /* gets stack[base + offset] */
 int surgescript_stack_empty(const surgescript_stack_t* stack); /* is the stack empty? */
 void surgescript_stack_scan_objects(surgescript_stack_t* stack, void* userdata, bool (*callback)(unsigned,void*));
 size_t surgescript_stack_size(const surgescript_stack_t* stack); /* stack size */
+void surgescript_stack_set_max_size(surgescript_stack_t* stack, size_t max_size); /* the stack grows on demand up to max_size cells */
+size_t surgescript_stack_max_size(const surgescript_stack_t* stack); /* maximum number of cells */
 
 #endif
@@ -27,6 +27,9 @@
 #include <float.h>
 #include <ctype.h>
 #include <locale.h>
+#if !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#endif
 #include "variable.h"
 #include "object.h"
 #include "object_manager.h"
@@ -39,9 +42,9 @@
 
 /* possible variable types */
 enum surgescript_vartype_t {
-    SSVAR_NULL = 0,
+    SSVAR_NUMBER = 0,
+    SSVAR_NULL,
     SSVAR_BOOL,
-    SSVAR_NUMBER,
     SSVAR_STRING,
     SSVAR_OBJECTHANDLE,
     SSVAR_RAW, /* binary */
@@ -57,58 +60,178 @@ static const int typecode[] = {
     [SSVAR_RAW] = 'r'
 };
 
-/* the variable struct */
+/*
+
+the variable struct
+
+A variable is a NaN-boxed 64-bit word. Numbers are stored as plain doubles.
+Any other type is stored in the 48-bit payload of a negative quiet NaN whose
+bits 48-50 hold the type (1 to 5). Arithmetic never yields such NaNs (the
+default NaN has a zero tag), and the NaNs we store are canonicalized anyway.
+
+    number      any double (NaNs are canonicalized)
+    null        0xFFF9 0000 0000 0000
+    bool        0xFFFA 0000 0000 000b
+    string      0xFFFB pppp pppp pppp  (48-bit pointer to a managed string, or a far string)
+    object      0xFFFC 0000 hhhh hhhh  (32-bit handle)
+    raw         0xFFFD rrrr rrrr rrrr  (48-bit signed integer)
+
+*/
 struct surgescript_var_t
 {
-    /* data */
     union {
-        surgescript_managedstring_t* managed_string;
+        uint64_t bits;
         double number;
-        unsigned handle:32;
-        bool boolean;
-        int64_t raw;
     };
+};
+SS_STATIC_ASSERT(sizeof(surgescript_var_t) == SURGESCRIPT_VAR_SIZE, var_size);
+
+#define BOX_SHIFT 48
+#define BOX_PAYLOAD_MASK UINT64_C(0x0000FFFFFFFFFFFF)
+#define BOX_TAG_MASK (~BOX_PAYLOAD_MASK)
+#define BOX(type) (UINT64_C(0xFFF8000000000000) | ((uint64_t)(type) << BOX_SHIFT)) /* boxed value with a zero payload */
+#define BOX_MIN BOX(SSVAR_NULL) /* bit patterns below this are numbers */
+#define CANONICAL_NAN UINT64_C(0x7FF8000000000000)
+#define RAW_MAX ((INT64_C(1) << (BOX_SHIFT - 1)) - 1) /* raw values are saturated to [-RAW_MAX, RAW_MAX] */
+
+#define IS_NUMBER(var) ((var)->bits < BOX_MIN)
+#define HAS_TYPE(var, type) (((var)->bits & BOX_TAG_MASK) == BOX(type)) /* for non-numeric types only */
+#define TYPEOF(var) (IS_NUMBER(var) ? SSVAR_NUMBER : (enum surgescript_vartype_t)(((var)->bits >> BOX_SHIFT) & 7))
+#define PAYLOAD(var) ((var)->bits & BOX_PAYLOAD_MASK)
+#define BOOLEAN(var) ((bool)((var)->bits & 1))
+#define HANDLE(var) ((unsigned)PAYLOAD(var))
+#define MANAGED_STRING(var) (IS_FAR_STRING(var) ? far_string(PAYLOAD(var)) : (surgescript_managedstring_t*)(uintptr_t)PAYLOAD(var))
+
+/*
+
+far strings
+
+Pointers to managed strings may not fit in 48 bits: think of arm64 with top-byte
+tags (Android tags its heap pointers) or of x86-64 with 5-level paging. These
+strings are stored in a table of far strings and the payload holds
+(table << 33) | (index << 1) | 1 instead. Managed strings are at least 8-byte
+aligned, so the lowest bit tells a pointer from an index.
+
+Each pool of variables (i.e., each VM) has its own table, created when it's
+first needed. Table 0 is used by the variables that are created outside of
+any VM and is shared by all threads. The tables are registered so that any
+variable can be read in any context (e.g., a parameter passed by the host).
+Each variable owns its entry of the table and gives it back when released.
+
+*/
+#define FAR_MIN_ENTRIES_LOG2 6
+#define FAR_MIN_ENTRIES (1 << FAR_MIN_ENTRIES_LOG2) /* entries of the first chunk of a table */
+#define FAR_MAX_CHUNKS (33 - FAR_MIN_ENTRIES_LOG2) /* chunk c has FAR_MIN_ENTRIES << c entries */
+#define FAR_MAX_ENTRIES UINT32_MAX
+#define FAR_TABLE_BITS 15
+#define FAR_MAX_TABLES (1 << FAR_TABLE_BITS)
+#define FAR_REGISTRY_BLOCK 256 /* the registry of tables is allocated in blocks of this size */
+#define IS_FAR_STRING(var) ((var)->bits & 1) /* for strings only */
+
+typedef union surgescript_farstring_t surgescript_farstring_t;
+union surgescript_farstring_t
+{
+    surgescript_managedstring_t* managed_string; /* entry in use */
+    uint32_t next; /* free list: 1 + index of the next free entry, or 0 */
+};
 
-    /* data type */
-    enum surgescript_vartype_t type;
+typedef struct surgescript_fartable_t surgescript_fartable_t;
+struct surgescript_fartable_t
+{
+    surgescript_farstring_t* chunk[FAR_MAX_CHUNKS]; /* chunks are allocated when needed and are never moved */
+    uint32_t count; /* number of entries ever allocated */
+    uint32_t free; /* free list: 1 + index of the first free entry, or 0 */
+    uint32_t number; /* the number of this table in the registry (0 if not registered) */
 };
 
-/* a pool of variables */
-#define VARPOOL_NUM_BUCKETS 43690 /* sizeof(surgescript_varpool_t) is approximately 1 MB */
+typedef union surgescript_fartableref_t surgescript_fartableref_t;
+union surgescript_fartableref_t
+{
+    surgescript_fartable_t* table; /* registered table */
+    uint32_t next; /* free list: the number of the next free slot, or 0 */
+};
 
-typedef struct surgescript_varpool_t surgescript_varpool_t;
+static surgescript_fartable_t far_host_table = { { NULL }, 0, 0, 0 }; /* table 0 */
+static surgescript_fartableref_t* far_registry[FAR_MAX_TABLES / FAR_REGISTRY_BLOCK] = { NULL };
+static uint32_t far_table_count = 1; /* number of slots of the registry ever used, including table 0 */
+static uint32_t far_free_table = 0; /* free list of the registry: the number of the first free slot, or 0 */
+static uint64_t new_far_string(surgescript_managedstring_t* managed_string);
+static void delete_far_string(uint64_t payload);
+static inline surgescript_managedstring_t* far_string(uint64_t payload);
+static inline surgescript_farstring_t* far_entry(const surgescript_fartable_t* table, uint32_t index);
+static inline surgescript_fartable_t* far_table(uint32_t number);
+static void register_far_table(surgescript_fartable_t* table);
+static void unregister_far_table(surgescript_fartable_t* table);
+static surgescript_fartable_t* delete_far_table(surgescript_fartable_t* table);
+
+#if !defined(__STDC_NO_ATOMICS__)
+static atomic_flag far_lock = ATOMIC_FLAG_INIT; /* protects table 0 and the registry */
+#define LOCK_FAR_STRINGS() while(atomic_flag_test_and_set_explicit(&far_lock, memory_order_acquire))
+#define UNLOCK_FAR_STRINGS() atomic_flag_clear_explicit(&far_lock, memory_order_release)
+#else
+#define LOCK_FAR_STRINGS() (void)0 /* no C11 atomics */
+#define UNLOCK_FAR_STRINGS() (void)0
+#endif
+
+/* a pool of variables. Pages grow geometrically, so that a
+   VM that uses few variables doesn't reserve a lot of memory */
+#define VARPOOL_MIN_BUCKETS 1024 /* the first page takes approximately 8 KB */
+#define VARPOOL_MAX_BUCKETS 131072 /* the largest pages take approximately 1 MB */
+
+typedef struct surgescript_varpage_t surgescript_varpage_t;
 typedef struct surgescript_varbucket_t surgescript_varbucket_t;
-struct surgescript_varpool_t
+struct surgescript_varbucket_t
+{
+    union {
+        /* the 1st element of the bucket (var) shares
+           the same address as the bucket itself */
+        surgescript_var_t var; /* var data */
+        surgescript_varbucket_t* next; /* free list */
+    };
+};
+
+struct surgescript_varpage_t
 {
+    surgescript_varpage_t* next;
+    int bucket_count; /* number of buckets of this page */
+
     /* a pool is a collection of buckets */
-    struct surgescript_varbucket_t {
-        union {
-            /* the 1st element of the bucket (var) shares
-               the same address as the bucket itself */
-            surgescript_var_t var; /* var data */
-            surgescript_varbucket_t* next; /* free list */
-        };
-        bool in_use; /* is this bucket currently in use? */
-    } bucket[VARPOOL_NUM_BUCKETS];
-
-    surgescript_varpool_t* next;
+    surgescript_varbucket_t bucket[];
 };
 
 static SS_FORCE_INLINE surgescript_varbucket_t* allocate_bucket();
 static SS_FORCE_INLINE void free_bucket(surgescript_varbucket_t* bucket);
-static surgescript_varpool_t* new_varpool(surgescript_varpool_t* next);
-static surgescript_varpool_t* delete_varpools(surgescript_varpool_t* head);
-static surgescript_varpool_t* varpool = NULL;
-static surgescript_varbucket_t* varpool_currbucket = NULL;
+static surgescript_varpage_t* new_varpage(surgescript_varpage_t* next, int bucket_count);
+static surgescript_varpage_t* delete_varpages(surgescript_varpage_t* head);
+static int compare_varpages(const void* a, const void* b);
+static int find_varpage(surgescript_varpage_t** sorted_pages, int count, const surgescript_varbucket_t* bucket);
+
+/* a pool is a collection of pages */
+struct surgescript_varpool_t
+{
+    surgescript_varpage_t* pages; /* linked list */
+    surgescript_varbucket_t* currbucket; /* free list */
+    surgescript_fartable_t* far_strings; /* table of far strings, created when needed */
+    size_t page_count; /* statistics */
+    size_t capacity; /* number of buckets of all pages */
+    size_t live;
+    size_t peak;
+};
+
+static SS_THREAD_LOCAL surgescript_varpool_t* varpool = NULL; /* the pool selected by the calling thread */
 
 /* helpers */
 #define FIRST_BUCKET(pool) (&((pool)->bucket[0])) /* the first bucket of a pool */
 #define RELEASE_DATA(var) do { \
-    if((var)->type == SSVAR_STRING) \
-        surgescript_managedstring_destroy((var)->managed_string); \
-    (var)->raw = 0; /* must clear all bits */ \
+    if(HAS_TYPE((var), SSVAR_STRING)) { \
+        surgescript_managedstring_destroy(MANAGED_STRING(var)); \
+        if(IS_FAR_STRING(var)) \
+            delete_far_string(PAYLOAD(var)); \
+    } \
 } while(0)
 
+static inline uint64_t box_number(double number);
+static inline uint64_t box_string(surgescript_managedstring_t* managed_string);
 static inline bool is_number(const char* str);
 static inline void convert_decimal_point(char* str);
 
@@ -120,13 +243,14 @@ static inline void convert_decimal_point(char* str);
 
 /*
  * surgescript_var_create()
- * Creates an empty, null variable
+ * Creates an empty, null variable. It's taken from the selected pool or,
+ * if there is none (i.e., we're outside of a VM), allocated separately.
+ * Destroy it in the same context (the same VM, or outside of any VM)
  */
 surgescript_var_t* surgescript_var_create()
 {
     surgescript_var_t* var = (surgescript_var_t*)allocate_bucket();
-    var->type = SSVAR_NULL;
-    var->raw = 0;
+    var->bits = BOX(SSVAR_NULL);
     return var;
 }
 
@@ -141,6 +265,55 @@ surgescript_var_t* surgescript_var_destroy(surgescript_var_t* var)
     return NULL;
 }
 
+/*
+ * surgescript_var_create_array()
+ * Creates a contiguous array of length null variables
+ * (these aren't taken from the pool; don't surgescript_var_destroy() them)
+ */
+surgescript_var_t* surgescript_var_create_array(size_t length)
+{
+    return surgescript_var_init_array(ssmalloc(length * sizeof(surgescript_var_t)), length);
+}
+
+/*
+ * surgescript_var_init_array()
+ * Fills a block of uninitialized memory with length null variables. The
+ * block must be suitably aligned and hold length * SURGESCRIPT_VAR_SIZE bytes
+ */
+surgescript_var_t* surgescript_var_init_array(void* memory, size_t length)
+{
+    surgescript_var_t* array = (surgescript_var_t*)memory;
+
+    for(size_t i = 0; i < length; i++)
+        array[i].bits = BOX(SSVAR_NULL);
+
+    return array;
+}
+
+/*
+ * surgescript_var_destroy_array()
+ * Destroys an array created with surgescript_var_create_array()
+ */
+surgescript_var_t* surgescript_var_destroy_array(surgescript_var_t* array, size_t length)
+{
+    surgescript_var_clear_array(array, length);
+    ssfree(array);
+    return NULL;
+}
+
+/*
+ * surgescript_var_clear_array()
+ * Sets all variables of a contiguous array to null. Only the
+ * strings need to be released; everything else is a plain store
+ */
+void surgescript_var_clear_array(surgescript_var_t* array, size_t length)
+{
+    for(size_t i = 0; i < length; i++) {
+        RELEASE_DATA(&array[i]);
+        array[i].bits = BOX(SSVAR_NULL);
+    }
+}
+
 
 
 
@@ -153,8 +326,7 @@ surgescript_var_t* surgescript_var_destroy(surgescript_var_t* var)
 surgescript_var_t* surgescript_var_set_null(surgescript_var_t* var)
 {
     RELEASE_DATA(var);
-    var->type = SSVAR_NULL;
-    var->raw = 0;
+    var->bits = BOX(SSVAR_NULL);
     return var;
 }
 
@@ -165,8 +337,7 @@ surgescript_var_t* surgescript_var_set_null(surgescript_var_t* var)
 surgescript_var_t* surgescript_var_set_bool(surgescript_var_t* var, bool boolean)
 {
     RELEASE_DATA(var);
-    var->type = SSVAR_BOOL;
-    var->boolean = boolean; /* stdbool.h guarantees: expands to 1 or 0 */
+    var->bits = BOX(SSVAR_BOOL) | (uint64_t)boolean; /* stdbool.h guarantees: expands to 1 or 0 */
     return var;
 }
 
@@ -177,8 +348,7 @@ surgescript_var_t* surgescript_var_set_bool(surgescript_var_t* var, bool boolean
 surgescript_var_t* surgescript_var_set_number(surgescript_var_t* var, double number)
 {
     RELEASE_DATA(var);
-    var->type = SSVAR_NUMBER;
-    var->number = number;
+    var->bits = box_number(number);
     return var;
 }
 
@@ -192,8 +362,22 @@ surgescript_var_t* surgescript_var_set_string(surgescript_var_t* var, const char
         string = "";
 
     RELEASE_DATA(var);
-    var->type = SSVAR_STRING;
-    var->managed_string = surgescript_managedstring_create(string);
+    var->bits = box_string(surgescript_managedstring_create(string));
+    return var;
+}
+
+/*
+ * surgescript_var_set_interned_string()
+ * Sets the variable to the interned copy of a (valid, not-NULL) text.
+ * Equal interned strings share the same memory
+ */
+surgescript_var_t* surgescript_var_set_interned_string(surgescript_var_t* var, const char* string)
+{
+    if(string == NULL)
+        string = "";
+
+    RELEASE_DATA(var);
+    var->bits = box_string(surgescript_managedstring_intern(string));
     return var;
 }
 
@@ -207,8 +391,7 @@ surgescript_var_t* surgescript_var_set_objecthandle(surgescript_var_t* var, unsi
         return surgescript_var_set_null(var);
 
     RELEASE_DATA(var);
-    var->type = SSVAR_OBJECTHANDLE;
-    var->handle = handle;
+    var->bits = BOX(SSVAR_OBJECTHANDLE) | (uint64_t)handle;
     return var;
 }
 
@@ -222,7 +405,7 @@ surgescript_var_t* surgescript_var_set_objecthandle(surgescript_var_t* var, unsi
  */
 bool surgescript_var_is_null(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_NULL;
+    return var->bits == BOX(SSVAR_NULL);
 }
 
 /*
@@ -231,19 +414,19 @@ bool surgescript_var_is_null(const surgescript_var_t* var)
  */
 bool surgescript_var_get_bool(const surgescript_var_t* var)
 {
-    switch(var->type) {
+    switch(TYPEOF(var)) {
         case SSVAR_BOOL:
-            return var->boolean;
+            return BOOLEAN(var);
         case SSVAR_NUMBER:
-            return var->raw != 0 && fpclassify(var->number) != FP_ZERO;
+            return fpclassify(var->number) != FP_ZERO;
         case SSVAR_STRING:
-            return *(surgescript_managedstring_data(var->managed_string)) != '\0';
+            return *(surgescript_managedstring_data(MANAGED_STRING(var))) != '\0';
         case SSVAR_NULL:
             return false;
         case SSVAR_OBJECTHANDLE:
-            return var->handle != 0;
+            return HANDLE(var) != 0;
         case SSVAR_RAW:
-            return var->raw != 0;
+            return PAYLOAD(var) != 0;
     }
 
     return false;
@@ -255,13 +438,13 @@ bool surgescript_var_get_bool(const surgescript_var_t* var)
  */
 double surgescript_var_get_number(const surgescript_var_t* var)
 {
-    switch(var->type) {
+    switch(TYPEOF(var)) {
         case SSVAR_NUMBER:
             return var->number;
         case SSVAR_BOOL:
-            return var->boolean ? 1.0 : 0.0;
+            return BOOLEAN(var) ? 1.0 : 0.0;
         case SSVAR_STRING:
-            return is_number(surgescript_managedstring_data(var->managed_string)) ? ssatof(surgescript_managedstring_data(var->managed_string)) : NAN;
+            return is_number(surgescript_managedstring_data(MANAGED_STRING(var))) ? ssatof(surgescript_managedstring_data(MANAGED_STRING(var))) : NAN;
         case SSVAR_NULL:
             return 0.0;
         case SSVAR_OBJECTHANDLE:
@@ -281,15 +464,15 @@ double surgescript_var_get_number(const surgescript_var_t* var)
  */
 char* surgescript_var_get_string(const surgescript_var_t* var, const surgescript_objectmanager_t* manager)
 {
-    switch(var->type) {
+    switch(TYPEOF(var)) {
         case SSVAR_NULL:
             return ssstrdup("null");
 
         case SSVAR_BOOL:
-            return ssstrdup(var->boolean ? "true" : "false");
+            return ssstrdup(BOOLEAN(var) ? "true" : "false");
 
         case SSVAR_STRING:
-            return ssstrdup(surgescript_managedstring_data(var->managed_string));
+            return ssstrdup(surgescript_managedstring_data(MANAGED_STRING(var)));
 
         case SSVAR_NUMBER: {
             char buf[32];
@@ -299,7 +482,7 @@ char* surgescript_var_get_string(const surgescript_var_t* var, const surgescript
 
         case SSVAR_OBJECTHANDLE: {
             if(manager != NULL) {
-                surgescript_object_t* obj = surgescript_objectmanager_get(manager, var->handle);
+                surgescript_object_t* obj = surgescript_objectmanager_get(manager, HANDLE(var));
                 surgescript_var_t* tmp = surgescript_var_create(); char* str;
                 surgescript_object_call_function(obj, "toString", NULL, 0, tmp);
                 str = surgescript_var_get_string(tmp, NULL); /* discard manager */
@@ -325,9 +508,9 @@ char* surgescript_var_get_string(const surgescript_var_t* var, const surgescript
 unsigned surgescript_var_get_objecthandle(const surgescript_var_t* var)
 {
     /* will return the primitive wrapper if var doesn't store a handle */
-    switch(var->type) {
+    switch(TYPEOF(var)) {
         case SSVAR_OBJECTHANDLE:
-            return var->handle;
+            return HANDLE(var);
 
         case SSVAR_NUMBER:
             return surgescript_objectmanager_system_object(NULL, "Number");
@@ -353,30 +536,16 @@ unsigned surgescript_var_get_objecthandle(const surgescript_var_t* var)
  */
 surgescript_var_t* surgescript_var_copy(surgescript_var_t* dst, const surgescript_var_t* src)
 {
-    RELEASE_DATA(dst);
-    dst->type = src->type;
-
-    switch(src->type) {
-        case SSVAR_NULL:
-            dst->raw = 0;
-            break;
-        case SSVAR_BOOL:
-            dst->boolean = src->boolean;
-            break;
-        case SSVAR_NUMBER:
-            dst->number = src->number;
-            break;
-        case SSVAR_STRING:
-            dst->managed_string = surgescript_managedstring_clone(src->managed_string);
-            break;
-        case SSVAR_OBJECTHANDLE:
-            dst->handle = src->handle;
-            break;
-        case SSVAR_RAW:
-            dst->raw = src->raw;
-            break;
+    /* only strings need more than a plain store */
+    if(HAS_TYPE(src, SSVAR_STRING)) {
+        surgescript_managedstring_t* managed_string = surgescript_managedstring_clone(MANAGED_STRING(src));
+        RELEASE_DATA(dst);
+        dst->bits = box_string(managed_string);
+        return dst;
     }
 
+    RELEASE_DATA(dst);
+    dst->bits = src->bits;
     return dst;
 }
 
@@ -396,7 +565,7 @@ surgescript_var_t* surgescript_var_clone(const surgescript_var_t* var)
  */
 bool surgescript_var_sametype(const surgescript_var_t* a, const surgescript_var_t* b)
 {
-    return a->type == b->type;
+    return TYPEOF(a) == TYPEOF(b);
 }
 
 /*
@@ -406,7 +575,7 @@ bool surgescript_var_sametype(const surgescript_var_t* a, const surgescript_var_
  */
 int surgescript_var_typecode(const surgescript_var_t* var)
 {
-    return typecode[var->type];
+    return typecode[TYPEOF(var)];
 }
 
 /*
@@ -436,7 +605,7 @@ int surgescript_var_type2code(const char* type_name)
  */
 int surgescript_var_typecheck(const surgescript_var_t* var, int code)
 {
-    return typecode[var->type] ^ code;
+    return typecode[TYPEOF(var)] ^ code;
 }
 
 /*
@@ -445,7 +614,7 @@ int surgescript_var_typecheck(const surgescript_var_t* var, int code)
  */
 bool surgescript_var_is_string(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_STRING;
+    return HAS_TYPE(var, SSVAR_STRING);
 }
 
 /*
@@ -454,7 +623,7 @@ bool surgescript_var_is_string(const surgescript_var_t* var)
  */
 bool surgescript_var_is_bool(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_BOOL;
+    return HAS_TYPE(var, SSVAR_BOOL);
 }
 
 /*
@@ -463,7 +632,7 @@ bool surgescript_var_is_bool(const surgescript_var_t* var)
  */
 bool surgescript_var_is_number(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_NUMBER;
+    return IS_NUMBER(var);
 }
 
 /*
@@ -472,7 +641,7 @@ bool surgescript_var_is_number(const surgescript_var_t* var)
  */
 bool surgescript_var_is_objecthandle(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_OBJECTHANDLE;
+    return HAS_TYPE(var, SSVAR_OBJECTHANDLE);
 }
 
 /*
@@ -481,11 +650,11 @@ bool surgescript_var_is_objecthandle(const surgescript_var_t* var)
  */
 char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t bufsize)
 {
-    switch(var->type) {
+    switch(TYPEOF(var)) {
         case SSVAR_STRING:
-            return surgescript_util_strncpy(buf, surgescript_managedstring_data(var->managed_string), bufsize);
+            return surgescript_util_strncpy(buf, surgescript_managedstring_data(MANAGED_STRING(var)), bufsize);
         case SSVAR_BOOL:
-            return surgescript_util_strncpy(buf, var->boolean ? "true" : "false", bufsize);
+            return surgescript_util_strncpy(buf, BOOLEAN(var) ? "true" : "false", bufsize);
         case SSVAR_NULL:
             return surgescript_util_strncpy(buf, "null", bufsize);
         case SSVAR_OBJECTHANDLE:
@@ -516,7 +685,27 @@ char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t
  */
 const char* surgescript_var_fast_get_string(const surgescript_var_t* var)
 {
-    return var->type == SSVAR_STRING ? surgescript_managedstring_data(var->managed_string) : "";
+    return HAS_TYPE(var, SSVAR_STRING) ? surgescript_managedstring_data(MANAGED_STRING(var)) : "";
+}
+
+/*
+ * surgescript_var_fast_get_string_length()
+ * gets the number of UTF-8 characters of a string variable without
+ * performing any type conversion (it's zero if var isn't a string)
+ */
+size_t surgescript_var_fast_get_string_length(const surgescript_var_t* var)
+{
+    return HAS_TYPE(var, SSVAR_STRING) ? surgescript_managedstring_charcount(MANAGED_STRING(var)) : 0;
+}
+
+/*
+ * surgescript_var_fast_get_string_offset()
+ * gets the byte offset of the charnum-th UTF-8 character of a string variable
+ * without performing any type conversion (it's zero if var isn't a string)
+ */
+size_t surgescript_var_fast_get_string_offset(const surgescript_var_t* var, size_t charnum)
+{
+    return HAS_TYPE(var, SSVAR_STRING) ? surgescript_managedstring_offset(MANAGED_STRING(var), charnum) : 0;
 }
 
 /*
@@ -528,57 +717,71 @@ const char* surgescript_var_fast_get_string(const surgescript_var_t* var)
  */
 int surgescript_var_compare(const surgescript_var_t* a, const surgescript_var_t* b)
 {
-    if(a->type == b->type) {
-        switch(a->type) {
+    enum surgescript_vartype_t type_a, type_b;
+
+    /* same bits, same value (e.g., shared strings) */
+    if(a->bits == b->bits)
+        return 0;
+
+    type_a = TYPEOF(a);
+    type_b = TYPEOF(b);
+
+    if(type_a == type_b) {
+        switch(type_a) {
             case SSVAR_NULL:
                 return 0;
             case SSVAR_BOOL:
-                return (int)(a->boolean) - (int)(b->boolean);
+                return (int)BOOLEAN(a) - (int)BOOLEAN(b);
             case SSVAR_OBJECTHANDLE:
-                return (a->handle > b->handle) - (a->handle < b->handle);
+                return (HANDLE(a) > HANDLE(b)) - (HANDLE(a) < HANDLE(b));
             case SSVAR_STRING:
                 return strcmp(
-                    surgescript_managedstring_data(a->managed_string),
-                    surgescript_managedstring_data(b->managed_string)
+                    surgescript_managedstring_data(MANAGED_STRING(a)),
+                    surgescript_managedstring_data(MANAGED_STRING(b))
                 );
             case SSVAR_NUMBER: {
                 /* encourage users to use approximatelyEqual() */
                 /* epsilon comparisons may cause underlying problems, e.g., with infinity */
                 return isgreater(a->number, b->number) - isless(a->number, b->number);
             }
-            case SSVAR_RAW:
-                return (a->raw > b->raw) - (a->raw < b->raw);
+            case SSVAR_RAW: {
+                int64_t x = surgescript_var_get_rawbits(a);
+                int64_t y = surgescript_var_get_rawbits(b);
+                return (x > y) - (x < y);
+            }
         }
     }
     else {
-        if(a->type == SSVAR_NULL || b->type == SSVAR_NULL) {
-            return (a->raw != 0) - (b->raw != 0);
+        if(type_a == SSVAR_NULL || type_b == SSVAR_NULL) {
+            return (surgescript_var_get_rawbits(a) != 0) - (surgescript_var_get_rawbits(b) != 0);
         }
-        else if(a->type == SSVAR_RAW || b->type == SSVAR_RAW) {
-            return (a->raw > b->raw) - (a->raw < b->raw);
+        else if(type_a == SSVAR_RAW || type_b == SSVAR_RAW) {
+            int64_t x = surgescript_var_get_rawbits(a);
+            int64_t y = surgescript_var_get_rawbits(b);
+            return (x > y) - (x < y);
         }
-        else if(a->type == SSVAR_STRING || b->type == SSVAR_STRING) {
+        else if(type_a == SSVAR_STRING || type_b == SSVAR_STRING) {
             char buf[128];
-            if(a->type == SSVAR_STRING) {
+            if(type_a == SSVAR_STRING) {
                 surgescript_var_to_string(b, buf, sizeof(buf));
-                return strcmp(surgescript_managedstring_data(a->managed_string), buf);
+                return strcmp(surgescript_managedstring_data(MANAGED_STRING(a)), buf);
             }
             else {
                 surgescript_var_to_string(a, buf, sizeof(buf));
-                return strcmp(buf, surgescript_managedstring_data(b->managed_string));
+                return strcmp(buf, surgescript_managedstring_data(MANAGED_STRING(b)));
             }
         }
-        else if(a->type == SSVAR_NUMBER || b->type == SSVAR_NUMBER) {
+        else if(type_a == SSVAR_NUMBER || type_b == SSVAR_NUMBER) {
             double x = surgescript_var_get_number(a);
             double y = surgescript_var_get_number(b);
             return (x > y) - (x < y);
         }
-        else if(a->type == SSVAR_BOOL || b->type == SSVAR_BOOL) {
+        else if(type_a == SSVAR_BOOL || type_b == SSVAR_BOOL) {
             bool x = surgescript_var_get_bool(a);
             bool y = surgescript_var_get_bool(b);
             return (int)x - (int)y;
         }
-        else if(a->type == SSVAR_OBJECTHANDLE || b->type == SSVAR_OBJECTHANDLE) {
+        else if(type_a == SSVAR_OBJECTHANDLE || type_b == SSVAR_OBJECTHANDLE) {
             unsigned long x = surgescript_var_get_objecthandle(a);
             unsigned long y = surgescript_var_get_objecthandle(b);
             return (x > y) - (x < y);
@@ -600,27 +803,178 @@ void surgescript_var_swap(surgescript_var_t* a, surgescript_var_t* b)
     *b = t;
 }
 
+/*
+ * surgescript_var_concat()
+ * Converts count variables to strings and concatenates them in a single buffer,
+ * storing the result in dst (which may be one of them). Objects are converted
+ * with toString() if a valid manager is given (see surgescript_var_get_string())
+ */
+surgescript_var_t* surgescript_var_concat(surgescript_var_t* dst, const surgescript_var_t** src, int count, const surgescript_objectmanager_t* manager)
+{
+    char small_buffer[256];
+    char* buffer = small_buffer;
+    size_t capacity = sizeof(small_buffer), length = 0;
+
+    for(int i = 0; i < count; i++) {
+        char tmp[32], *allocated = NULL;
+        const char* str;
+        size_t str_length;
+
+        /* convert to string */
+        if(HAS_TYPE(src[i], SSVAR_STRING)) {
+            str = surgescript_managedstring_data(MANAGED_STRING(src[i]));
+            str_length = surgescript_managedstring_length(MANAGED_STRING(src[i]));
+        }
+        else {
+            if(HAS_TYPE(src[i], SSVAR_OBJECTHANDLE) && manager != NULL)
+                str = allocated = surgescript_var_get_string(src[i], manager);
+            else
+                str = surgescript_var_to_string(src[i], tmp, sizeof(tmp));
+            str_length = strlen(str);
+        }
+
+        /* grow the buffer */
+        if(length + str_length >= capacity) {
+            while(length + str_length >= capacity)
+                capacity *= 2;
+
+            if(buffer == small_buffer)
+                buffer = memcpy(ssmalloc(capacity), small_buffer, length);
+            else
+                buffer = ssrealloc(buffer, capacity);
+        }
+
+        /* append */
+        memcpy(buffer + length, str, str_length);
+        length += str_length;
+
+        if(allocated != NULL)
+            ssfree(allocated);
+    }
+
+    /* done! */
+    buffer[length] = '\0';
+    surgescript_var_set_string(dst, buffer);
+    if(buffer != small_buffer)
+        ssfree(buffer);
+
+    return dst;
+}
+
 /*
  * surgescript_var_get_rawbits()
  * Returns the binary value stored in the variable
  */
 int64_t surgescript_var_get_rawbits(const surgescript_var_t* var)
 {
-    return var->raw;
+    if(IS_NUMBER(var))
+        return (int64_t)var->bits; /* the bits of the double */
+    else if(HAS_TYPE(var, SSVAR_RAW))
+        return (int64_t)(var->bits << (64 - BOX_SHIFT)) >> (64 - BOX_SHIFT); /* sign extension */
+    else
+        return (int64_t)PAYLOAD(var);
 }
 
 /*
  * surgescript_var_set_rawbits()
- * Sets the binary value of the variable (for internal use only)
+ * Sets the binary value of the variable (for internal use only).
+ * Only 48 bits are stored: values out of range are saturated, so
+ * that their sign and whether they are zero are preserved
  */
 surgescript_var_t* surgescript_var_set_rawbits(surgescript_var_t* var, int64_t raw)
 {
+    if(raw > RAW_MAX)
+        raw = RAW_MAX;
+    else if(raw < -RAW_MAX)
+        raw = -RAW_MAX;
+
     RELEASE_DATA(var);
-    var->type = SSVAR_RAW;
-    var->raw = raw;
+    var->bits = BOX(SSVAR_RAW) | ((uint64_t)raw & BOX_PAYLOAD_MASK);
     return var;
 }
 
+/*
+ * surgescript_var_fast_add()
+ * dst = a + b, provided that both a and b are numbers (for internal use only).
+ * Returns false, without doing anything, if any of the operands isn't a number
+ */
+bool surgescript_var_fast_add(surgescript_var_t* dst, const surgescript_var_t* a, const surgescript_var_t* b)
+{
+    double result;
+
+    if(!IS_NUMBER(a) || !IS_NUMBER(b))
+        return false;
+
+    result = a->number + b->number;
+    RELEASE_DATA(dst);
+    dst->bits = box_number(result);
+    return true;
+}
+
+/*
+ * surgescript_var_fast_sub()
+ * dst = a - b, provided that both a and b are numbers (for internal use only).
+ * Returns false, without doing anything, if any of the operands isn't a number
+ */
+bool surgescript_var_fast_sub(surgescript_var_t* dst, const surgescript_var_t* a, const surgescript_var_t* b)
+{
+    double result;
+
+    if(!IS_NUMBER(a) || !IS_NUMBER(b))
+        return false;
+
+    result = a->number - b->number;
+    RELEASE_DATA(dst);
+    dst->bits = box_number(result);
+    return true;
+}
+
+/*
+ * surgescript_var_fast_mul()
+ * dst = a * b, provided that both a and b are numbers (for internal use only).
+ * Returns false, without doing anything, if any of the operands isn't a number
+ */
+bool surgescript_var_fast_mul(surgescript_var_t* dst, const surgescript_var_t* a, const surgescript_var_t* b)
+{
+    double result;
+
+    if(!IS_NUMBER(a) || !IS_NUMBER(b))
+        return false;
+
+    result = a->number * b->number;
+    RELEASE_DATA(dst);
+    dst->bits = box_number(result);
+    return true;
+}
+
+/*
+ * surgescript_var_fast_increment()
+ * var += delta, provided that var is a number (for internal use only).
+ * Returns false, without doing anything, if var isn't a number
+ */
+bool surgescript_var_fast_increment(surgescript_var_t* var, double delta)
+{
+    if(!IS_NUMBER(var))
+        return false;
+
+    var->bits = box_number(var->number + delta);
+    return true;
+}
+
+/*
+ * surgescript_var_fast_compare()
+ * Compares a and b like surgescript_var_compare(), provided that both are numbers
+ * (for internal use only). Returns false, without doing anything, if any of them isn't a number
+ */
+bool surgescript_var_fast_compare(const surgescript_var_t* a, const surgescript_var_t* b, int* result)
+{
+    if(!IS_NUMBER(a) || !IS_NUMBER(b))
+        return false;
+
+    *result = isgreater(a->number, b->number) - isless(a->number, b->number);
+    return true;
+}
+
 
 /*
  * surgescript_var_size()
@@ -628,8 +982,8 @@ surgescript_var_t* surgescript_var_set_rawbits(surgescript_var_t* var, int64_t r
  */
 size_t surgescript_var_size(const surgescript_var_t* var)
 {
-    if(var->type == SSVAR_STRING) {
-        size_t string_size = 1 + strlen(surgescript_managedstring_data(var->managed_string)); /* approximate */
+    if(HAS_TYPE(var, SSVAR_STRING)) {
+        size_t string_size = 1 + strlen(surgescript_managedstring_data(MANAGED_STRING(var))); /* approximate */
         return sizeof(surgescript_var_t) + string_size * sizeof(char);
     }
 
@@ -642,33 +996,181 @@ size_t surgescript_var_size(const surgescript_var_t* var)
 
 /* var pooling */
 
+/*
+ * surgescript_var_pool_create()
+ * Creates a new pool of variables. The pool is allocated
+ * using the memory allocator currently in use. Its pages
+ * are allocated on demand
+ */
+surgescript_varpool_t* surgescript_var_pool_create()
+{
+    surgescript_varpool_t* pool = ssmalloc(sizeof *pool);
+
+    pool->page_count = pool->capacity = pool->live = pool->peak = 0;
+    pool->pages = NULL;
+    pool->currbucket = NULL;
+    pool->far_strings = NULL;
+
+    return pool;
+}
+
+/*
+ * surgescript_var_pool_destroy()
+ * Destroys a pool of variables. Variables allocated
+ * from it must not be used after this call
+ */
+surgescript_varpool_t* surgescript_var_pool_destroy(surgescript_varpool_t* pool)
+{
+    if(varpool == pool)
+        varpool = NULL;
+
+    if(pool->far_strings != NULL)
+        delete_far_table(pool->far_strings);
+
+    delete_varpages(pool->pages);
+    return ssfree(pool);
+}
+
+/*
+ * surgescript_var_pool_select()
+ * Selects the pool from which the calling thread will allocate new
+ * variables (and to which it will give them back), or NULL for none.
+ * Returns the previously selected pool
+ */
+surgescript_varpool_t* surgescript_var_pool_select(surgescript_varpool_t* pool)
+{
+    surgescript_varpool_t* previous = varpool;
+    varpool = pool;
+    return previous;
+}
+
+/*
+ * surgescript_var_compact_pool()
+ * Gives the pages of the selected pool that hold no variables back to the system.
+ * Returns the number of released bytes
+ */
+size_t surgescript_var_compact_pool()
+{
+    surgescript_varpage_t** page;
+    surgescript_varbucket_t *bucket, **tail;
+    int* free_count;
+    int n = 0;
+    size_t released = 0;
+
+    /* a page can't be empty unless there are at least as many free buckets as in the smallest page */
+    if(varpool == NULL || varpool->capacity - varpool->live < VARPOOL_MIN_BUCKETS)
+        return 0;
+
+    /* count the free buckets of each page */
+    page = ssmalloc(varpool->page_count * sizeof(*page));
+    free_count = ssmalloc(varpool->page_count * sizeof(*free_count));
+    for(surgescript_varpage_t* p = varpool->pages; p != NULL; p = p->next) {
+        free_count[n] = 0;
+        page[n++] = p;
+    }
+    qsort(page, n, sizeof(*page), compare_varpages);
+    for(bucket = varpool->currbucket; bucket != NULL; bucket = bucket->next)
+        free_count[find_varpage(page, n, bucket)]++;
+
+    /* rebuild the free list without the buckets of the empty pages.
+       The free list may become empty: new pages are allocated on demand */
+    tail = &varpool->currbucket;
+    for(bucket = varpool->currbucket; bucket != NULL; bucket = bucket->next) {
+        int i = find_varpage(page, n, bucket);
+        if(free_count[i] != page[i]->bucket_count) {
+            *tail = bucket;
+            tail = &bucket->next;
+        }
+    }
+    *tail = NULL;
+
+    /* release the empty pages */
+    varpool->pages = NULL;
+    for(int i = n - 1; i >= 0; i--) {
+        if(free_count[i] != page[i]->bucket_count) {
+            page[i]->next = varpool->pages;
+            varpool->pages = page[i];
+        }
+        else {
+            released += sizeof(surgescript_varpage_t) + page[i]->bucket_count * sizeof(surgescript_varbucket_t);
+            varpool->capacity -= page[i]->bucket_count;
+            varpool->page_count--;
+            ssfree(page[i]);
+        }
+    }
+
+    /* done! */
+    if(released > 0)
+        sslog("Released %zu bytes of the var pool", released);
+    ssfree(free_count);
+    ssfree(page);
+    return released;
+}
+
+/*
+ * surgescript_var_pool_statistics()
+ * Reports the number of variables in use, the number of free
+ * variables of the selected pool and the peak number of variables in use
+ */
+void surgescript_var_pool_statistics(size_t* live, size_t* free, size_t* peak)
+{
+    bool selected = (varpool != NULL); /* report zeros if no pool is selected */
+
+    if(live != NULL)
+        *live = selected ? varpool->live : 0;
+
+    if(free != NULL)
+        *free = selected ? varpool->capacity - varpool->live : 0;
+
+    if(peak != NULL)
+        *peak = selected ? varpool->peak : 0;
+}
+
 /*
  * surgescript_var_init_pool()
- * Initializes the pool
+ * Each VM creates its own pool of variables since SurgeScript 0.6.1.
+ * This function is obsolete, does nothing and has been kept for
+ * backwards compatibility
  */
 void surgescript_var_init_pool()
 {
-    if(varpool == NULL) {
-        varpool = new_varpool(NULL);
-        varpool_currbucket = FIRST_BUCKET(varpool);
-    }
+    /* do nothing */
 }
 
 /*
  * surgescript_var_release_pool()
- * Releases the pool
+ * Each VM releases its own pool of variables since SurgeScript 0.6.1.
+ * This function is obsolete, does nothing and has been kept for
+ * backwards compatibility
  */
 void surgescript_var_release_pool()
 {
-    if(varpool != NULL) {
-        varpool_currbucket = NULL;
-        varpool = delete_varpools(varpool);
-    }
+    /* do nothing */
 }
 
 
 /* private section */
 
+/* NaN-boxes a number; NaNs are canonicalized so that they can't be mistaken for other types */
+uint64_t box_number(double number)
+{
+    union { double number; uint64_t bits; } x = { .number = number };
+    return x.bits < BOX_MIN ? x.bits : CANONICAL_NAN;
+}
+
+/* NaN-boxes a pointer to a managed string */
+uint64_t box_string(surgescript_managedstring_t* managed_string)
+{
+    uint64_t address = (uint64_t)(uintptr_t)managed_string;
+
+    /* the pointer fits in the payload (this is the usual case) */
+    if((address & BOX_TAG_MASK) == 0)
+        return BOX(SSVAR_STRING) | address;
+
+    /* store a far string */
+    return BOX(SSVAR_STRING) | new_far_string(managed_string);
+}
+
 /* is str a number? */
 bool is_number(const char* str)
 {
@@ -718,47 +1220,81 @@ void convert_decimal_point(char* str)
 
 /* private var pool routines */
 
-/* Creates a new var pool */
-surgescript_varpool_t* new_varpool(surgescript_varpool_t* next)
+/* Creates a new page of the selected var pool */
+surgescript_varpage_t* new_varpage(surgescript_varpage_t* next, int bucket_count)
+{
+    surgescript_varpage_t* page;
+    sslog("Allocating a new page of the var pool...");
+
+    page = ssmalloc(sizeof *page + bucket_count * sizeof(surgescript_varbucket_t));
+    for(int i = 0; i < bucket_count - 1; i++)
+        page->bucket[i].next = &(page->bucket[i + 1]);
+    page->bucket[bucket_count - 1].next = NULL;
+    page->bucket_count = bucket_count;
+    page->next = next;
+    varpool->capacity += bucket_count;
+    varpool->page_count++;
+
+    return page;
+}
+
+/* compares the addresses of two pages of a var pool (qsort) */
+int compare_varpages(const void* a, const void* b)
+{
+    uintptr_t x = (uintptr_t)(*(const surgescript_varpage_t**)a);
+    uintptr_t y = (uintptr_t)(*(const surgescript_varpage_t**)b);
+    return (x > y) - (x < y);
+}
+
+/* the index of the page that contains a bucket, given an array of pages sorted by address */
+int find_varpage(surgescript_varpage_t** sorted_pages, int count, const surgescript_varbucket_t* bucket)
 {
-    surgescript_varpool_t* pool;
-    sslog("Allocating a new var pool...");
+    int low = 0, high = count - 1;
 
-    pool = ssmalloc(sizeof *pool);
-    for(int i = 0; i < VARPOOL_NUM_BUCKETS - 1; i++) {
-        pool->bucket[i].next = &(pool->bucket[i + 1]);
-        pool->bucket[i].in_use = false;
+    while(low < high) {
+        int mid = (low + high + 1) / 2;
+        if((uintptr_t)FIRST_BUCKET(sorted_pages[mid]) <= (uintptr_t)bucket)
+            low = mid;
+        else
+            high = mid - 1;
     }
-    pool->bucket[VARPOOL_NUM_BUCKETS - 1].next = NULL;
-    pool->bucket[VARPOOL_NUM_BUCKETS - 1].in_use = false;
-    pool->next = next;
 
-    return pool;
+    return low;
 }
 
-/* Deletes all var pools */
-surgescript_varpool_t* delete_varpools(surgescript_varpool_t* head)
+/* Deletes a list of pages */
+surgescript_varpage_t* delete_varpages(surgescript_varpage_t* head)
 {
-    if(head->next)
-        delete_varpools(head->next);
+    if(head == NULL)
+        return NULL;
+    else if(head->next)
+        delete_varpages(head->next);
     return ssfree(head);
 }
 
 /* Allocates a bucket (must be fast) */
 surgescript_varbucket_t* allocate_bucket()
 {
-    surgescript_varbucket_t* bucket = varpool_currbucket;
+    surgescript_varbucket_t* bucket;
 
-    /* consistency check */
-    /*ssassert(bucket && !bucket->in_use);*/
+    /* no pool is selected */
+    if(varpool == NULL)
+        return ssmalloc(sizeof *bucket);
 
-    /* select bucket */
-    if(bucket->next == NULL) {
-        varpool = new_varpool(varpool);
-        bucket->next = FIRST_BUCKET(varpool);
+    /* the pool is full: add a page as large as all others combined */
+    if(varpool->currbucket == NULL) {
+        size_t bucket_count = ssclamp(varpool->capacity, VARPOOL_MIN_BUCKETS, VARPOOL_MAX_BUCKETS);
+        varpool->pages = new_varpage(varpool->pages, (int)bucket_count);
+        varpool->currbucket = FIRST_BUCKET(varpool->pages);
     }
-    varpool_currbucket = bucket->next;
-    bucket->in_use = true;
+
+    /* select bucket */
+    bucket = varpool->currbucket;
+    varpool->currbucket = bucket->next;
+
+    /* statistics */
+    if(++varpool->live > varpool->peak)
+        varpool->peak = varpool->live;
 
     /* done! */
     return bucket;
@@ -767,11 +1303,180 @@ surgescript_varbucket_t* allocate_bucket()
 /* Deallocates a bucket (must be fast) */
 void free_bucket(surgescript_varbucket_t* bucket)
 {
-    /* can't free if not in use */
-    /*ssassert(bucket->in_use);*/
+    /* no pool is selected */
+    if(varpool == NULL) {
+        ssfree(bucket);
+        return;
+    }
 
     /* put the bucket back in the pool */
-    bucket->in_use = false;
-    bucket->next = varpool_currbucket;
-    varpool_currbucket = bucket;
+    bucket->next = varpool->currbucket;
+    varpool->currbucket = bucket;
+    varpool->live--;
+}
+
+/* private far string routines */
+
+/* stores a managed string in a table of far strings and returns the payload of the variable */
+uint64_t new_far_string(surgescript_managedstring_t* managed_string)
+{
+    surgescript_fartable_t* table = &far_host_table;
+    uint32_t index;
+
+    /* use the table of the selected pool, creating it if needed */
+    if(varpool != NULL) {
+        if(varpool->far_strings == NULL) {
+            surgescript_fartable_t* new_table = ssmalloc(sizeof *new_table);
+            memset(new_table, 0, sizeof *new_table);
+            register_far_table(new_table);
+            varpool->far_strings = new_table;
+        }
+        table = varpool->far_strings;
+    }
+    else
+        LOCK_FAR_STRINGS();
+
+    /* reuse a free entry */
+    if(table->free != 0) {
+        index = table->free - 1;
+        table->free = far_entry(table, index)->next;
+    }
+    else {
+        /* the table is full */
+        if(table->count == FAR_MAX_ENTRIES) {
+            if(table == &far_host_table)
+                UNLOCK_FAR_STRINGS();
+            ssfatal("Can't store more than %u far strings", table->count);
+            return 0;
+        }
+
+        /* add a chunk to the table. Table 0 is shared by all threads, so it doesn't use their allocators */
+        index = table->count++;
+        if(far_entry(table, index) == NULL) {
+            const surgescript_allocator_t* allocator = (table == &far_host_table) ? surgescript_util_set_allocator(NULL) : NULL;
+            int c = 0;
+
+            while(table->chunk[c] != NULL)
+                c++;
+            table->chunk[c] = ssmalloc(((size_t)FAR_MIN_ENTRIES << c) * sizeof(surgescript_farstring_t));
+
+            if(table == &far_host_table)
+                surgescript_util_set_allocator(allocator);
+        }
+    }
+
+    far_entry(table, index)->managed_string = managed_string;
+
+    if(table == &far_host_table)
+        UNLOCK_FAR_STRINGS();
+
+    return ((uint64_t)table->number << 33) | ((uint64_t)index << 1) | 1;
+}
+
+/* gives an entry of a table of far strings back */
+void delete_far_string(uint64_t payload)
+{
+    surgescript_fartable_t* table = far_table((uint32_t)(payload >> 33));
+    uint32_t index = (uint32_t)(payload >> 1);
+
+    if(table == &far_host_table)
+        LOCK_FAR_STRINGS();
+
+    far_entry(table, index)->next = table->free;
+    table->free = 1 + index;
+
+    if(table == &far_host_table)
+        UNLOCK_FAR_STRINGS();
+}
+
+/* the managed string stored in an entry of a table of far strings */
+surgescript_managedstring_t* far_string(uint64_t payload)
+{
+    return far_entry(far_table((uint32_t)(payload >> 33)), (uint32_t)(payload >> 1))->managed_string;
+}
+
+/* an entry of a table of far strings, or NULL if its chunk hasn't been allocated */
+surgescript_farstring_t* far_entry(const surgescript_fartable_t* table, uint32_t index)
+{
+    /* find c = floor(log2(i)) - FAR_MIN_ENTRIES_LOG2 */
+    uint64_t i = (uint64_t)index + FAR_MIN_ENTRIES;
+    uint64_t j = i >> FAR_MIN_ENTRIES_LOG2;
+    int c = 0;
+
+    if(j >> 16) { j >>= 16; c += 16; }
+    if(j >> 8) { j >>= 8; c += 8; }
+    if(j >> 4) { j >>= 4; c += 4; }
+    if(j >> 2) { j >>= 2; c += 2; }
+    if(j >> 1) { c += 1; }
+
+    if(table->chunk[c] == NULL)
+        return NULL;
+
+    return &(table->chunk[c][i - ((uint64_t)FAR_MIN_ENTRIES << c)]);
+}
+
+/* the table of far strings registered with the given number */
+surgescript_fartable_t* far_table(uint32_t number)
+{
+    if(number == 0)
+        return &far_host_table;
+
+    return far_registry[number / FAR_REGISTRY_BLOCK][number % FAR_REGISTRY_BLOCK].table;
+}
+
+/* registers a table of far strings, so that its variables can be read in any context */
+void register_far_table(surgescript_fartable_t* table)
+{
+    uint32_t number;
+
+    LOCK_FAR_STRINGS();
+
+    /* reuse a free slot of the registry */
+    if(far_free_table != 0) {
+        number = far_free_table;
+        far_free_table = far_registry[number / FAR_REGISTRY_BLOCK][number % FAR_REGISTRY_BLOCK].next;
+    }
+    else {
+        /* the registry is full */
+        if(far_table_count == FAR_MAX_TABLES) {
+            UNLOCK_FAR_STRINGS();
+            ssfatal("Can't store far strings in more than %d VMs", FAR_MAX_TABLES - 1);
+            return;
+        }
+
+        /* add a block to the registry. It's shared by all VMs, so it doesn't use their allocators */
+        number = far_table_count++;
+        if(far_registry[number / FAR_REGISTRY_BLOCK] == NULL) {
+            const surgescript_allocator_t* allocator = surgescript_util_set_allocator(NULL);
+            far_registry[number / FAR_REGISTRY_BLOCK] = ssmalloc(FAR_REGISTRY_BLOCK * sizeof(surgescript_fartableref_t));
+            surgescript_util_set_allocator(allocator);
+        }
+    }
+
+    far_registry[number / FAR_REGISTRY_BLOCK][number % FAR_REGISTRY_BLOCK].table = table;
+    table->number = number;
+
+    UNLOCK_FAR_STRINGS();
+}
+
+/* gives the slot of a table of far strings back to the registry */
+void unregister_far_table(surgescript_fartable_t* table)
+{
+    uint32_t number = table->number;
+
+    LOCK_FAR_STRINGS();
+    far_registry[number / FAR_REGISTRY_BLOCK][number % FAR_REGISTRY_BLOCK].next = far_free_table;
+    far_free_table = number;
+    UNLOCK_FAR_STRINGS();
+}
+
+/* destroys the table of far strings of a pool of variables */
+surgescript_fartable_t* delete_far_table(surgescript_fartable_t* table)
+{
+    unregister_far_table(table);
+
+    for(int c = 0; c < FAR_MAX_CHUNKS && table->chunk[c] != NULL; c++)
+        ssfree(table->chunk[c]);
+
+    return ssfree(table);
 }
\ No newline at end of file
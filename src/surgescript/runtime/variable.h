@@ -28,6 +28,10 @@
 
 /* the variable type */
 typedef struct surgescript_var_t surgescript_var_t;
+#define SURGESCRIPT_VAR_SIZE 8 /* sizeof(surgescript_var_t), in bytes */
+
+/* a pool of variables */
+typedef struct surgescript_varpool_t surgescript_varpool_t;
 
 /* misc */
 struct surgescript_objectmanager_t;
@@ -40,6 +44,13 @@ struct surgescript_objectmanager_t;
 surgescript_var_t* surgescript_var_create();
 surgescript_var_t* surgescript_var_destroy(surgescript_var_t* var);
 
+/* contiguous arrays of variables */
+surgescript_var_t* surgescript_var_create_array(size_t length); /* creates an array of null variables */
+surgescript_var_t* surgescript_var_init_array(void* memory, size_t length); /* fills uninitialized memory with null variables */
+surgescript_var_t* surgescript_var_destroy_array(surgescript_var_t* array, size_t length);
+void surgescript_var_clear_array(surgescript_var_t* array, size_t length); /* sets all variables of the array to null */
+static inline surgescript_var_t* surgescript_var_at(surgescript_var_t* array, size_t index) { return (surgescript_var_t*)((char*)array + index * SURGESCRIPT_VAR_SIZE); }
+
 /* retrieve the value stored in a variable */
 bool surgescript_var_is_null(const surgescript_var_t* var);
 bool surgescript_var_get_bool(const surgescript_var_t* var);
@@ -53,6 +64,7 @@ surgescript_var_t* surgescript_var_set_null(surgescript_var_t* var);
 surgescript_var_t* surgescript_var_set_bool(surgescript_var_t* var, bool boolean);
 surgescript_var_t* surgescript_var_set_number(surgescript_var_t* var, double number);
 surgescript_var_t* surgescript_var_set_string(surgescript_var_t* var, const char* string);
+surgescript_var_t* surgescript_var_set_interned_string(surgescript_var_t* var, const char* string); /* shares the unique, interned copy of string */
 surgescript_var_t* surgescript_var_set_objecthandle(surgescript_var_t* var, unsigned handle);
 surgescript_var_t* surgescript_var_set_rawbits(surgescript_var_t* var, int64_t raw); /* sets its binary value */
 
@@ -71,12 +83,27 @@ surgescript_var_t* surgescript_var_copy(surgescript_var_t* dst, const surgescrip
 surgescript_var_t* surgescript_var_clone(const surgescript_var_t* var); /* similar to strdup */
 char* surgescript_var_to_string(const surgescript_var_t* var, char* buf, size_t bufsize); /* copies var to buf and returns buf, converting var to string if necessary (similar to itoa / strncpy) */
 const char* surgescript_var_fast_get_string(const surgescript_var_t* var); /* gets the string contents of var without performing any type conversion */
+size_t surgescript_var_fast_get_string_length(const surgescript_var_t* var); /* number of UTF-8 characters of a string var (no type conversion) */
+size_t surgescript_var_fast_get_string_offset(const surgescript_var_t* var, size_t charnum); /* byte offset of a UTF-8 character of a string var (no type conversion) */
 int surgescript_var_compare(const surgescript_var_t* a, const surgescript_var_t* b); /* similar to strcmp */
 void surgescript_var_swap(surgescript_var_t* a, surgescript_var_t* b); /* swaps a <-> b */
+surgescript_var_t* surgescript_var_concat(surgescript_var_t* dst, const surgescript_var_t** src, int count, const struct surgescript_objectmanager_t* manager); /* dst = src[0] + ... + src[count-1], as strings */
 size_t surgescript_var_size(const surgescript_var_t* var); /* used memory in user space, in bytes */
 
+/* fast operations on numbers; these return false, doing nothing, if an operand isn't a number */
+bool surgescript_var_fast_add(surgescript_var_t* dst, const surgescript_var_t* a, const surgescript_var_t* b); /* dst = a + b */
+bool surgescript_var_fast_sub(surgescript_var_t* dst, const surgescript_var_t* a, const surgescript_var_t* b); /* dst = a - b */
+bool surgescript_var_fast_mul(surgescript_var_t* dst, const surgescript_var_t* a, const surgescript_var_t* b); /* dst = a * b */
+bool surgescript_var_fast_increment(surgescript_var_t* var, double delta); /* var += delta */
+bool surgescript_var_fast_compare(const surgescript_var_t* a, const surgescript_var_t* b, int* result); /* *result = compare(a, b) */
+
 /* var pooling */
-void surgescript_var_init_pool();
-void surgescript_var_release_pool();
+surgescript_varpool_t* surgescript_var_pool_create(); /* creates a pool of variables */
+surgescript_varpool_t* surgescript_var_pool_destroy(surgescript_varpool_t* pool); /* destroys a pool of variables */
+surgescript_varpool_t* surgescript_var_pool_select(surgescript_varpool_t* pool); /* selects the pool used by surgescript_var_create() & friends in the calling thread (NULL for none); returns the previously selected pool */
+size_t surgescript_var_compact_pool(); /* releases the empty pages of the selected pool; returns the number of released bytes */
+void surgescript_var_pool_statistics(size_t* live, size_t* free, size_t* peak); /* number of variables in use, free and peak usage of the selected pool */
+void surgescript_var_init_pool(); /* (obsolete) does nothing; each VM creates its own pool */
+void surgescript_var_release_pool(); /* (obsolete) does nothing; each VM releases its own pool */
 
 #endif
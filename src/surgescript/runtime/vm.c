@@ -29,6 +29,7 @@
 #include "tag_system.h"
 #include "object_manager.h"
 #include "vm_time.h"
+#include "vm_memory.h"
 #include "managed_string.h"
 #include "sslib/sslib.h"
 #include "../compiler/parser.h"
@@ -54,6 +55,8 @@ struct surgescript_vmargs_t {
 static surgescript_vmargs_t* surgescript_vmargs_create();
 static surgescript_vmargs_t* surgescript_vmargs_destroy(surgescript_vmargs_t* args);
 static surgescript_vmargs_t* surgescript_vmargs_configure(surgescript_vmargs_t* args, int argc, char** argv);
+static const char STACK_SIZE_COMMAND_LINE_OPTION_NAME[] = "--surgescript-stack-size";
+static size_t find_stack_size(const surgescript_vmargs_t* args);
 
 
 /* VM */
@@ -67,6 +70,8 @@ struct surgescript_vm_t
     surgescript_vmargs_t* args;
     surgescript_vmtime_t* time;
     bool is_paused;
+
+    surgescript_vmmemory_t* memory;
 };
 
 /* misc */
@@ -84,7 +89,18 @@ static void install_plugin(const char* object_name, void* data);
  */
 surgescript_vm_t* surgescript_vm_create()
 {
-    surgescript_vm_t* vm = ssmalloc(sizeof *vm);
+    return surgescript_vm_create_ex(NULL);
+}
+
+/*
+ * surgescript_vm_create_ex()
+ * Creates a vm that uses a custom memory allocator (NULL for the default one).
+ * The allocator is copied; its user_data must outlive the vm
+ */
+surgescript_vm_t* surgescript_vm_create_ex(const surgescript_allocator_t* allocator)
+{
+    surgescript_vmmemory_t* memory, *previous;
+    surgescript_vm_t* vm;
 
     /* SurgeScript info */
     sslog("Using SurgeScript %s", surgescript_util_version());
@@ -94,14 +110,19 @@ surgescript_vm_t* surgescript_vm_create()
 
     /* initialize the pools */
     sslog("Initializing the pools...");
-    surgescript_managedstring_init_pool();
-    surgescript_var_init_pool();
+    memory = surgescript_vmmemory_create(allocator);
+
+    /* allocate the VM using its own allocator */
+    previous = surgescript_vmmemory_select(memory);
+    vm = ssmalloc(sizeof *vm);
+    vm->memory = memory;
 
     /* set up the VM */
     sslog("Creating the VM...");
     init_vm(vm);
 
     /* done! */
+    surgescript_vmmemory_select(previous);
     return vm;
 }
 
@@ -111,15 +132,19 @@ surgescript_vm_t* surgescript_vm_create()
  */
 surgescript_vm_t* surgescript_vm_destroy(surgescript_vm_t* vm)
 {
+    surgescript_vmmemory_t* memory = vm->memory;
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(memory);
+
     sslog("Shutting down the VM...");
     release_vm(vm);
+    ssfree(vm);
 
     sslog("Releasing the pools...");
-    surgescript_var_release_pool();
-    surgescript_managedstring_release_pool();
+    surgescript_vmmemory_select(previous != memory ? previous : NULL);
+    surgescript_vmmemory_destroy(memory);
 
     sslog("The VM has been shut down.");
-    return ssfree(vm);
+    return NULL;
 }
 
 /*
@@ -128,6 +153,9 @@ surgescript_vm_t* surgescript_vm_destroy(surgescript_vm_t* vm)
  */
 bool surgescript_vm_reset(surgescript_vm_t* vm)
 {
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
+    bool success = false;
+
     sslog("Will reset the VM...");
 
     if(surgescript_vm_is_active(vm)) {
@@ -135,27 +163,22 @@ bool surgescript_vm_reset(surgescript_vm_t* vm)
         sslog("Shutting down the VM...");
         release_vm(vm);
 
-        /* release the pools */
-        sslog("Releasing the pools...");
-        surgescript_var_release_pool();
-        surgescript_managedstring_release_pool();
-
         /* start new pools */
         sslog("Initializing new pools...");
-        surgescript_managedstring_init_pool();
-        surgescript_var_init_pool();
+        surgescript_vmmemory_reset(vm->memory);
 
         /* set up the VM again */
         sslog("Starting the VM again...");
         init_vm(vm);
 
         /* done */
-        return true;
+        success = true;
     }
-    else {
+    else
         sslog("Can't reset an inactive VM!");
-        return false;
-    }
+
+    surgescript_vmmemory_select(previous);
+    return success;
 }
 
 /*
@@ -168,6 +191,8 @@ bool surgescript_vm_compile(surgescript_vm_t* vm, const char* absolute_path)
     const size_t BUFSIZE = 1024;
     size_t read_chars = 0, data_size = 0;
     char* data = NULL;
+    surgescript_vmmemory_t* previous;
+    bool success;
 
     /* open the file in binary mode, so that offsets don't get messed up */
     FILE* fp = surgescript_util_fopen_utf8(absolute_path, "rb");
@@ -176,6 +201,9 @@ bool surgescript_vm_compile(surgescript_vm_t* vm, const char* absolute_path)
         return false;
     }
 
+    /* select the memory of this VM */
+    previous = surgescript_vmmemory_select(vm->memory);
+
     /* read file to data[] */
     sslog("Reading file %s...", absolute_path);
     do {
@@ -187,10 +215,11 @@ bool surgescript_vm_compile(surgescript_vm_t* vm, const char* absolute_path)
     fclose(fp);
 
     /* parse it */
-    bool success = surgescript_parser_parse(vm->parser, data, absolute_path);
+    success = surgescript_parser_parse(vm->parser, data, absolute_path);
 
     /* done! */
     ssfree(data);
+    surgescript_vmmemory_select(previous);
     return success;
 }
 
@@ -201,7 +230,7 @@ bool surgescript_vm_compile(surgescript_vm_t* vm, const char* absolute_path)
  */
 bool surgescript_vm_compile_code_in_memory(surgescript_vm_t* vm, const char* code)
 {
-    return surgescript_parser_parse(vm->parser, code, NULL);
+    return surgescript_vm_compile_virtual_file(vm, code, NULL);
 }
 
 /*
@@ -211,7 +240,11 @@ bool surgescript_vm_compile_code_in_memory(surgescript_vm_t* vm, const char* cod
  */
 bool surgescript_vm_compile_virtual_file(surgescript_vm_t* vm, const char* code, const char* filename)
 {
-    return surgescript_parser_parse(vm->parser, code, filename);
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
+    bool success = surgescript_parser_parse(vm->parser, code, filename);
+
+    surgescript_vmmemory_select(previous);
+    return success;
 }
 
 /*
@@ -229,13 +262,23 @@ void surgescript_vm_launch(surgescript_vm_t* vm)
  */
 void surgescript_vm_launch_ex(surgescript_vm_t* vm, int argc, char** argv)
 {
+    surgescript_vmmemory_t* previous;
+
     /* Already launched? */
     if(surgescript_vm_is_active(vm))
         return;
 
+    /* Select the memory of this VM */
+    previous = surgescript_vmmemory_select(vm->memory);
+
     /* Setup the command line arguments */
     surgescript_vmargs_configure(vm->args, argc, argv);
 
+    /* Setup the maximum size of the stack */
+    size_t stack_size = find_stack_size(vm->args);
+    if(stack_size > 0)
+        surgescript_stack_set_max_size(vm->stack, stack_size);
+
     /* Install plugins */
     surgescript_parser_foreach_plugin(vm->parser, vm, install_plugin);
 
@@ -244,6 +287,9 @@ void surgescript_vm_launch_ex(surgescript_vm_t* vm, int argc, char** argv)
 
     /* Create the root object */
     surgescript_objectmanager_spawn_root(vm->object_manager);
+
+    /* Done */
+    surgescript_vmmemory_select(previous);
 }
 
 /*
@@ -273,6 +319,7 @@ bool surgescript_vm_update(surgescript_vm_t* vm)
 bool surgescript_vm_update_ex(surgescript_vm_t* vm, void* user_data, void (*user_update)(surgescript_object_t*,void*), void (*late_update)(surgescript_object_t*,void*))
 {
     if(surgescript_vm_is_active(vm) && !vm->is_paused) {
+        surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
         surgescript_object_t* root = surgescript_vm_root_object(vm);
         surgescript_vm_updater_t updater = { user_data, user_update, late_update };
 
@@ -290,6 +337,7 @@ bool surgescript_vm_update_ex(surgescript_vm_t* vm, void* user_data, void (*user
             surgescript_object_traverse_tree(root, surgescript_object_update);
 
         /* done! */
+        surgescript_vmmemory_select(previous);
         return surgescript_vm_is_active(vm);
     }
     else {
@@ -347,6 +395,25 @@ bool surgescript_vm_is_paused(const surgescript_vm_t* vm)
     return vm->is_paused;
 }
 
+/*
+ * surgescript_vm_compact()
+ * Gives the unused memory of the var and string pools and of the object slabs
+ * back to the system (e.g., after a spike in memory usage). Returns the number
+ * of released bytes
+ */
+size_t surgescript_vm_compact(surgescript_vm_t* vm)
+{
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
+    size_t released = 0;
+
+    released += surgescript_var_compact_pool();
+    released += surgescript_managedstring_compact_pool();
+    released += surgescript_objectmanager_compact(vm->object_manager);
+
+    surgescript_vmmemory_select(previous);
+    return released;
+}
+
 /*
  * surgescript_vm_programpool()
  * Gets the program pool
@@ -418,7 +485,9 @@ surgescript_object_t* surgescript_vm_root_object(surgescript_vm_t* vm)
 surgescript_object_t* surgescript_vm_spawn_object(surgescript_vm_t* vm, surgescript_object_t* parent, const char* object_name, void* user_data)
 {
     surgescript_objecthandle_t parent_handle = surgescript_object_handle(parent);
-    surgescript_objecthandle_t child_handle = surgescript_objectmanager_spawn(vm->object_manager, parent_handle, object_name, user_data);
+    surgescript_objecthandle_t child_handle;
+
+    child_handle = surgescript_objectmanager_spawn(vm->object_manager, parent_handle, object_name, user_data);
     return surgescript_objectmanager_get(vm->object_manager, child_handle);
 }
 
@@ -429,7 +498,9 @@ surgescript_object_t* surgescript_vm_spawn_object(surgescript_vm_t* vm, surgescr
 surgescript_object_t* surgescript_vm_find_object(surgescript_vm_t* vm, const char* object_name)
 {
     const surgescript_object_t* root = surgescript_vm_root_object(vm);
-    surgescript_objecthandle_t handle = surgescript_object_find_descendant(root, object_name);
+    surgescript_objecthandle_t handle;
+
+    handle = surgescript_object_find_descendant(root, object_name);
     return surgescript_objectmanager_get(vm->object_manager, handle);
 }
 
@@ -439,8 +510,27 @@ surgescript_object_t* surgescript_vm_find_object(surgescript_vm_t* vm, const cha
  */
 void surgescript_vm_bind(surgescript_vm_t* vm, const char* object_name, const char* fun_name, surgescript_program_cfunction_t cfun, int num_params)
 {
-    surgescript_program_t* cprogram = surgescript_program_create_native(num_params, cfun);
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
+    surgescript_program_t* cprogram;
+
+    cprogram = surgescript_program_create_native(num_params, cfun);
     surgescript_programpool_replace(vm->program_pool, object_name, fun_name, cprogram);
+    surgescript_vmmemory_select(previous);
+}
+
+/*
+ * surgescript_vm_bind_ex()
+ * Binds a zero-copy C function to a SurgeScript object. The C function
+ * writes its return value to its last parameter instead of allocating it
+ */
+void surgescript_vm_bind_ex(surgescript_vm_t* vm, const char* object_name, const char* fun_name, surgescript_program_cfunction_ex_t cfun, int num_params)
+{
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
+    surgescript_program_t* cprogram;
+
+    cprogram = surgescript_program_create_native_ex(num_params, cfun);
+    surgescript_programpool_replace(vm->program_pool, object_name, fun_name, cprogram);
+    surgescript_vmmemory_select(previous);
 }
 
 /*
@@ -449,8 +539,11 @@ void surgescript_vm_bind(surgescript_vm_t* vm, const char* object_name, const ch
  */
 void surgescript_vm_install_plugin(surgescript_vm_t* vm, const char* object_name)
 {
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(vm->memory);
     surgescript_objectmanager_t* manager = vm->object_manager;
+
     surgescript_objectmanager_install_plugin(manager, object_name);
+    surgescript_vmmemory_select(previous);
 }
 
 /* ----- private ----- */
@@ -466,7 +559,7 @@ void init_vm(surgescript_vm_t* vm)
     vm->tag_system = surgescript_tagsystem_create();
     vm->args = surgescript_vmargs_create();
     vm->time = surgescript_vmtime_create();
-    vm->object_manager = surgescript_objectmanager_create(vm->program_pool, vm->tag_system, vm->stack, vm->args, vm->time);
+    vm->object_manager = surgescript_objectmanager_create(vm->program_pool, vm->tag_system, vm->stack, vm->args, vm->time, vm->memory);
     vm->parser = surgescript_parser_create(vm->program_pool, vm->tag_system);
 
     /* load the SurgeScript standard library */
@@ -478,6 +571,7 @@ void init_vm(surgescript_vm_t* vm)
     surgescript_sslib_register_gc(vm);
     surgescript_sslib_register_array(vm);
     surgescript_sslib_register_dictionary(vm);
+    surgescript_sslib_register_stringbuilder(vm);
     surgescript_sslib_register_time(vm);
     surgescript_sslib_register_date(vm);
     surgescript_sslib_register_math(vm);
@@ -584,3 +678,22 @@ surgescript_vmargs_t* surgescript_vmargs_destroy(surgescript_vmargs_t* args)
     surgescript_vmargs_configure(args, -1, NULL);
     return ssfree(args);
 }
+
+/* finds the maximum size of the stack given in the command line, or returns 0 if not given */
+size_t find_stack_size(const surgescript_vmargs_t* args)
+{
+    for(char** it = args->data; *it != NULL; it++) {
+        if(0 == strcmp(*it, STACK_SIZE_COMMAND_LINE_OPTION_NAME)) {
+            if(*(++it) != NULL && **it != '\0' && strspn(*it, "0123456789") == strlen(*it)) {
+                size_t cells = strtoul(*it, NULL, 10);
+                sslog("The maximum size of the stack has been set to %zu cells via %s", cells, STACK_SIZE_COMMAND_LINE_OPTION_NAME);
+                return cells;
+            }
+
+            sslog("Invalid argument given to %s: \"%s\"", STACK_SIZE_COMMAND_LINE_OPTION_NAME, *it != NULL ? *it : "");
+            --it;
+        }
+    }
+
+    return 0;
+}
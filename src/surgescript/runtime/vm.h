@@ -38,6 +38,7 @@ struct surgescript_vmtime_t;
 
 /* api */
 surgescript_vm_t* surgescript_vm_create();
+surgescript_vm_t* surgescript_vm_create_ex(const surgescript_allocator_t* allocator); /* creates a vm with a custom memory allocator */
 surgescript_vm_t* surgescript_vm_destroy(surgescript_vm_t* vm);
 
 /* SurgeScript Compiler */
@@ -56,6 +57,7 @@ bool surgescript_vm_update_ex(surgescript_vm_t* vm, void* user_data, void (*user
 void surgescript_vm_pause(surgescript_vm_t* vm); /* pause the VM */
 void surgescript_vm_resume(surgescript_vm_t* vm); /* resume a paused VM */
 bool surgescript_vm_is_paused(const surgescript_vm_t* vm); /* is the VM paused? */
+size_t surgescript_vm_compact(surgescript_vm_t* vm); /* gives unused memory back to the system; returns the number of released bytes */
 
 /* VM components */
 struct surgescript_programpool_t* surgescript_vm_programpool(const surgescript_vm_t* vm); /* gets the program pool */
@@ -70,6 +72,7 @@ surgescript_object_t* surgescript_vm_root_object(surgescript_vm_t* vm); /* root
 surgescript_object_t* surgescript_vm_spawn_object(surgescript_vm_t* vm, surgescript_object_t* parent, const char* object_name, void* user_data); /* user_data may be NULL */
 surgescript_object_t* surgescript_vm_find_object(surgescript_vm_t* vm, const char* object_name); /* finds an object */
 void surgescript_vm_bind(surgescript_vm_t* vm, const char* object_name, const char* fun_name, surgescript_program_cfunction_t cfun, int num_params); /* binds a C function to an object */
+void surgescript_vm_bind_ex(surgescript_vm_t* vm, const char* object_name, const char* fun_name, surgescript_program_cfunction_ex_t cfun, int num_params); /* binds a zero-copy C function to an object */
 void surgescript_vm_install_plugin(surgescript_vm_t* vm, const char* object_name); /* sets a certain object as a plugin */
 
 #endif
@@ -0,0 +1,148 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2016-2024 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * runtime/vm_memory.c
+ * SurgeScript Virtual Machine Memory - the allocator and the pools of a VM
+ */
+
+#include "vm_memory.h"
+#include "variable.h"
+#include "managed_string.h"
+#include "../util/util.h"
+
+/* VM memory */
+struct surgescript_vmmemory_t {
+    surgescript_allocator_t allocator; /* a copy of the allocator of the VM */
+    surgescript_varpool_t* var_pool;
+    surgescript_managedstringpool_t* string_pool;
+};
+
+/* the memory selected by each thread */
+static SS_THREAD_LOCAL surgescript_vmmemory_t* selected = NULL;
+static SS_THREAD_LOCAL const surgescript_allocator_t* host_allocator = NULL; /* the allocator in use when nothing is selected */
+static void apply(surgescript_vmmemory_t* memory);
+
+/*
+ * surgescript_vmmemory_create()
+ * Create the memory of a VM. The allocator is copied; its user_data must
+ * outlive the memory. Pass NULL to use the default allocator
+ */
+surgescript_vmmemory_t* surgescript_vmmemory_create(const surgescript_allocator_t* allocator)
+{
+    const surgescript_allocator_t* previous = surgescript_util_set_allocator(allocator);
+    surgescript_vmmemory_t* memory = ssmalloc(sizeof *memory);
+
+    memory->allocator = *surgescript_util_allocator();
+    surgescript_util_set_allocator(&memory->allocator);
+    memory->string_pool = surgescript_managedstring_pool_create();
+    memory->var_pool = surgescript_var_pool_create();
+    surgescript_util_set_allocator(previous);
+
+    return memory;
+}
+
+/*
+ * surgescript_vmmemory_destroy()
+ * Destroy the memory of a VM. Anything allocated from it
+ * must not be used after this call
+ */
+surgescript_vmmemory_t* surgescript_vmmemory_destroy(surgescript_vmmemory_t* memory)
+{
+    surgescript_allocator_t allocator = memory->allocator;
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(memory);
+
+    surgescript_var_pool_destroy(memory->var_pool);
+    surgescript_managedstring_pool_destroy(memory->string_pool);
+
+    surgescript_util_set_allocator(&allocator); /* memory->allocator is about to be released */
+    ssfree(memory);
+
+    apply(previous != memory ? previous : NULL);
+    return NULL;
+}
+
+/*
+ * surgescript_vmmemory_reset()
+ * Replace the pools by new ones. Anything allocated from
+ * the old pools must not be used after this call
+ */
+void surgescript_vmmemory_reset(surgescript_vmmemory_t* memory)
+{
+    surgescript_vmmemory_t* previous = surgescript_vmmemory_select(memory);
+
+    surgescript_var_pool_destroy(memory->var_pool);
+    surgescript_managedstring_pool_destroy(memory->string_pool);
+    memory->string_pool = surgescript_managedstring_pool_create();
+    memory->var_pool = surgescript_var_pool_create();
+
+    apply(memory); /* select the new pools */
+    surgescript_vmmemory_select(previous);
+}
+
+/*
+ * surgescript_vmmemory_select()
+ * Select the allocator and the pools used by the calling thread. Pass NULL
+ * to select none: variables and strings will be allocated separately and
+ * the allocator that was in use before selecting a VM will be restored.
+ * Returns the previous selection
+ */
+surgescript_vmmemory_t* surgescript_vmmemory_select(surgescript_vmmemory_t* memory)
+{
+    surgescript_vmmemory_t* previous = selected;
+
+    /* nothing to do */
+    if(memory == previous)
+        return previous;
+
+    /* remember the allocator of the host */
+    if(previous == NULL)
+        host_allocator = surgescript_util_allocator();
+
+    /* select the memory */
+    apply(memory);
+    return previous;
+}
+
+/*
+ * surgescript_vmmemory_selected()
+ * The memory selected by the calling thread, or NULL if there is none
+ */
+surgescript_vmmemory_t* surgescript_vmmemory_selected()
+{
+    return selected;
+}
+
+
+
+/* private */
+
+/* selects the allocator and the pools of the given memory (NULL for none) */
+void apply(surgescript_vmmemory_t* memory)
+{
+    if(memory != NULL) {
+        surgescript_util_set_allocator(&memory->allocator);
+        surgescript_var_pool_select(memory->var_pool);
+        surgescript_managedstring_pool_select(memory->string_pool);
+    }
+    else {
+        surgescript_util_set_allocator(host_allocator);
+        surgescript_var_pool_select(NULL);
+        surgescript_managedstring_pool_select(NULL);
+    }
+
+    selected = memory;
+}
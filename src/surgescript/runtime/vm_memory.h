@@ -0,0 +1,35 @@
+/*
+ * SurgeScript
+ * A scripting language for games
+ * Copyright 2016-2024 Alexandre Martins <alemartf(at)gmail(dot)com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * runtime/vm_memory.h
+ * SurgeScript Virtual Machine Memory - the allocator and the pools of a VM
+ */
+
+#ifndef _SURGESCRIPT_RUNTIME_VM_MEMORY_H
+#define _SURGESCRIPT_RUNTIME_VM_MEMORY_H
+
+typedef struct surgescript_vmmemory_t surgescript_vmmemory_t;
+struct surgescript_allocator_t;
+
+surgescript_vmmemory_t* surgescript_vmmemory_create(const struct surgescript_allocator_t* allocator); /* create the memory of a VM (NULL for the default allocator) */
+surgescript_vmmemory_t* surgescript_vmmemory_destroy(surgescript_vmmemory_t* memory); /* destroy the memory of a VM */
+void surgescript_vmmemory_reset(surgescript_vmmemory_t* memory); /* replace the pools by new ones */
+
+surgescript_vmmemory_t* surgescript_vmmemory_select(surgescript_vmmemory_t* memory); /* select the memory used by the calling thread (NULL for none); returns the previous selection */
+surgescript_vmmemory_t* surgescript_vmmemory_selected(); /* the memory selected by the calling thread, or NULL */
+
+#endif
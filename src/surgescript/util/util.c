@@ -49,6 +49,11 @@ static void (*log_function)(const char* message, void* context) = my_log_functio
 static void (*crash_function)(const char* message, void* context) = my_crash_function;
 static void* log_context = NULL;
 static void* crash_context = NULL;
+static void* my_allocate(size_t bytes, void* user_data);
+static void* my_reallocate(void* ptr, size_t bytes, void* user_data);
+static void my_deallocate(void* ptr, void* user_data);
+static const surgescript_allocator_t default_allocator = { my_allocate, my_reallocate, my_deallocate, NULL };
+static SS_THREAD_LOCAL const surgescript_allocator_t* allocator = &default_allocator; /* each thread selects its own */
 
 
 
@@ -62,7 +67,7 @@ static void* crash_context = NULL;
  */
 void* surgescript_util_malloc(size_t bytes, const char* file, int line)
 {
-    void *m = malloc(bytes);
+    void *m = allocator->allocate(bytes, allocator->user_data);
 
     if(m == NULL)
         mem_crash(file, line);
@@ -76,7 +81,7 @@ void* surgescript_util_malloc(size_t bytes, const char* file, int line)
  */
 void* surgescript_util_realloc(void* ptr, size_t bytes, const char* file, int line)
 {
-    void *m = realloc(ptr, bytes);
+    void *m = allocator->reallocate(ptr, bytes, allocator->user_data);
 
     if(m == NULL)
         mem_crash(file, line);
@@ -91,11 +96,34 @@ void* surgescript_util_realloc(void* ptr, size_t bytes, const char* file, int li
 void* surgescript_util_free(void* ptr)
 {
     if(ptr != NULL)
-        free(ptr);
+        allocator->deallocate(ptr, allocator->user_data);
 
     return NULL;
 }
 
+/*
+ * surgescript_util_allocator()
+ * The memory allocator currently in use by the calling thread
+ */
+const surgescript_allocator_t* surgescript_util_allocator()
+{
+    return allocator;
+}
+
+/*
+ * surgescript_util_set_allocator()
+ * Sets the memory allocator used by ssmalloc() and friends in the calling
+ * thread. Pass NULL to use the default allocator (the C library). Memory must
+ * be released by the same allocator that allocated it. Returns the previous
+ * allocator
+ */
+const surgescript_allocator_t* surgescript_util_set_allocator(const surgescript_allocator_t* new_allocator)
+{
+    const surgescript_allocator_t* previous_allocator = allocator;
+    allocator = (new_allocator != NULL) ? new_allocator : &default_allocator;
+    return previous_allocator;
+}
+
 /*
  * surgescript_util_log()
  * Logs a message
@@ -477,6 +505,21 @@ void my_crash_function(const char* message, void* context)
     exit(1); /* must exit the app */
 }
 
+void* my_allocate(size_t bytes, void* user_data)
+{
+    return malloc(bytes);
+}
+
+void* my_reallocate(void* ptr, size_t bytes, void* user_data)
+{
+    return realloc(ptr, bytes);
+}
+
+void my_deallocate(void* ptr, void* user_data)
+{
+    free(ptr);
+}
+
 void mem_crash(const char* file, int line) /* out of memory error */
 {
     static char buf[1024] = "Out of memory in ";
@@ -67,6 +67,25 @@
 #define SS_NO_INLINE
 #endif
 
+/* thread-local storage */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SS_THREAD_LOCAL             __declspec(thread) /* MSVC */
+#elif defined(__GNUC__) || defined(__clang__)
+#define SS_THREAD_LOCAL             __thread
+#else
+#define SS_THREAD_LOCAL             _Thread_local
+#endif
+
+/* pluggable memory allocator */
+typedef struct surgescript_allocator_t surgescript_allocator_t;
+struct surgescript_allocator_t
+{
+    void* (*allocate)(size_t bytes, void* user_data); /* malloc(); returns NULL on failure */
+    void* (*reallocate)(void* ptr, size_t bytes, void* user_data); /* realloc(); returns NULL on failure */
+    void (*deallocate)(void* ptr, void* user_data); /* free(); ptr is never NULL */
+    void* user_data; /* custom data passed to the functions above */
+};
+
 /* public routines */
 int surgescript_util_versioncode(const char* version); /* converts a version string to a comparable number */
 const char* surgescript_util_version(); /* compiled version of SurgeScript */
@@ -77,6 +96,8 @@ const char* surgescript_util_author(); /* project author */
 void* surgescript_util_malloc(size_t bytes, const char* file, int line); /* memory allocation */
 void* surgescript_util_realloc(void* ptr, size_t bytes, const char* file, int line); /* memory reallocation */
 void* surgescript_util_free(void* ptr); /* memory deallocation */
+const surgescript_allocator_t* surgescript_util_allocator(); /* the allocator currently in use by the calling thread */
+const surgescript_allocator_t* surgescript_util_set_allocator(const surgescript_allocator_t* allocator); /* sets the allocator in use by the calling thread (NULL for the default one); returns the previous one */
 
 void surgescript_util_log(const char* fmt, ...); /* logs a message */
 void surgescript_util_fatal(const char* fmt, ...); /* logs a message and kills the app */